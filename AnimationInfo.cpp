@@ -39,6 +39,9 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+// pixels gathered at a time by the affine blit in blendOnSurface2
+#define AFFINE_SPAN_PIXELS 256
+
 #if !defined(BPP16)
 static bool is_inv_alpha_lut_initialized = false;
 static Uint32 inv_alpha_lut[256];
@@ -157,13 +160,18 @@ void AnimationInfo::deepcopy(const AnimationInfo &anim)
     deepcopyTag(anim);
 
     if (anim.image_surface){
+        //share the pixels; writers call unshareImage() first
         int w = anim.image_surface->w, h = anim.image_surface->h;
-        allocImage( w, h );
-        copySurface(anim.image_surface, NULL);
+        image_surface = anim.image_surface;
+        image_surface->refcount++;
 #ifdef BPP16
+        alpha_buf = new unsigned char[w*h];
         if (anim.alpha_buf)
             memcpy(alpha_buf, anim.alpha_buf, w*h);
 #endif
+        abs_flag = true;
+        pos.w = w / num_of_cells;
+        pos.h = h;
     }
 }
 
@@ -217,6 +225,27 @@ void AnimationInfo::deleteImage(){
     stale_image = true;
 }
 
+// image_surface may be shared with the image cache or a deepcopy;
+// take a private copy before modifying its pixels or blit flags
+void AnimationInfo::unshareImage(){
+    if (is_copy || !image_surface || image_surface->refcount <= 1) return;
+
+    SDL_Surface *surface = allocSurface( image_surface->w, image_surface->h );
+    if (surface == NULL) return;
+
+    SDL_LockSurface( image_surface );
+    SDL_LockSurface( surface );
+    for (int i=0 ; i<surface->h ; i++)
+        memcpy( (unsigned char*)surface->pixels + surface->pitch * i,
+                (unsigned char*)image_surface->pixels + image_surface->pitch * i,
+                surface->w * sizeof(ONSBuf) );
+    SDL_UnlockSurface( surface );
+    SDL_UnlockSurface( image_surface );
+
+    SDL_FreeSurface( image_surface );
+    image_surface = surface;
+}
+
 void AnimationInfo::remove(){
     deleteImageName();
     deleteImage();
@@ -414,8 +443,8 @@ void AnimationInfo::blendOnSurface( SDL_Surface *dst_surface, int dst_x, int dst
 
     /* ---------------------------------------- */
     
-    SDL_LockSurface( dst_surface );
-    SDL_LockSurface( image_surface );
+    if ( SDL_MUSTLOCK( dst_surface ) ) SDL_LockSurface( dst_surface );
+    if ( SDL_MUSTLOCK( image_surface ) ) SDL_LockSurface( image_surface );
     
 #ifdef BPP16
     const int total_width = image_surface->pitch / 2;
@@ -561,12 +590,28 @@ void AnimationInfo::blendOnSurface( SDL_Surface *dst_surface, int dst_x, int dst
     }
 
 break2:
-    SDL_UnlockSurface( image_surface );
-    SDL_UnlockSurface( dst_surface );
+    if ( SDL_MUSTLOCK( image_surface ) ) SDL_UnlockSurface( image_surface );
+    if ( SDL_MUSTLOCK( dst_surface ) ) SDL_UnlockSurface( dst_surface );
 }
 
+#if !defined(BPP16)
+// Bilinear interpolation of four ARGB texels at fraction (fu,fv) of 256
+static inline Uint32 bilinearPixel( Uint32 p00, Uint32 p01, Uint32 p10, Uint32 p11,
+                                    Uint32 fu, Uint32 fv )
+{
+    Uint32 w11 = (fu * fv) >> 8;
+    Uint32 w01 = fu - w11, w10 = fv - w11;
+    Uint32 w00 = 256 - fu - fv + w11;
+    Uint32 rb = ((p00 & 0x00ff00ff) * w00 + (p01 & 0x00ff00ff) * w01 +
+                 (p10 & 0x00ff00ff) * w10 + (p11 & 0x00ff00ff) * w11) >> 8;
+    Uint32 ag = ((p00 >> 8) & 0x00ff00ff) * w00 + ((p01 >> 8) & 0x00ff00ff) * w01 +
+                ((p10 >> 8) & 0x00ff00ff) * w10 + ((p11 >> 8) & 0x00ff00ff) * w11;
+    return (rb & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+#endif
+
 void AnimationInfo::blendOnSurface2( SDL_Surface *dst_surface, int dst_x, int dst_y,
-                                     SDL_Rect &clip, int alpha )
+                                     SDL_Rect &clip, int alpha, bool bilinear )
 {
     if ( image_surface == NULL ) return;
     if ( alpha == 0 ) return;
@@ -592,14 +637,24 @@ void AnimationInfo::blendOnSurface2( SDL_Surface *dst_surface, int dst_x, int ds
     if (min_xy[1] < 0)               min_xy[1] = 0;
     if (max_xy[1] >= dst_surface->h) max_xy[1] = dst_surface->h - 1;
 
-    SDL_LockSurface( dst_surface );
-    SDL_LockSurface( image_surface );
+    if ( SDL_MUSTLOCK( dst_surface ) ) SDL_LockSurface( dst_surface );
+    if ( SDL_MUSTLOCK( image_surface ) ) SDL_LockSurface( image_surface );
     
 #ifdef BPP16
     int total_width = image_surface->pitch / 2;
 #else
     int total_width = image_surface->pitch / 4;
-#endif    
+    // texels for one stretch of a raster scan; on the stack so that
+    // compositor bands can draw sprites concurrently
+    ONSBuf span[AFFINE_SPAN_PIXELS];
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    unsigned char *span_alpha = (unsigned char *)span + 3;
+#else
+    unsigned char *span_alpha = (unsigned char *)span;
+#endif
+#endif
+    ONSBuf *src_cell = (ONSBuf *)image_surface->pixels + pos.w*current_cell;
+
     // set pixel by inverse-projection with raster scan
     for (y=min_xy[1] ; y<= max_xy[1] ; y++){
         // calculate the start and end point for each raster scan
@@ -619,28 +674,42 @@ void AnimationInfo::blendOnSurface2( SDL_Surface *dst_surface, int dst_x, int ds
         if (raster_min < 0)               raster_min = 0;
         if (raster_max >= dst_surface->w) raster_max = dst_surface->w - 1;
 
-        ONSBuf *dst_buffer = (ONSBuf *)dst_surface->pixels + dst_surface->w * y + raster_min;
-
         // inverse-projection
         int x_offset2 = (inv_mat[0][1] * (y-dst_y) >> 9) + pos.w;
         int y_offset2 = (inv_mat[1][1] * (y-dst_y) >> 9) + pos.h;
-        for (x=raster_min-dst_x ; x<=raster_max-dst_x ; x++, dst_buffer++){
-            int x2 = ((inv_mat[0][0] * x >> 9) + x_offset2) / 2;
-            int y2 = ((inv_mat[1][0] * x >> 9) + y_offset2) / 2;
 
-            if (x2 < 0 || x2 >= pos.w ||
-                y2 < 0 || y2 >= pos.h) continue;
+        // the projected coordinates are monotonic along the scan, so the
+        // pixels that land inside the image form one span: trim the rest
+        int x_min = raster_min-dst_x, x_max = raster_max-dst_x;
+        while (x_min <= x_max){
+            int x2 = ((inv_mat[0][0] * x_min >> 9) + x_offset2) / 2;
+            int y2 = ((inv_mat[1][0] * x_min >> 9) + y_offset2) / 2;
+            if (x2 >= 0 && x2 < pos.w && y2 >= 0 && y2 < pos.h) break;
+            x_min++;
+        }
+        while (x_max >= x_min){
+            int x2 = ((inv_mat[0][0] * x_max >> 9) + x_offset2) / 2;
+            int y2 = ((inv_mat[1][0] * x_max >> 9) + y_offset2) / 2;
+            if (x2 >= 0 && x2 < pos.w && y2 >= 0 && y2 < pos.h) break;
+            x_max--;
+        }
+        if (x_min > x_max) continue;
+
+        ONSBuf *dst_row = (ONSBuf *)dst_surface->pixels + dst_surface->w * y + x_min + dst_x;
 
-            ONSBuf *src_buffer = (ONSBuf *)image_surface->pixels + total_width * y2 + x2 + pos.w*current_cell;
+        // step the projection incrementally instead of per-pixel products
+        int x_acc = inv_mat[0][0] * x_min, y_acc = inv_mat[1][0] * x_min;
 #ifdef BPP16
+        // the 16bpp path keeps nearest-neighbour sampling
+        ONSBuf *dst_buffer = dst_row;
+        for (x=x_min ; x<=x_max ; x++, dst_buffer++){
+            int x2 = ((x_acc >> 9) + x_offset2) / 2;
+            int y2 = ((y_acc >> 9) + y_offset2) / 2;
+            x_acc += inv_mat[0][0];
+            y_acc += inv_mat[1][0];
+
+            ONSBuf *src_buffer = src_cell + total_width * y2 + x2;
             unsigned char *alphap = alpha_buf + image_surface->w * y2 + x2 + pos.w*current_cell;
-#else
-#if SDL_BYTEORDER == SDL_LIL_ENDIAN
-            unsigned char *alphap = (unsigned char *)src_buffer + 3;
-#else
-            unsigned char *alphap = (unsigned char *)src_buffer;
-#endif
-#endif
             if (blending_mode == BLEND_NORMAL) {
                 if ((trans_mode == TRANS_COPY) && (alpha == 256)) {
                     SET_PIXEL(*src_buffer, 0xff);
@@ -653,11 +722,71 @@ void AnimationInfo::blendOnSurface2( SDL_Surface *dst_surface, int dst_x, int ds
                 SUBBLEND_PIXEL();
             }
         }
+#else
+        // bilinear sampling works in 1/1024 texel units about the same
+        // center texel as the projection above, so that untransformed and
+        // mirrored sprites sample exactly the texels nearest-neighbour does
+        int u = 0, v = 0;
+        const int u_max = (pos.w-1) << 10, v_max = (pos.h-1) << 10;
+        if (bilinear){
+            u = inv_mat[0][0] * x_min + inv_mat[0][1] * (y-dst_y) + ((pos.w/2) << 10);
+            v = inv_mat[1][0] * x_min + inv_mat[1][1] * (y-dst_y) + ((pos.h/2) << 10);
+        }
+
+        for (x=x_min ; x<=x_max ; ){
+            int n = x_max - x + 1;
+            if (n > AFFINE_SPAN_PIXELS) n = AFFINE_SPAN_PIXELS;
+
+            // gather
+            if (bilinear){
+                for (i=0 ; i<n ; i++){
+                    int u2 = u < 0 ? 0 : (u > u_max ? u_max : u);
+                    int v2 = v < 0 ? 0 : (v > v_max ? v_max : v);
+                    u += inv_mat[0][0];
+                    v += inv_mat[1][0];
+
+                    ONSBuf *src_buffer = src_cell + total_width * (v2 >> 10) + (u2 >> 10);
+                    int dx = (u2 < u_max) ? 1 : 0;
+                    int dy = (v2 < v_max) ? total_width : 0;
+                    Uint32 fu = (u2 >> 2) & 0xff, fv = (v2 >> 2) & 0xff;
+                    span[i] = bilinearPixel( src_buffer[0],  src_buffer[dx],
+                                             src_buffer[dy], src_buffer[dy+dx], fu, fv );
+                }
+            }
+            else{
+                for (i=0 ; i<n ; i++){
+                    int x2 = ((x_acc >> 9) + x_offset2) / 2;
+                    int y2 = ((y_acc >> 9) + y_offset2) / 2;
+                    x_acc += inv_mat[0][0];
+                    y_acc += inv_mat[1][0];
+                    span[i] = src_cell[total_width * y2 + x2];
+                }
+            }
+
+            // blend
+            ONSBuf *dst_buffer = dst_row + (x - x_min);
+            ONSBuf *src_buffer = span;
+            unsigned char *alphap = span_alpha;
+            if (blending_mode == BLEND_NORMAL) {
+                if ((trans_mode == TRANS_COPY) && (alpha == 256))
+                    memcpy(dst_buffer, span, n * sizeof(ONSBuf));
+                else
+                    ons_gfx::imageFilterBlend(dst_buffer, src_buffer, alphap, alpha, n);
+            } else if (blending_mode == BLEND_ADD) {
+                for (i=n ; i!=0 ; i--, src_buffer++, dst_buffer++)
+                    ADDBLEND_PIXEL();
+            } else if (blending_mode == BLEND_SUB) {
+                for (i=n ; i!=0 ; i--, src_buffer++, dst_buffer++)
+                    SUBBLEND_PIXEL();
+            }
+            x += n;
+        }
+#endif
     }
     
     // unlock surface
-    SDL_UnlockSurface( image_surface );
-    SDL_UnlockSurface( dst_surface );
+    if ( SDL_MUSTLOCK( image_surface ) ) SDL_UnlockSurface( image_surface );
+    if ( SDL_MUSTLOCK( dst_surface ) ) SDL_UnlockSurface( dst_surface );
 }
 
 // used to draw characters on text_surface
@@ -668,6 +797,7 @@ void AnimationInfo::blendText( SDL_Surface *surface, int dst_x, int dst_y,
                                bool rotate_flag )
 {
     if (image_surface == NULL || surface == NULL) return;
+    unshareImage();
     
     SDL_Rect dst_rect = {(Sint16)dst_x, (Sint16)dst_y, (Uint16)surface->w, (Uint16)surface->h};
     if (rotate_flag){
@@ -829,6 +959,7 @@ void AnimationInfo::allocImage( int w, int h )
 void AnimationInfo::copySurface( SDL_Surface *surface, SDL_Rect *src_rect, SDL_Rect *dst_rect )
 {
     if (!image_surface || !surface) return;
+    unshareImage();
 
     SDL_Rect _dst_rect = {0, 0, (Uint16)image_surface->w, (Uint16)image_surface->h};
     if (dst_rect) _dst_rect = *dst_rect;
@@ -869,6 +1000,7 @@ void AnimationInfo::copySurface( SDL_Surface *surface, SDL_Rect *src_rect, SDL_R
 void AnimationInfo::fill( Uint8 r, Uint8 g, Uint8 b, Uint8 a )
 {
     if (!image_surface) return;
+    unshareImage();
     
     SDL_LockSurface( image_surface );
     ONSBuf *dst_buffer = (ONSBuf *)image_surface->pixels;
@@ -141,6 +141,7 @@ public:
     void deleteImageName();
     void setImageName( const char *name );
     void deleteImage();
+    void unshareImage();
     void remove();
     void removeTag();
 
@@ -153,7 +154,7 @@ public:
     void blendOnSurface( SDL_Surface *dst_surface, int dst_x, int dst_y,
                          SDL_Rect &clip, int alpha=256 );
     void blendOnSurface2( SDL_Surface *dst_surface, int dst_x, int dst_y,
-                          SDL_Rect &clip, int alpha=256 );
+                          SDL_Rect &clip, int alpha=256, bool bilinear=false );
     void blendText( SDL_Surface *surface, int dst_x, int dst_y,
                     SDL_Color &color, SDL_Rect *clip, bool rotate_flag );
     void calcAffineMatrix();
@@ -0,0 +1,194 @@
+/* -*- C++ -*-
+ *
+ *  ArchiveStream.cpp - An archive entry read a piece at a time
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ArchiveStream.h"
+
+ArchiveStream::ArchiveStream( const BaseReader::StreamSource &src )
+{
+    this->src = src;
+    pos = stored_pos = 0;
+    fp_pos = -1;
+    memset( &bz, 0, sizeof(bz) );
+    bz_open = bz_end = false;
+    in_buf = NULL;
+
+    if ( src.compression_type == BaseReader::NBZ_COMPRESSION ){
+        in_buf = new unsigned char[IN_LENGTH];
+        startNBZ();
+    }
+}
+
+ArchiveStream::~ArchiveStream()
+{
+    endNBZ();
+    if ( in_buf ) delete[] in_buf;
+    if ( src.fp ) fclose( src.fp );
+}
+
+size_t ArchiveStream::read( void *buf, size_t len )
+{
+    if ( len > src.original_length - pos )
+        len = src.original_length - pos;
+    if ( len == 0 ) return 0;
+
+    size_t ret;
+    if ( src.compression_type == BaseReader::NBZ_COMPRESSION )
+        ret = readNBZ( (unsigned char*)buf, len );
+    else
+        ret = readStored( (unsigned char*)buf, len );
+    pos += ret;
+
+    return ret;
+}
+
+bool ArchiveStream::seek( size_t pos )
+{
+    if ( pos > src.original_length ) return false;
+
+    if ( src.compression_type != BaseReader::NBZ_COMPRESSION ){
+        this->pos = stored_pos = pos;
+        return true;
+    }
+
+    if ( pos < this->pos ){
+        endNBZ();
+        startNBZ();
+    }
+    unsigned char skip_buf[IN_LENGTH];
+    while ( this->pos < pos ){
+        size_t len = pos - this->pos;
+        if ( len > IN_LENGTH ) len = IN_LENGTH;
+        if ( read( skip_buf, len ) == 0 ) return false;
+    }
+
+    return true;
+}
+
+size_t ArchiveStream::readStored( unsigned char *buf, size_t len )
+{
+    if ( len > src.length - stored_pos )
+        len = src.length - stored_pos;
+    if ( len == 0 || src.fp == NULL ) return 0;
+
+    long offset = (long)(src.offset + stored_pos);
+    if ( fp_pos != offset && fseek( src.fp, offset, SEEK_SET ) != 0 ){
+        fp_pos = -1;
+        return 0;
+    }
+    size_t ret = fread( buf, 1, len, src.fp );
+    fp_pos = offset + (long)ret;
+    stored_pos += ret;
+
+    if ( src.key_table_flag )
+        for ( size_t i=0 ; i<ret ; i++ ) buf[i] = src.key_table[buf[i]];
+
+    return ret;
+}
+
+size_t ArchiveStream::readNBZ( unsigned char *buf, size_t len )
+{
+    if ( !bz_open ) return 0;
+
+    bz.next_out = (char*)buf;
+    bz.avail_out = len;
+    while ( bz.avail_out > 0 && !bz_end ){
+        if ( bz.avail_in == 0 ){
+            size_t n = readStored( in_buf, IN_LENGTH );
+            if ( n == 0 ) break;
+            bz.next_in = (char*)in_buf;
+            bz.avail_in = n;
+        }
+        int err = BZ2_bzDecompress( &bz );
+        if ( err == BZ_STREAM_END ) bz_end = true;
+        else if ( err != BZ_OK ) break;
+    }
+
+    return len - bz.avail_out;
+}
+
+void ArchiveStream::startNBZ()
+{
+    memset( &bz, 0, sizeof(bz) );
+    bz_open = (BZ2_bzDecompressInit( &bz, 0, 0 ) == BZ_OK);
+    bz_end = false;
+    pos = stored_pos = 0;
+}
+
+void ArchiveStream::endNBZ()
+{
+    if ( bz_open ) BZ2_bzDecompressEnd( &bz );
+    bz_open = false;
+}
+
+int ArchiveStream::rwSeek( SDL_RWops *rw, int offset, int whence )
+{
+    ArchiveStream *stream = (ArchiveStream*)rw->hidden.unknown.data1;
+
+    long pos = offset;
+    if ( whence == RW_SEEK_CUR )      pos += (long)stream->tell();
+    else if ( whence == RW_SEEK_END ) pos += (long)stream->getLength();
+    if ( pos < 0 || !stream->seek( (size_t)pos ) ){
+        SDL_SetError( "ArchiveStream: can't seek to %ld", pos );
+        return -1;
+    }
+
+    return (int)stream->tell();
+}
+
+int ArchiveStream::rwRead( SDL_RWops *rw, void *ptr, int size, int maxnum )
+{
+    ArchiveStream *stream = (ArchiveStream*)rw->hidden.unknown.data1;
+    if ( size <= 0 || maxnum <= 0 ) return 0;
+
+    return (int)(stream->read( ptr, (size_t)size*maxnum ) / size);
+}
+
+int ArchiveStream::rwWrite( SDL_RWops * /*rw*/, const void * /*ptr*/, int /*size*/, int /*num*/ )
+{
+    SDL_SetError( "ArchiveStream: read only" );
+    return -1;
+}
+
+int ArchiveStream::rwClose( SDL_RWops *rw )
+{
+    if ( rw ){
+        delete (ArchiveStream*)rw->hidden.unknown.data1;
+        SDL_FreeRW( rw );
+    }
+    return 0;
+}
+
+SDL_RWops *ArchiveStream::createRWops( const BaseReader::StreamSource &src )
+{
+    ArchiveStream *stream = new ArchiveStream( src );
+    SDL_RWops *rw = SDL_AllocRW();
+    if ( rw == NULL ){
+        delete stream;
+        return NULL;
+    }
+
+    rw->seek  = rwSeek;
+    rw->read  = rwRead;
+    rw->write = rwWrite;
+    rw->close = rwClose;
+    rw->hidden.unknown.data1 = stream;
+
+    return rw;
+}
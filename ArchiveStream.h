@@ -0,0 +1,71 @@
+/* -*- C++ -*-
+ *
+ *  ArchiveStream.h - An archive entry read a piece at a time
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __ARCHIVE_STREAM_H__
+#define __ARCHIVE_STREAM_H__
+
+#include <SDL.h>
+#include <bzlib.h>
+#include "BaseReader.h"
+
+// Reads the entry behind a BaseReader::StreamSource, decoding NBZ on the
+// way.  Seeking back in an NBZ entry starts the decoder over, so this
+// suits readers that mostly go forward, like vorbisfile.
+class ArchiveStream
+{
+public:
+    ArchiveStream( const BaseReader::StreamSource &src ); // takes src.fp
+    ~ArchiveStream();
+
+    size_t read( void *buf, size_t len );
+    bool seek( size_t pos );
+    size_t tell() const { return pos; }
+    size_t getLength() const { return src.original_length; }
+
+    // an SDL_RWops owning a new ArchiveStream on src, freed by SDL_RWclose;
+    // NULL, with src.fp closed, if it can't be made
+    static SDL_RWops *createRWops( const BaseReader::StreamSource &src );
+
+private:
+    ArchiveStream( const ArchiveStream & );
+    ArchiveStream& operator =( const ArchiveStream & );
+
+    enum { IN_LENGTH = 4096 };
+
+    size_t readStored( unsigned char *buf, size_t len );
+    size_t readNBZ( unsigned char *buf, size_t len );
+    void startNBZ();
+    void endNBZ();
+
+    static int rwSeek( SDL_RWops *rw, int offset, int whence );
+    static int rwRead( SDL_RWops *rw, void *ptr, int size, int maxnum );
+    static int rwWrite( SDL_RWops *rw, const void *ptr, int size, int num );
+    static int rwClose( SDL_RWops *rw );
+
+    BaseReader::StreamSource src;
+    size_t pos;        // in the decoded bytes
+    size_t stored_pos; // in the stored bytes
+    long fp_pos;       // where src.fp is, to skip needless seeks
+    bz_stream bz;
+    bool bz_open, bz_end;
+    unsigned char *in_buf;
+};
+
+#endif // __ARCHIVE_STREAM_H__
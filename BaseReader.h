@@ -32,6 +32,11 @@
 #include <cstring>
 #include <stdio.h>
 
+#if !defined(WIN32) && !defined(MACOS9) && !defined(PSP) && !defined(__OS2__)
+#define HAVE_MMAP_ARCHIVES
+#include <sys/mman.h>
+#endif
+
 #ifndef SEEK_END
 #define SEEK_END 2
 #endif
@@ -82,18 +87,57 @@ struct BaseReader
         struct FileInfo *fi_list;
         unsigned int num_of_files;
         unsigned long base_offset;
+        unsigned char *mapped_data; // whole archive, when it could be mmap'ed
+        size_t mapped_length;
 
         ArchiveInfo()
         : next(NULL), file_handle(NULL), file_name(NULL),
-          fi_list(NULL), num_of_files(0), base_offset(0)
+          fi_list(NULL), num_of_files(0), base_offset(0),
+          mapped_data(NULL), mapped_length(0)
         {}
         ~ArchiveInfo(){
+#ifdef HAVE_MMAP_ARCHIVES
+            if (mapped_data) munmap( mapped_data, mapped_length );
+#endif
             if (file_handle) fclose( file_handle );
             if (file_name) delete[] file_name;
             if (fi_list) delete[] fi_list;
         }
     };
 
+    // a file resolved once by openFile, ready to be read
+    struct FileRef{
+        FILE *fp;                  // loose file, kept open until read/closed
+        struct ArchiveInfo *ai;    // archive holding the entry, or NULL
+        unsigned int no;           // entry number within ai
+        int compression_type;
+        int location;
+        size_t length;             // decoded length
+        const unsigned char *view; // mapped entry data, if usable as-is
+
+        FileRef()
+        : fp(NULL), ai(NULL), no(0), compression_type(NO_COMPRESSION),
+          location(ARCHIVE_TYPE_NONE), length(0), view(NULL)
+        {}
+    };
+
+    // an entry's stored bytes on a file handle of their own, so they can
+    // be read a piece at a time, from any thread, without the reader
+    struct StreamSource{
+        FILE *fp;                  // owned by whoever took the source
+        size_t offset;             // of the stored bytes within fp
+        size_t length;             // stored length
+        size_t original_length;    // decoded length
+        int compression_type;      // NO_COMPRESSION or NBZ_COMPRESSION
+        bool key_table_flag;
+        unsigned char key_table[256]; // applied to every stored byte
+
+        StreamSource()
+        : fp(NULL), offset(0), length(0), original_length(0),
+          compression_type(NO_COMPRESSION), key_table_flag(false)
+        {}
+    };
+
     //static char errbuf[MAX_ERRBUF_LEN]; // for passing back error details
 
     virtual ~BaseReader(){};
@@ -109,6 +153,16 @@ struct BaseReader
     //file_name parameter is assumed to use SJIS encoding
     virtual size_t getFileLength( const char *file_name ) = 0;
     virtual size_t getFile( const char *file_name, unsigned char *buffer, int *location=NULL ) = 0;
+
+    //resolves file_name once; false if it can't be found.  ref.view, when
+    //set, points into a mapped archive and stays valid until close()
+    virtual bool openFile( const char *file_name, FileRef &ref ) = 0;
+    //decodes ref.length bytes into buffer, then releases ref
+    virtual size_t readFile( FileRef &ref, unsigned char *buffer ) = 0;
+    virtual void closeFile( FileRef &ref ) = 0;
+    //turns ref into a StreamSource and releases it; false, leaving ref
+    //open, if the entry can only be decoded whole by readFile
+    virtual bool openStream( FileRef &ref, StreamSource &src ) = 0;
 };
 
 #endif // __BASE_READER_H__
@@ -23,15 +23,28 @@
  */
 
 #include "DirPaths.h"
+#if !defined(WIN32) && !defined(MACOS9) && !defined(PSP) && !defined(__OS2__)
+#include <dirent.h>
+#define HAVE_DIR_SNAPSHOT
+#endif
+
+#define SNAPSHOT_MAX_ENTRIES 262144
+#define SNAPSHOT_MAX_DEPTH 16
+#define SNAPSHOT_PATH_LEN 4096
 
 DirPaths::DirPaths( const char *new_paths )
-: num_paths(0), paths(NULL), all_paths(NULL)
+: num_paths(0), paths(NULL), all_paths(NULL),
+  snapshot_pool(NULL), snapshot_pool_len(0), snapshot_pool_size(0),
+  snapshot_table(NULL), snapshot_mask(0), num_of_snapshot_entries(0)
 {
     //printf("DirPaths cons\n");
     add(new_paths);
 }
 
 DirPaths::DirPaths( const DirPaths& dp )
+: num_paths(0), paths(NULL), all_paths(NULL),
+  snapshot_pool(NULL), snapshot_pool_len(0), snapshot_pool_size(0),
+  snapshot_table(NULL), snapshot_mask(0), num_of_snapshot_entries(0)
 {
     //printf("DirPaths copy cons\n");
     set(dp);
@@ -48,26 +61,44 @@ DirPaths& DirPaths::operator =( const DirPaths &dp )
 
 void DirPaths::set( const DirPaths &dp )
 {
-    memcpy(this, &dp, sizeof(DirPaths));
-    if (paths != NULL) {
-        char **old_paths = paths;
+    clear_paths();
+    clear_snapshot();
+
+    num_paths = dp.num_paths;
+    if (dp.paths != NULL) {
         paths = new char*[num_paths + 1];
         for (int i=0; i<=num_paths; i++) {
-            if (old_paths[i] != NULL) {
-                paths[i] = new char[strlen(old_paths[i]) + 1];
-                strcpy(paths[i], old_paths[i]);
+            if (dp.paths[i] != NULL) {
+                paths[i] = new char[strlen(dp.paths[i]) + 1];
+                strcpy(paths[i], dp.paths[i]);
             } else
                 paths[i] = NULL;
         }
     }
-    if (all_paths != NULL) {
-        char *old_all_paths = all_paths;
-        all_paths = new char[strlen(old_all_paths) + 1];
-        strcpy(all_paths, old_all_paths);
+    if (dp.all_paths != NULL) {
+        all_paths = new char[strlen(dp.all_paths) + 1];
+        strcpy(all_paths, dp.all_paths);
+    }
+
+    // same paths, so the file listing still holds
+    if (dp.snapshot_table != NULL) {
+        snapshot_pool_len = snapshot_pool_size = dp.snapshot_pool_len;
+        snapshot_pool = new char[snapshot_pool_size];
+        memcpy(snapshot_pool, dp.snapshot_pool, snapshot_pool_len);
+        snapshot_mask = dp.snapshot_mask;
+        snapshot_table = new size_t[snapshot_mask + 1];
+        memcpy(snapshot_table, dp.snapshot_table, sizeof(size_t) * (snapshot_mask + 1));
+        num_of_snapshot_entries = dp.num_of_snapshot_entries;
     }
 }
 
 DirPaths::~DirPaths()
+{
+    clear_paths();
+    clear_snapshot();
+}
+
+void DirPaths::clear_paths()
 {
     if (paths != NULL) {
         char **ptr = paths;
@@ -82,6 +113,9 @@ DirPaths::~DirPaths()
     if (all_paths != NULL) {
         delete[] all_paths;
     }
+    paths = NULL;
+    all_paths = NULL;
+    num_paths = 0;
 }
 
 void DirPaths::add( const DirPaths &dp )
@@ -104,6 +138,7 @@ void DirPaths::add( const char *new_paths )
 
     if (all_paths != NULL) delete[] all_paths;
     all_paths = NULL;
+    clear_snapshot();
 
     if (paths == NULL) num_paths = 0;
 
@@ -228,3 +263,180 @@ size_t DirPaths::max_path_len() const
     return len;
 }
 
+
+static unsigned int hashPath( const char *path )
+{
+    unsigned int h = 2166136261u;
+    while ( *path ){
+        h ^= (unsigned char) *path++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Folds a relative path for snapshot lookup: ASCII upper-case, '/' as the
+// only delimiter.  Returns 0 for paths the listing can't answer for.
+size_t DirPaths::foldPath( char *dst, const char *src, size_t max_len )
+{
+    size_t len = 0;
+    while ( *src == '/' || *src == '\\' ) src++;
+    const char *seg = src;
+    while ( *src ){
+        char ch = *src++;
+        if ( ch == '\\' ) ch = '/';
+        else if ( ch >= 'a' && ch <= 'z' ) ch += 'A' - 'a';
+        if ( ch == '/' ){
+            if ( len > 0 && dst[len-1] == '/' ) continue;
+            seg = src;
+        }
+        else if ( ch == '.' && seg == src-1 &&
+                  ( *src == '\0' || *src == '/' || *src == '\\' ||
+                    ( *src == '.' && ( src[1] == '\0' || src[1] == '/' || src[1] == '\\' ) ) ) ){
+            return 0; // "." or ".." component
+        }
+        if ( len + 1 >= max_len ) return 0;
+        dst[len++] = ch;
+    }
+    dst[len] = '\0';
+
+    return len;
+}
+
+void DirPaths::clear_snapshot()
+{
+    if (snapshot_pool != NULL) delete[] snapshot_pool;
+    if (snapshot_table != NULL) delete[] snapshot_table;
+    snapshot_pool = NULL;
+    snapshot_table = NULL;
+    snapshot_pool_len = snapshot_pool_size = 0;
+    snapshot_mask = num_of_snapshot_entries = 0;
+}
+
+void DirPaths::addSnapshotEntry( const char *path )
+{
+    char folded[SNAPSHOT_PATH_LEN];
+    size_t len = foldPath( folded, path, SNAPSHOT_PATH_LEN );
+    if ( len == 0 ) return;
+
+    if ( snapshot_pool_len + len + 1 > snapshot_pool_size ){
+        size_t size = snapshot_pool_size ? snapshot_pool_size : 16384;
+        while ( size < snapshot_pool_len + len + 1 ) size <<= 1;
+        char *tmp = new char[size];
+        if (snapshot_pool != NULL){
+            memcpy( tmp, snapshot_pool, snapshot_pool_len );
+            delete[] snapshot_pool;
+        }
+        snapshot_pool = tmp;
+        snapshot_pool_size = size;
+    }
+    memcpy( snapshot_pool + snapshot_pool_len, folded, len + 1 );
+    snapshot_pool_len += len + 1;
+    num_of_snapshot_entries++;
+}
+
+bool DirPaths::snapshotDir( char *dir_path, size_t root_len, int depth )
+{
+#ifdef HAVE_DIR_SNAPSHOT
+    size_t len = strlen( dir_path );
+    DIR *dp = opendir( (len > 0) ? dir_path : "." );
+    if ( dp == NULL ) return true;
+
+    struct dirent *entp;
+    while ( (entp = readdir(dp)) != NULL ){
+        if ( !strcmp( entp->d_name, "." ) || !strcmp( entp->d_name, ".." ) )
+            continue;
+        size_t name_len = strlen( entp->d_name );
+        if ( len + name_len + 2 >= SNAPSHOT_PATH_LEN ) continue;
+        if ( num_of_snapshot_entries >= SNAPSHOT_MAX_ENTRIES ){
+            closedir( dp );
+            return false;
+        }
+
+        memcpy( dir_path + len, entp->d_name, name_len + 1 );
+        addSnapshotEntry( dir_path + root_len );
+
+        bool is_dir = true;
+#ifdef _DIRENT_HAVE_D_TYPE
+        if ( entp->d_type != DT_DIR && entp->d_type != DT_LNK &&
+             entp->d_type != DT_UNKNOWN )
+            is_dir = false;
+#endif
+        if ( is_dir && depth < SNAPSHOT_MAX_DEPTH ){
+            dir_path[len + name_len] = '/';
+            dir_path[len + name_len + 1] = '\0';
+            if ( !snapshotDir( dir_path, root_len, depth + 1 ) ){
+                closedir( dp );
+                return false;
+            }
+        }
+        dir_path[len] = '\0';
+    }
+    closedir( dp );
+
+    return true;
+#else
+    (void)dir_path;
+    (void)root_len;
+    (void)depth;
+    return false;
+#endif
+}
+
+bool DirPaths::snapshot()
+{
+    clear_snapshot();
+#ifdef HAVE_DIR_SNAPSHOT
+    char dir_path[SNAPSHOT_PATH_LEN];
+    unsigned int i;
+
+    for ( int n=0 ; n<get_num_paths() ; n++ ){
+        const char *root = get_path(n);
+        if ( root == NULL ) continue;
+        size_t root_len = strlen( root );
+        if ( root_len + 2 >= SNAPSHOT_PATH_LEN ||
+             !snapshotDir( strcpy( dir_path, root ), root_len, 0 ) ){
+            fprintf( stderr, "Too many files under %s to keep a file listing\n", root );
+            clear_snapshot();
+            return false;
+        }
+    }
+
+    unsigned int size = 16;
+    while ( size < num_of_snapshot_entries * 2 ) size <<= 1;
+    snapshot_table = new size_t[size];
+    snapshot_mask = size - 1;
+    for ( i=0 ; i<size ; i++ ) snapshot_table[i] = 0;
+
+    size_t offset = 0;
+    while ( offset < snapshot_pool_len ){
+        const char *path = snapshot_pool + offset;
+        unsigned int h = hashPath( path ) & snapshot_mask;
+        while ( snapshot_table[h] != 0 ){
+            if ( !strcmp( path, snapshot_pool + snapshot_table[h] - 1 ) ) break;
+            h = (h + 1) & snapshot_mask;
+        }
+        if ( snapshot_table[h] == 0 ) snapshot_table[h] = offset + 1;
+        offset += strlen( path ) + 1;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+int DirPaths::has_file( const char *path ) const
+{
+    if ( snapshot_table == NULL || path == NULL ) return -1;
+
+    char folded[SNAPSHOT_PATH_LEN];
+    if ( foldPath( folded, path, SNAPSHOT_PATH_LEN ) == 0 ) return -1;
+
+    unsigned int h = hashPath( folded ) & snapshot_mask;
+    while ( snapshot_table[h] != 0 ){
+        if ( !strcmp( folded, snapshot_pool + snapshot_table[h] - 1 ) ) return 1;
+        h = (h + 1) & snapshot_mask;
+    }
+
+    return 0;
+}
@@ -56,12 +56,28 @@ public:
     int get_num_paths() const;
     size_t max_path_len() const;
 
+    // listing of every file under the paths, taken once so that probing
+    // for loose files which aren't there never reaches the filesystem
+    bool snapshot(); //(re)builds the listing; false if unavailable
+    void clear_snapshot();
+    bool has_snapshot() const { return snapshot_table != NULL; }
+    int has_file( const char *path ) const;
+
 private:
     void set( const DirPaths &dp ); //called by copy cons & =op
+    void clear_paths();
+    bool snapshotDir( char *dir_path, size_t root_len, int depth );
+    void addSnapshotEntry( const char *path );
+    static size_t foldPath( char *dst, const char *src, size_t max_len );
 
     int num_paths;
     char **paths;
     char *all_paths;
+
+    char *snapshot_pool; // folded relative paths, '\0'-separated
+    size_t snapshot_pool_len, snapshot_pool_size;
+    size_t *snapshot_table; // offsets+1 into snapshot_pool, 0 = empty
+    unsigned int snapshot_mask, num_of_snapshot_entries;
 };
 
 #endif // __DIR_PATHS__
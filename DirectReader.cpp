@@ -136,6 +136,9 @@ FILE *DirectReader::fopen(const char *path, const char *mode)
     //      a non-Windows system, it could be UTF-8 or EUC-JP
     FILE *fp = NULL;
 
+    // the path listing, if there is one, answers misses without any syscalls
+    if ( mode[0] == 'r' && archive_path->has_file( path ) == 0 ) return NULL;
+
     size_t len = archive_path->max_path_len() + strlen(path) + 1;
 
     if (file_path_len < len){
@@ -443,66 +446,115 @@ FILE *DirectReader::getFileHandle( const char *file_name, int &compression_type,
     return fp;
 }
 
-size_t DirectReader::getFileLength( const char *file_name )
+bool DirectReader::openFile( const char *file_name, FileRef &ref )
 {
-    if (file_name == NULL || strlen(file_name) == 0) return 0;
+    closeFile( ref );
+    if (file_name == NULL || strlen(file_name) == 0) return false;
 
-    int compression_type;
-    size_t len;
-    FILE *fp = getFileHandle( file_name, compression_type, &len );
+    FILE *fp = getFileHandle( file_name, ref.compression_type, &ref.length );
+    if ( fp && ref.length == 0 ){
+        fclose( fp );
+        fp = NULL;
+    }
+    if ( fp == NULL ){
+        ref.compression_type = NO_COMPRESSION;
+        return false;
+    }
+    ref.fp = fp;
 
-    if ( fp ) fclose( fp );
-    
-    return len;
+    return true;
 }
 
-size_t DirectReader::getFile( const char *file_name, unsigned char *buffer,
-                              int *location )
+size_t DirectReader::readFile( FileRef &ref, unsigned char *buffer )
 {
-    if (file_name == NULL || strlen(file_name) == 0) {
-        if ( location ) *location = ARCHIVE_TYPE_NONE;
+    size_t len = ref.length, c, total = 0;
+    FILE *fp = ref.fp;
+
+    if ( fp == NULL ){
+        closeFile( ref );
         return 0;
     }
 
-    int compression_type;
-    size_t len, c, total = 0;
-    FILE *fp = getFileHandle( file_name, compression_type, &len );
-
-    if ( fp ){
-        if ( compression_type & NBZ_COMPRESSION ) {
-            size_t buf_len = decodeNBZ( fp, 0, buffer );
-            fclose(fp);
-            return buf_len;
+    if ( ref.compression_type & NBZ_COMPRESSION ) {
+        total = decodeNBZ( fp, 0, buffer );
+    }
+    else if ( ref.compression_type & SPB_COMPRESSION ) {
+        total = decodeSPB( fp, 0, buffer );
+    }
+    else if (fseek( fp, 0, SEEK_SET ) == 0) {
+        total = len;
+        while( len > 0 ){
+            if ( len > READ_LENGTH ) c = READ_LENGTH;
+            else                     c = len;
+            len -= c;
+            if (fread( buffer, 1, c, fp ) < c) {
+                if (ferror( fp ))
+                    fprintf(stderr, "Error reading %s\n", file_full_path);
+            }
+            buffer += c;
         }
+    } else {
+        if (ferror( fp ))
+            fprintf(stderr, "Error seeking %s\n", file_full_path);
+    }
+    closeFile( ref );
 
-        if ( compression_type & SPB_COMPRESSION ) {
-            size_t buf_len = decodeSPB( fp, 0, buffer );
-            fclose(fp);
-            return buf_len;
-        }
+    return total;
+}
 
-        if (fseek( fp, 0, SEEK_SET ) == 0) {
-            total = len;
-            while( len > 0 ){
-                if ( len > READ_LENGTH ) c = READ_LENGTH;
-                else                     c = len;
-                len -= c;
-                if (fread( buffer, 1, c, fp ) < c) {
-                    if (ferror( fp ))
-                        fprintf(stderr, "Error reading %s\n", file_name);
-                }
-                buffer += c;
-            }
-        } else {
-            if (ferror( fp ))
-                fprintf(stderr, "Error seeking %s\n", file_name);
-        }
-        fclose( fp );
+void DirectReader::closeFile( FileRef &ref )
+{
+    if ( ref.fp ) fclose( ref.fp );
+    ref = FileRef();
+}
+
+bool DirectReader::openStream( FileRef &ref, StreamSource &src )
+{
+    if ( ref.fp == NULL || (ref.compression_type & SPB_COMPRESSION) )
+        return false;
+
+    src = StreamSource();
+    src.original_length = ref.length;
+    if ( ref.compression_type & NBZ_COMPRESSION ){
+        // stored as the decoded length, then the bzip2 stream
+        if ( fseek( ref.fp, 0, SEEK_END ) != 0 ) return false;
+        long stored = ftell( ref.fp );
+        if ( stored < 4 ) return false;
+        src.compression_type = NBZ_COMPRESSION;
+        src.offset = 4;
+        src.length = stored - 4;
     }
+    else
+        src.length = ref.length;
+    src.fp = ref.fp;
 
+    ref.fp = NULL;
+    closeFile( ref );
+
+    return true;
+}
+
+size_t DirectReader::getFileLength( const char *file_name )
+{
+    FileRef ref;
+    if ( !openFile( file_name, ref ) ) return 0;
+
+    size_t len = ref.length;
+    closeFile( ref );
+
+    return len;
+}
+
+size_t DirectReader::getFile( const char *file_name, unsigned char *buffer,
+                              int *location )
+{
+    FileRef ref;
     if ( location ) *location = ARCHIVE_TYPE_NONE;
+    if ( !openFile( file_name, ref ) ) return 0;
 
-    return total;
+    if ( location ) *location = ref.location;
+
+    return readFile( ref, buffer );
 }
 
 void DirectReader::convertFromSJISToEUC( char *buf )
@@ -53,6 +53,10 @@ public:
     //file_name parameter is assumed to use SJIS encoding
     size_t getFileLength( const char *file_name );
     size_t getFile( const char *file_name, unsigned char *buffer, int *location=NULL );
+    bool openFile( const char *file_name, FileRef &ref );
+    size_t readFile( FileRef &ref, unsigned char *buffer );
+    void closeFile( FileRef &ref );
+    bool openStream( FileRef &ref, StreamSource &src );
 
     static void convertFromSJISToEUC( char *buf );
     static void convertFromSJISToUTF8( char *dst_buf, const char *src_buf );
@@ -23,10 +23,22 @@
 
 #include "DirtyRect.h"
 
+static inline int rectArea( const SDL_Rect &rect )
+{
+    return rect.w * rect.h;
+}
+
+static inline bool isOverlapping( const SDL_Rect &r1, const SDL_Rect &r2 )
+{
+    return ( r1.x < r2.x + r2.w && r2.x < r1.x + r1.w &&
+             r1.y < r2.y + r2.h && r2.y < r1.y + r1.h );
+}
+
 DirtyRect::DirtyRect()
 {
     screen_width = screen_height = 0;
     bounding_box.w = bounding_box.h = 0;
+    num_rects = 0;
 }
 
 DirtyRect::DirtyRect( const DirtyRect &d )
@@ -34,6 +46,8 @@ DirtyRect::DirtyRect( const DirtyRect &d )
     screen_width  = d.screen_width;
     screen_height = d.screen_height;
     bounding_box = d.bounding_box;
+    num_rects = d.num_rects;
+    for (int i=0 ; i<num_rects ; i++) rects[i] = d.rects[i];
 }
 
 DirtyRect& DirtyRect::operator =( const DirtyRect &d )
@@ -41,6 +55,8 @@ DirtyRect& DirtyRect::operator =( const DirtyRect &d )
     screen_width  = d.screen_width;
     screen_height = d.screen_height;
     bounding_box = d.bounding_box;
+    num_rects = d.num_rects;
+    for (int i=0 ; i<num_rects ; i++) rects[i] = d.rects[i];
 
     return *this;
 }
@@ -80,6 +96,38 @@ void DirtyRect::add( SDL_Rect src )
         src.h = screen_height-src.y;
 
     bounding_box = calcBoundingBox( bounding_box, src );
+
+    // absorb every rect that overlaps src or sits close enough that one
+    // bigger rect is cheaper to refresh than two; a merged rect can reach
+    // others, so start over after each merge
+    int i = 0;
+    while ( i < num_rects ){
+        SDL_Rect merged = calcBoundingBox( rects[i], src );
+        if ( isOverlapping( rects[i], src ) ||
+             rectArea(merged) <= rectArea(rects[i]) + rectArea(src) + MERGE_SLACK ){
+            src = merged;
+            rects[i] = rects[--num_rects];
+            i = 0;
+        }
+        else
+            i++;
+
+        if ( i == num_rects && num_rects == MAX_RECTS ){
+            // no room left: merge with whichever rect grows the least
+            int best = 0, best_cost = 0;
+            for ( int j=0 ; j<num_rects ; j++ ){
+                int cost = rectArea( calcBoundingBox( rects[j], src ) ) - rectArea( rects[j] );
+                if ( j == 0 || cost < best_cost ){
+                    best = j;
+                    best_cost = cost;
+                }
+            }
+            src = calcBoundingBox( rects[best], src );
+            rects[best] = rects[--num_rects];
+            i = 0;
+        }
+    }
+    rects[num_rects++] = src;
 }
 
 SDL_Rect DirtyRect::calcBoundingBox( SDL_Rect src1, SDL_Rect &src2 )
@@ -112,6 +160,7 @@ SDL_Rect DirtyRect::calcBoundingBox( SDL_Rect src1, SDL_Rect &src2 )
 void DirtyRect::clear()
 {
     bounding_box.w = bounding_box.h = 0;
+    num_rects = 0;
 }
 
 void DirtyRect::fill( int w, int h )
@@ -119,4 +168,6 @@ void DirtyRect::fill( int w, int h )
     bounding_box.x = bounding_box.y = 0;
     bounding_box.w = w;
     bounding_box.h = h;
+    rects[0] = bounding_box;
+    num_rects = 1;
 }
@@ -28,6 +28,10 @@
 
 struct DirtyRect
 {
+    enum { MAX_RECTS = 8,
+           MERGE_SLACK = 4096 // pixels a merge may add before it isn't worth it
+    };
+
     DirtyRect();
     DirtyRect( const DirtyRect &d );
     DirtyRect& operator =( const DirtyRect &d );
@@ -41,7 +45,9 @@ struct DirtyRect
     SDL_Rect calcBoundingBox( SDL_Rect src1, SDL_Rect &src2 );
 
     int screen_width, screen_height;
-    SDL_Rect bounding_box;
+    SDL_Rect bounding_box; // covers all of rects[]
+    SDL_Rect rects[MAX_RECTS]; // disjoint regions to refresh
+    int num_rects;
 };
 
 #endif // __DIRTY_RECT__
@@ -0,0 +1,126 @@
+/* -*- C++ -*-
+ *
+ *  EffectFrameRing.cpp - Effect frames passed from a render thread to the screen
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "EffectFrameRing.h"
+
+EffectFrameRing::EffectFrameRing()
+{
+    size = 0;
+    counters = NULL;
+    mutex = NULL;
+    cond = NULL;
+    rendered = presented = 0;
+    finished = cancelled = false;
+}
+
+EffectFrameRing::~EffectFrameRing()
+{
+    close();
+}
+
+bool EffectFrameRing::open( int size )
+{
+    close();
+    if (size <= 0) return false;
+
+    mutex = SDL_CreateMutex();
+    cond = SDL_CreateCond();
+    if (mutex == NULL || cond == NULL){
+        close();
+        return false;
+    }
+    counters = new int[size];
+    this->size = size;
+    reset();
+
+    return true;
+}
+
+void EffectFrameRing::close()
+{
+    if (cond) SDL_DestroyCond( cond );
+    if (mutex) SDL_DestroyMutex( mutex );
+    cond = NULL;
+    mutex = NULL;
+    if (counters) delete[] counters;
+    counters = NULL;
+    size = 0;
+}
+
+void EffectFrameRing::reset()
+{
+    for (int i=0 ; i<size ; i++) counters[i] = 0;
+    rendered = presented = 0;
+    finished = cancelled = false;
+}
+
+int EffectFrameRing::beginFrame()
+{
+    SDL_LockMutex( mutex );
+    while (!cancelled && rendered - presented >= size)
+        SDL_CondWait( cond, mutex );
+    int frame = cancelled ? -1 : rendered;
+    SDL_UnlockMutex( mutex );
+
+    return frame;
+}
+
+void EffectFrameRing::endFrame( int frame, int counter, bool last )
+{
+    SDL_LockMutex( mutex );
+    counters[ frame % size ] = counter;
+    rendered = frame + 1;
+    if (last) finished = true;
+    SDL_CondSignal( cond );
+    SDL_UnlockMutex( mutex );
+}
+
+void EffectFrameRing::cancel()
+{
+    SDL_LockMutex( mutex );
+    cancelled = true;
+    SDL_CondSignal( cond );
+    SDL_UnlockMutex( mutex );
+}
+
+int EffectFrameRing::acquire( int elapsed )
+{
+    SDL_LockMutex( mutex );
+    while (!cancelled && !finished && rendered == presented)
+        SDL_CondWait( cond, mutex );
+
+    int frame = -1;
+    if (!cancelled && rendered > presented){
+        frame = presented;
+        while (frame+1 < rendered && counters[ (frame+1) % size ] <= elapsed)
+            frame++;
+    }
+    SDL_UnlockMutex( mutex );
+
+    return frame;
+}
+
+void EffectFrameRing::release( int frame )
+{
+    SDL_LockMutex( mutex );
+    if (frame >= presented) presented = frame + 1;
+    SDL_CondSignal( cond );
+    SDL_UnlockMutex( mutex );
+}
@@ -0,0 +1,71 @@
+/* -*- C++ -*-
+ *
+ *  EffectFrameRing.h - Effect frames passed from a render thread to the screen
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __EFFECT_FRAME_RING_H__
+#define __EFFECT_FRAME_RING_H__
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+// Hands out the slots of a ring of effect frames; the owner keeps the
+// images.  Frames are numbered from 0 and frame n lives in slot n % size.
+// The renderer only ever writes the slot beginFrame() returned, which is
+// never one the presenter holds: from acquire() until release(), every
+// frame from the oldest unreleased one up to the acquired one stays put.
+// Both sides may read the frame before the one being rendered.
+class EffectFrameRing
+{
+public:
+    EffectFrameRing();
+    ~EffectFrameRing();
+
+    bool open( int size );
+    void close();
+    void reset(); // nothing rendered or presented, not cancelled
+    int getSize() const { return size; }
+    int getSlot( int frame ) const { return frame % size; }
+
+    // renderer side
+    int beginFrame(); // waits for a free slot, -1 once cancel() was called
+    void endFrame( int frame, int counter, bool last );
+    void cancel();
+
+    // presenter side: the newest rendered frame whose counter is at most
+    // elapsed (or the oldest one, if none is due yet), waiting for one if
+    // need be; -1 once the last frame was released or after cancel()
+    int acquire( int elapsed );
+    int getCounter( int frame ) const { return counters[ frame % size ]; }
+    void release( int frame ); // hands this and earlier slots back
+
+private:
+    EffectFrameRing( const EffectFrameRing & );
+    EffectFrameRing& operator =( const EffectFrameRing & );
+
+    int size;
+    int *counters;
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+
+    // guarded by mutex
+    int rendered, presented;
+    bool finished, cancelled;
+};
+
+#endif // __EFFECT_FRAME_RING_H__
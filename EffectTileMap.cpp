@@ -0,0 +1,110 @@
+/* -*- C++ -*-
+ *
+ *  EffectTileMap.cpp - Which screen tiles an effect actually changes
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "EffectTileMap.h"
+#include <string.h>
+
+EffectTileMap::EffectTileMap()
+{
+    copied = false;
+    changed = NULL;
+    tiles_w = tiles_h = max_tiles = 0;
+    num_changed = 0;
+    area.x = area.y = 0;
+    area.w = area.h = 0;
+    valid = false;
+}
+
+EffectTileMap::~EffectTileMap()
+{
+    if ( changed ) delete[] changed;
+}
+
+void EffectTileMap::compare( const unsigned char *buf1, const unsigned char *buf2,
+                             int pitch, int bpp, int w, int h, const SDL_Rect &clip )
+{
+    tiles_w = (w + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_h = (h + TILE_SIZE - 1) / TILE_SIZE;
+    if ( tiles_w * tiles_h > max_tiles ){
+        if ( changed ) delete[] changed;
+        max_tiles = tiles_w * tiles_h;
+        changed = new unsigned char[max_tiles];
+    }
+    memset( changed, 0, tiles_w * tiles_h );
+    num_changed = 0;
+    copied = false;
+    valid = true;
+
+    int x1 = clip.x, y1 = clip.y;
+    int x2 = clip.x + clip.w, y2 = clip.y + clip.h;
+    if ( x1 < 0 ) x1 = 0;
+    if ( y1 < 0 ) y1 = 0;
+    if ( x2 > w ) x2 = w;
+    if ( y2 > h ) y2 = h;
+    if ( x2 <= x1 || y2 <= y1 ){
+        area.x = area.y = 0;
+        area.w = area.h = 0;
+        return;
+    }
+    area.x = x1;
+    area.y = y1;
+    area.w = x2 - x1;
+    area.h = y2 - y1;
+
+    for ( int ty=y1/TILE_SIZE ; ty*TILE_SIZE<y2 ; ty++ ){
+        unsigned char *row = changed + ty*tiles_w;
+        int ry1 = ty*TILE_SIZE, ry2 = ry1 + TILE_SIZE;
+        if ( ry1 < y1 ) ry1 = y1;
+        if ( ry2 > y2 ) ry2 = y2;
+        int tiles_left = (x2 - 1)/TILE_SIZE - x1/TILE_SIZE + 1;
+
+        // a tile stays unmarked until one of its rows differs
+        for ( int y=ry1 ; y<ry2 && tiles_left>0 ; y++ ){
+            for ( int tx=x1/TILE_SIZE ; tx*TILE_SIZE<x2 ; tx++ ){
+                if ( row[tx] ) continue;
+                int sx1 = tx*TILE_SIZE, sx2 = sx1 + TILE_SIZE;
+                if ( sx1 < x1 ) sx1 = x1;
+                if ( sx2 > x2 ) sx2 = x2;
+                int offset = y*pitch + sx1*bpp;
+                if ( memcmp( buf1 + offset, buf2 + offset, (sx2-sx1)*bpp ) ){
+                    row[tx] = 1;
+                    num_changed++;
+                    tiles_left--;
+                }
+            }
+        }
+    }
+}
+
+bool EffectTileMap::covers( const SDL_Rect &rect ) const
+{
+    return ( valid &&
+             rect.x >= area.x && rect.y >= area.y &&
+             rect.x + rect.w <= area.x + area.w &&
+             rect.y + rect.h <= area.y + area.h );
+}
+
+int EffectTileMap::getRunEnd( int tx, int ty ) const
+{
+    const unsigned char *row = changed + ty*tiles_w;
+    unsigned char c = row[tx];
+    while ( ++tx < tiles_w && row[tx] == c );
+    return tx;
+}
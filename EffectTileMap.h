@@ -0,0 +1,66 @@
+/* -*- C++ -*-
+ *
+ *  EffectTileMap.h - Which screen tiles an effect actually changes
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __EFFECT_TILE_MAP_H__
+#define __EFFECT_TILE_MAP_H__
+
+#include <SDL.h>
+
+// Marks which TILE_SIZE square tiles differ between the source and
+// destination images of an effect, so a fade need only blend those and can
+// copy the rest once.  Only tiles inside the rect given to compare() are
+// looked at; covers() tells whether a later blend stays within it.
+class EffectTileMap
+{
+public:
+    enum { TILE_SIZE = 32 };
+
+    EffectTileMap();
+    ~EffectTileMap();
+
+    // both images share the pitch (in bytes) and bytes per pixel
+    void compare( const unsigned char *buf1, const unsigned char *buf2,
+                  int pitch, int bpp, int w, int h, const SDL_Rect &clip );
+    void invalidate(){ valid = false; }
+    bool isValid() const { return valid; }
+    bool covers( const SDL_Rect &rect ) const;
+
+    int getTilesW() const { return tiles_w; }
+    int getTilesH() const { return tiles_h; }
+    int getNumChanged() const { return num_changed; }
+    bool isChanged( int tx, int ty ) const { return changed[ty*tiles_w+tx] != 0; }
+    // first column past the run of tiles in row ty, starting at tx, that
+    // are all changed or all unchanged
+    int getRunEnd( int tx, int ty ) const;
+
+    bool copied; // the unchanged tiles are already in the effect output
+
+private:
+    EffectTileMap( const EffectTileMap & );
+    EffectTileMap& operator =( const EffectTileMap & );
+
+    unsigned char *changed;
+    int tiles_w, tiles_h, max_tiles;
+    int num_changed;
+    SDL_Rect area;
+    bool valid;
+};
+
+#endif // __EFFECT_TILE_MAP_H__
@@ -0,0 +1,254 @@
+/* -*- C++ -*-
+ *
+ *  GlyphCache.cpp - Rendered glyphs packed into 8-bit atlas pages
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "GlyphCache.h"
+#include <string.h>
+
+GlyphCache::GlyphCache()
+{
+    for (int i=0 ; i<NUM_BUCKETS ; i++) bucket[i] = NULL;
+    lru_head = lru_tail = fill_page = NULL;
+    num_of_pages = num_of_entries = 0;
+    budget = usage = 0;
+    hits = misses = 0;
+
+    metrics_table = new MetricsSlot[NUM_METRICS];
+    for (int i=0 ; i<NUM_METRICS ; i++) metrics_table[i].font = NULL;
+}
+
+GlyphCache::~GlyphCache()
+{
+    clear();
+    delete[] metrics_table;
+}
+
+void GlyphCache::setBudget( size_t bytes )
+{
+    budget = bytes;
+    while (lru_tail && usage > budget)
+        evict( lru_tail );
+}
+
+unsigned int GlyphCache::hashKey( void *font, int style, Uint16 code )
+{
+    // FNV-1a over the key fields
+    unsigned long key[3] = { (unsigned long)font, (unsigned long)style, code };
+    const unsigned char *p = (const unsigned char*)key;
+    unsigned int hash = 2166136261u;
+    for (size_t i=0 ; i<sizeof(key) ; i++){
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+GlyphCache::Entry *GlyphCache::find( void *font, int style, Uint16 code, unsigned int hash )
+{
+    Entry *entry = bucket[hash % NUM_BUCKETS];
+    while (entry){
+        if (entry->code == code && entry->font == font && entry->style == style)
+            return entry;
+        entry = entry->bucket_next;
+    }
+    return NULL;
+}
+
+void GlyphCache::unlink( Page *page )
+{
+    if (page->prev) page->prev->next = page->next;
+    else            lru_head = page->next;
+    if (page->next) page->next->prev = page->prev;
+    else            lru_tail = page->prev;
+    page->prev = page->next = NULL;
+}
+
+void GlyphCache::pushFront( Page *page )
+{
+    page->prev = NULL;
+    page->next = lru_head;
+    if (lru_head) lru_head->prev = page;
+    else          lru_tail = page;
+    lru_head = page;
+}
+
+void GlyphCache::touch( Page *page )
+{
+    if (page == lru_head) return;
+    unlink( page );
+    pushFront( page );
+}
+
+void GlyphCache::evict( Page *page )
+{
+    Entry *entry = page->entries;
+    while (entry){
+        Entry **link = &bucket[entry->hash % NUM_BUCKETS];
+        while (*link != entry) link = &(*link)->bucket_next;
+        *link = entry->bucket_next;
+
+        Entry *tmp = entry;
+        entry = entry->page_next;
+        SDL_FreeSurface( tmp->surface );
+        delete tmp;
+        num_of_entries--;
+    }
+
+    if (page == fill_page) fill_page = NULL;
+    unlink( page );
+    usage -= page->size;
+    num_of_pages--;
+    if (page->pixels) delete[] page->pixels;
+    delete page;
+}
+
+SDL_Surface *GlyphCache::get( void *font, int style, Uint16 code )
+{
+    Entry *entry = find( font, style, code, hashKey(font, style, code) );
+    if (entry == NULL){
+        misses++;
+        return NULL;
+    }
+    hits++;
+    touch( entry->page );
+
+    return entry->surface;
+}
+
+GlyphCache::Page *GlyphCache::newPage( unsigned char *pixels, size_t size )
+{
+    while (lru_tail && usage + size > budget)
+        evict( lru_tail );
+
+    Page *page = new Page;
+    page->pixels = pixels;
+    page->size = size;
+    page->shelf_x = page->shelf_y = page->shelf_h = 0;
+    page->entries = NULL;
+    pushFront( page );
+    usage += size;
+    num_of_pages++;
+
+    return page;
+}
+
+// next-fit shelf packing: glyphs of one font are close in height, so
+// starting a new shelf whenever the current one runs out of width wastes
+// little; a shelf grows to the tallest glyph placed on it
+bool GlyphCache::allocate( Page *page, int w, int h, int *x, int *y )
+{
+    if (page->shelf_x + w > PAGE_SIZE){
+        page->shelf_y += page->shelf_h;
+        page->shelf_x = 0;
+        page->shelf_h = 0;
+    }
+    if (page->shelf_y + h > PAGE_SIZE) return false;
+    if (h > page->shelf_h) page->shelf_h = h;
+
+    *x = page->shelf_x;
+    *y = page->shelf_y;
+    page->shelf_x += w;
+
+    return true;
+}
+
+void GlyphCache::insert( Entry *entry, Page *page )
+{
+    entry->page = page;
+    entry->page_next = page->entries;
+    page->entries = entry;
+    entry->bucket_next = bucket[entry->hash % NUM_BUCKETS];
+    bucket[entry->hash % NUM_BUCKETS] = entry;
+    num_of_entries++;
+}
+
+SDL_Surface *GlyphCache::add( void *font, int style, Uint16 code, SDL_Surface *glyph )
+{
+    if (glyph == NULL) return NULL;
+
+    unsigned int hash = hashKey( font, style, code );
+    Entry *entry = new Entry;
+    entry->font = font;
+    entry->style = style;
+    entry->code = code;
+    entry->hash = hash;
+
+    if (glyph->w > PAGE_SIZE || glyph->h > PAGE_SIZE || glyph->w == 0 || glyph->h == 0 ||
+        glyph->format->BytesPerPixel != 1){
+        entry->surface = glyph;
+        insert( entry, newPage( NULL, (size_t)glyph->pitch * glyph->h ) );
+        return glyph;
+    }
+
+    int x = 0, y = 0;
+    if (fill_page == NULL || !allocate( fill_page, glyph->w, glyph->h, &x, &y )){
+        fill_page = newPage( new unsigned char[PAGE_SIZE * PAGE_SIZE], PAGE_SIZE * PAGE_SIZE );
+        allocate( fill_page, glyph->w, glyph->h, &x, &y );
+    }
+    Page *page = fill_page;
+    touch( page );
+
+    unsigned char *dst = page->pixels + y * PAGE_SIZE + x;
+    SDL_LockSurface( glyph );
+    for (int i=0 ; i<glyph->h ; i++)
+        memcpy( dst + i * PAGE_SIZE, (unsigned char*)glyph->pixels + i * glyph->pitch, glyph->w );
+    SDL_UnlockSurface( glyph );
+
+    entry->surface = SDL_CreateRGBSurfaceFrom( dst, glyph->w, glyph->h, 8, PAGE_SIZE, 0, 0, 0, 0 );
+    if (entry->surface && glyph->format->palette)
+        SDL_SetColors( entry->surface, glyph->format->palette->colors, 0,
+                       glyph->format->palette->ncolors );
+    SDL_FreeSurface( glyph );
+    if (entry->surface == NULL){
+        delete entry;
+        return NULL;
+    }
+    insert( entry, page );
+
+    return entry->surface;
+}
+
+void GlyphCache::clear()
+{
+    while (lru_tail) evict( lru_tail );
+}
+
+GlyphCache::MetricsSlot &GlyphCache::getMetricsSlot( void *font, int style, Uint16 code )
+{
+    return metrics_table[ hashKey(font, style, code) % NUM_METRICS ];
+}
+
+bool GlyphCache::getMetrics( void *font, int style, Uint16 code, Metrics *metrics )
+{
+    MetricsSlot &slot = getMetricsSlot( font, style, code );
+    if (slot.font != font || slot.style != style || slot.code != code)
+        return false;
+
+    *metrics = slot.metrics;
+    return true;
+}
+
+void GlyphCache::addMetrics( void *font, int style, Uint16 code, const Metrics &metrics )
+{
+    MetricsSlot &slot = getMetricsSlot( font, style, code );
+    slot.font = font;
+    slot.style = style;
+    slot.code = code;
+    slot.metrics = metrics;
+}
@@ -0,0 +1,118 @@
+/* -*- C++ -*-
+ *
+ *  GlyphCache.h - Rendered glyphs packed into 8-bit atlas pages
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __GLYPH_CACHE_H__
+#define __GLYPH_CACHE_H__
+
+#include <SDL.h>
+#include <stddef.h>
+
+// Keeps rendered 8-bit glyphs keyed on (font, style, code).  Glyphs are
+// copied into PAGE_SIZE x PAGE_SIZE pages, filled shelf by shelf, and each
+// one is handed out as an SDL_Surface that points into its page, so the
+// text blitters read it like any other glyph surface.  Glyphs too big for
+// a page keep their own surface and count as a page of their own.  When
+// the budget is reached the least recently used page goes, along with
+// every glyph on it; a returned surface stays valid until the next add().
+class GlyphCache
+{
+public:
+    enum { PAGE_SIZE = 256 };
+
+    struct Metrics{
+        int minx, maxx, miny, maxy, advance;
+    };
+
+    GlyphCache();
+    ~GlyphCache();
+
+    void setBudget( size_t bytes );
+    size_t getBudget() const { return budget; }
+
+    SDL_Surface *get( void *font, int style, Uint16 code );
+    // takes over glyph (an 8-bit surface, may be NULL) and returns the
+    // surface to draw from
+    SDL_Surface *add( void *font, int style, Uint16 code, SDL_Surface *glyph );
+    void clear();
+
+    // glyph metrics live in a separate direct-mapped table: they are
+    // asked for far more often than glyphs are drawn (line breaking
+    // measures every character), and cost nothing to keep
+    bool getMetrics( void *font, int style, Uint16 code, Metrics *metrics );
+    void addMetrics( void *font, int style, Uint16 code, const Metrics &metrics );
+
+    unsigned int getHits() const { return hits; }
+    unsigned int getMisses() const { return misses; }
+    size_t getUsage() const { return usage; }
+    int getNumPages() const { return num_of_pages; }
+    int getNumEntries() const { return num_of_entries; }
+
+private:
+    GlyphCache( const GlyphCache & );
+    GlyphCache& operator =( const GlyphCache & );
+
+    enum { NUM_BUCKETS = 1024, NUM_METRICS = 4096 };
+
+    struct Page;
+    struct Entry{
+        void *font;
+        int style;
+        Uint16 code;
+        unsigned int hash;
+        SDL_Surface *surface; // view into page->pixels, or the glyph itself
+        Page *page;
+        Entry *bucket_next;
+        Entry *page_next;
+    };
+    struct Page{
+        unsigned char *pixels; // NULL for a single oversized glyph
+        size_t size;
+        int shelf_x, shelf_y, shelf_h; // the shelf being filled
+        Entry *entries;
+        Page *prev, *next; // LRU order, most recent first
+    };
+
+    struct MetricsSlot{
+        void *font; // NULL if unused
+        int style;
+        Uint16 code;
+        Metrics metrics;
+    } *metrics_table;
+
+    Entry *bucket[NUM_BUCKETS];
+    Page *lru_head, *lru_tail;
+    Page *fill_page; // where new glyphs are packed
+    int num_of_pages, num_of_entries;
+    size_t budget, usage;
+    unsigned int hits, misses;
+
+    static unsigned int hashKey( void *font, int style, Uint16 code );
+    MetricsSlot &getMetricsSlot( void *font, int style, Uint16 code );
+    Entry *find( void *font, int style, Uint16 code, unsigned int hash );
+    bool allocate( Page *page, int w, int h, int *x, int *y );
+    Page *newPage( unsigned char *pixels, size_t size );
+    void pushFront( Page *page );
+    void touch( Page *page );
+    void unlink( Page *page );
+    void evict( Page *page );
+    void insert( Entry *entry, Page *page );
+};
+
+#endif // __GLYPH_CACHE_H__
@@ -0,0 +1,166 @@
+/* -*- C++ -*-
+ *
+ *  ImageCache.cpp - LRU cache of decoded sprite surfaces for ONScripter-EN
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ImageCache.h"
+#include <string.h>
+
+ImageCache::ImageCache()
+{
+    for (int i=0 ; i<NUM_BUCKETS ; i++) bucket[i] = NULL;
+    lru_head = lru_tail = NULL;
+    num_of_entries = 0;
+    budget = usage = 0;
+    hits = misses = 0;
+}
+
+ImageCache::~ImageCache()
+{
+    clear();
+}
+
+void ImageCache::setBudget( size_t bytes )
+{
+    budget = bytes;
+    while (lru_tail && usage > budget)
+        evict( lru_tail );
+}
+
+unsigned int ImageCache::hashKey( const char *key )
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    while (*key){
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+ImageCache::Entry *ImageCache::find( const char *key, unsigned int hash )
+{
+    Entry *entry = bucket[hash % NUM_BUCKETS];
+    while (entry){
+        if (entry->hash == hash && !strcmp(entry->key, key))
+            return entry;
+        entry = entry->bucket_next;
+    }
+    return NULL;
+}
+
+void ImageCache::unlink( Entry *entry )
+{
+    if (entry->prev) entry->prev->next = entry->next;
+    else             lru_head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else             lru_tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+void ImageCache::pushFront( Entry *entry )
+{
+    entry->prev = NULL;
+    entry->next = lru_head;
+    if (lru_head) lru_head->prev = entry;
+    else          lru_tail = entry;
+    lru_head = entry;
+}
+
+void ImageCache::evict( Entry *entry )
+{
+    Entry **link = &bucket[entry->hash % NUM_BUCKETS];
+    while (*link != entry) link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+
+    unlink( entry );
+    usage -= entry->size;
+    num_of_entries--;
+
+    // drops only the cache's reference; sprites still using it keep theirs
+    SDL_FreeSurface( entry->surface );
+    delete[] entry->key;
+    delete entry;
+}
+
+SDL_Surface *ImageCache::get( const char *key, int *orig_w, int *orig_h, int *trans_mode )
+{
+    if (budget == 0) return NULL;
+
+    Entry *entry = find( key, hashKey(key) );
+    if (entry == NULL){
+        misses++;
+        return NULL;
+    }
+    hits++;
+
+    if (entry != lru_head){
+        unlink( entry );
+        pushFront( entry );
+    }
+
+    *orig_w = entry->orig_w;
+    *orig_h = entry->orig_h;
+    *trans_mode = entry->trans_mode;
+    entry->surface->refcount++;
+
+    return entry->surface;
+}
+
+bool ImageCache::has( const char *key )
+{
+    return find( key, hashKey(key) ) != NULL;
+}
+
+void ImageCache::add( const char *key, SDL_Surface *surface,
+                      int orig_w, int orig_h, int trans_mode )
+{
+    if (surface == NULL) return;
+
+    size_t size = (size_t)surface->pitch * surface->h;
+    if (size > budget) return;
+
+    unsigned int hash = hashKey( key );
+    Entry *entry = find( key, hash );
+    if (entry) evict( entry );
+
+    while (lru_tail && usage + size > budget)
+        evict( lru_tail );
+
+    entry = new Entry;
+    entry->key = new char[ strlen(key) + 1 ];
+    strcpy( entry->key, key );
+    entry->hash = hash;
+    entry->surface = surface;
+    surface->refcount++;
+    entry->size = size;
+    entry->orig_w = orig_w;
+    entry->orig_h = orig_h;
+    entry->trans_mode = trans_mode;
+
+    entry->bucket_next = bucket[hash % NUM_BUCKETS];
+    bucket[hash % NUM_BUCKETS] = entry;
+    pushFront( entry );
+    usage += size;
+    num_of_entries++;
+}
+
+void ImageCache::clear()
+{
+    while (lru_tail) evict( lru_tail );
+}
@@ -0,0 +1,81 @@
+/* -*- C++ -*-
+ *
+ *  ImageCache.h - LRU cache of decoded sprite surfaces for ONScripter-EN
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __IMAGE_CACHE_H__
+#define __IMAGE_CACHE_H__
+
+#include <SDL.h>
+#include <stddef.h>
+
+// Holds finished (alpha-processed, resized) image surfaces keyed by a
+// string describing how they were built.  Surfaces are shared through
+// SDL's own refcount: the cache keeps one reference and every AnimationInfo
+// using the image holds another, so evicting an entry never invalidates a
+// surface that is still on screen, and AnimationInfo::deleteImage only
+// drops its own reference.
+class ImageCache
+{
+public:
+    ImageCache();
+    ~ImageCache();
+
+    void setBudget( size_t bytes );
+    size_t getBudget() const { return budget; }
+
+    // returns a new reference to the cached surface (or NULL on a miss);
+    // orig_w, orig_h and trans_mode are restored from the entry
+    SDL_Surface *get( const char *key, int *orig_w, int *orig_h, int *trans_mode );
+    void add( const char *key, SDL_Surface *surface, int orig_w, int orig_h, int trans_mode );
+    bool has( const char *key ); // no effect on LRU order or counters
+    void clear();
+
+    unsigned int getHits() const { return hits; }
+    unsigned int getMisses() const { return misses; }
+    size_t getUsage() const { return usage; }
+    int getNumEntries() const { return num_of_entries; }
+
+private:
+    enum { NUM_BUCKETS = 256 };
+
+    struct Entry{
+        char *key;
+        unsigned int hash;
+        SDL_Surface *surface;
+        size_t size;
+        int orig_w, orig_h;
+        int trans_mode;
+        Entry *prev, *next;   // LRU order, most recent first
+        Entry *bucket_next;
+    };
+
+    Entry *bucket[NUM_BUCKETS];
+    Entry *lru_head, *lru_tail;
+    int num_of_entries;
+    size_t budget, usage;
+    unsigned int hits, misses;
+
+    static unsigned int hashKey( const char *key );
+    Entry *find( const char *key, unsigned int hash );
+    void unlink( Entry *entry );
+    void pushFront( Entry *entry );
+    void evict( Entry *entry );
+};
+
+#endif // __IMAGE_CACHE_H__
@@ -359,20 +359,25 @@ void LUAHandler::init(ONScripterLabel *onsl, ScriptHandler *sh)
     lua_pushlightuserdata(state, this);
     lua_setglobal(state, ONS_LUA_HANDLER_PTR);
 
-    unsigned long length = sh->cBR->getFileLength(INIT_SCRIPT);
-    if (length == 0){
+    BaseReader::FileRef ref;
+    if (!sh->cBR->openFile(INIT_SCRIPT, ref)){
         printf("cannot open %s\n", INIT_SCRIPT);
         return;
     }
 
-    unsigned char *buffer = new unsigned char[length];
-    int location;
-    sh->cBR->getFile(INIT_SCRIPT, buffer, &location);
-    if (luaL_loadbuffer(state, (const char*)buffer, length, INIT_SCRIPT) || lua_pcall(state, 0, 0, 0)){
+    unsigned long length = ref.length;
+    const unsigned char *view = ref.view;
+    unsigned char *buffer = NULL;
+    if (!view){
+        buffer = new unsigned char[length];
+        sh->cBR->readFile(ref, buffer);
+        view = buffer;
+    }
+    if (luaL_loadbuffer(state, (const char*)view, length, INIT_SCRIPT) || lua_pcall(state, 0, 0, 0)){
         printf("cannot load %s\n", INIT_SCRIPT);
     }
 
-    delete[] buffer;
+    if (buffer) delete[] buffer;
 }
 
 void LUAHandler::addCallback(const char *label)
@@ -561,25 +561,29 @@ static void setStr( char **dst, const char *src, int num=-1 )
 static SDL_Surface *loadImage( char *file_name, bool *has_alpha, SDL_Surface *surface, BaseReader *br )
 {
     if ( !file_name ) return NULL;
-    unsigned long length = br->getFileLength( file_name );
-
-    if ( length == 0 )
+    BaseReader::FileRef ref;
+    if ( !br->openFile( file_name, ref ) )
         return NULL;
-    unsigned char *buffer = new unsigned char[length];
-    int location;
-    br->getFile( file_name, buffer, &location );
-    SDL_Surface *tmp = IMG_Load_RW(SDL_RWFromMem( buffer, length ), 1);
+    unsigned long length = ref.length;
+    const unsigned char *view = ref.view;
+    unsigned char *buffer = NULL;
+    if ( !view ){
+        buffer = new unsigned char[length];
+        br->readFile( ref, buffer );
+        view = buffer;
+    }
+    SDL_Surface *tmp = IMG_Load_RW(SDL_RWFromConstMem( view, length ), 1);
 
     char *ext = strrchr(file_name, '.');
     if ( !tmp && ext && (!strcmp( ext+1, "JPG" ) || !strcmp( ext+1, "jpg" ) ) ){
         fprintf( stderr, " *** force-loading a JPG image [%s]\n", file_name );
-        SDL_RWops *src = SDL_RWFromMem( buffer, length );
+        SDL_RWops *src = SDL_RWFromConstMem( view, length );
         tmp = IMG_LoadJPG_RW(src);
         SDL_RWclose(src);
     }
     if ( tmp && has_alpha ) *has_alpha = tmp->format->Amask;
 
-    delete[] buffer;
+    if ( buffer ) delete[] buffer;
     if ( !tmp ){
         fprintf( stderr, " *** can't load file [%s] ***\n", file_name );
         return NULL;
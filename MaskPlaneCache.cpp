@@ -0,0 +1,112 @@
+/* -*- C++ -*-
+ *
+ *  MaskPlaneCache.cpp - Effect masks expanded to screen-sized byte planes
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "MaskPlaneCache.h"
+#include <string.h>
+
+MaskPlaneCache::MaskPlaneCache()
+{
+    for ( int i=0 ; i<MAX_PLANES ; i++ ){
+        planes[i].name = NULL;
+        planes[i].mask_w = planes[i].mask_h = 0;
+        planes[i].w = planes[i].h = 0;
+        planes[i].data = NULL;
+        planes[i].last_use = 0;
+    }
+    use_count = 0;
+    hits = misses = 0;
+}
+
+MaskPlaneCache::~MaskPlaneCache()
+{
+    clear();
+}
+
+void MaskPlaneCache::clear()
+{
+    for ( int i=0 ; i<MAX_PLANES ; i++ )
+        freePlane( planes[i] );
+}
+
+void MaskPlaneCache::freePlane( Plane &plane )
+{
+    if ( plane.name ) delete[] plane.name;
+    if ( plane.data ) delete[] plane.data;
+    plane.name = NULL;
+    plane.data = NULL;
+    plane.last_use = 0;
+}
+
+const unsigned char *MaskPlaneCache::get( const char *name, SDL_Surface *mask, int w, int h )
+{
+    if ( name == NULL || mask == NULL ||
+         mask->format->BytesPerPixel != 4 || mask->w <= 0 || mask->h <= 0 )
+        return NULL;
+
+    use_count++;
+    Plane *oldest = &planes[0];
+    for ( int i=0 ; i<MAX_PLANES ; i++ ){
+        Plane &plane = planes[i];
+        if ( plane.name && !strcmp( plane.name, name ) &&
+             plane.mask_w == mask->w && plane.mask_h == mask->h &&
+             plane.w == w && plane.h == h ){
+            hits++;
+            plane.last_use = use_count;
+            return plane.data;
+        }
+        if ( plane.last_use < oldest->last_use ) oldest = &plane;
+    }
+
+    misses++;
+    freePlane( *oldest );
+    oldest->name = new char[strlen(name) + 1];
+    strcpy( oldest->name, name );
+    oldest->mask_w = mask->w;
+    oldest->mask_h = mask->h;
+    oldest->w = w;
+    oldest->h = h;
+    oldest->data = new unsigned char[w * h];
+    oldest->last_use = use_count;
+    build( oldest->data, mask, w, h );
+
+    return oldest->data;
+}
+
+// each row of the plane takes the blue channel of mask row y % mask->h,
+// repeated across the width
+void MaskPlaneCache::build( unsigned char *data, SDL_Surface *mask, int w, int h )
+{
+    SDL_LockSurface( mask );
+    const SDL_PixelFormat *fmt = mask->format;
+    for ( int y=0 ; y<h ; y++ ){
+        unsigned char *row = data + y * w;
+        if ( y >= mask->h ){
+            memcpy( row, data + (y % mask->h) * w, w );
+            continue;
+        }
+        const Uint32 *src = (const Uint32 *)((const Uint8 *)mask->pixels + y * mask->pitch);
+        int mw = mask->w < w ? mask->w : w;
+        for ( int x=0 ; x<mw ; x++ )
+            row[x] = (unsigned char)((src[x] & fmt->Bmask) >> fmt->Bshift);
+        for ( int x=mw ; x<w ; x+=mw )
+            memcpy( row + x, row, (w - x < mw) ? w - x : mw );
+    }
+    SDL_UnlockSurface( mask );
+}
@@ -0,0 +1,66 @@
+/* -*- C++ -*-
+ *
+ *  MaskPlaneCache.h - Effect masks expanded to screen-sized byte planes
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __MASK_PLANE_CACHE_H__
+#define __MASK_PLANE_CACHE_H__
+
+#include <SDL.h>
+
+// The mask effects (15 and 18) only look at the blue channel of the mask
+// image, tiled across the screen.  get() hands out that channel already
+// tiled to the screen size, one byte per pixel, and keeps the last few
+// planes around keyed by the mask's name and size.
+class MaskPlaneCache
+{
+public:
+    enum { MAX_PLANES = 4 };
+
+    MaskPlaneCache();
+    ~MaskPlaneCache();
+
+    // the plane stays valid until MAX_PLANES other masks have been asked
+    // for, or clear(); NULL if the mask has no name to key it by
+    const unsigned char *get( const char *name, SDL_Surface *mask, int w, int h );
+    void clear();
+
+    unsigned int getHits() const { return hits; }
+    unsigned int getMisses() const { return misses; }
+
+private:
+    MaskPlaneCache( const MaskPlaneCache & );
+    MaskPlaneCache& operator =( const MaskPlaneCache & );
+
+    struct Plane{
+        char *name;
+        int mask_w, mask_h;
+        int w, h;
+        unsigned char *data;
+        unsigned int last_use;
+    };
+
+    Plane planes[MAX_PLANES];
+    unsigned int use_count;
+    unsigned int hits, misses;
+
+    static void build( unsigned char *data, SDL_Surface *mask, int w, int h );
+    static void freePlane( Plane &plane );
+};
+
+#endif // __MASK_PLANE_CACHE_H__
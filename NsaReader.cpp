@@ -153,6 +153,7 @@ int NsaReader::processArchives( const PathProvider &provider )
     } else {
         num_of_nsa_archives = i+1;
         num_of_ns2_archives = k;
+        buildIndex();
         return 0;
     }
 }
@@ -202,118 +203,18 @@ const char *NsaReader::getArchiveName() const
     return "nsa";
 }
 
-int NsaReader::getNumFiles(){
-    int i;
-    int total = archive_info.num_of_files; // start with sar files, if any
-
-    total += archive_info_nsa.num_of_files; // add in the arc.nsa files
-
-    for ( i=0 ; i<num_of_nsa_archives-1 ; i++ ) total += archive_info2[i].num_of_files; // add in the arc?.nsa files
-
-    for ( i=0 ; i<num_of_ns2_archives ; i++ ) total += archive_info_ns2[i].num_of_files; // add in the ##.ns2 files
-
-    return total;
-}
-
-size_t NsaReader::getFileLengthSub( ArchiveInfo *ai, const char *file_name )
+void NsaReader::indexArchives()
 {
-    unsigned int i = getIndexFromFile( ai, file_name );
-
-    if ( i == ai->num_of_files ) return 0;
-
-    if ( ai->fi_list[i].original_length != 0 ){
-        return ai->fi_list[i].original_length;
-    }
-
-    int type = ai->fi_list[i].compression_type;
-    if ( type == NO_COMPRESSION )
-        type = getRegisteredCompressionType( file_name );
-    if ( type == NBZ_COMPRESSION || type == SPB_COMPRESSION ) {
-        ai->fi_list[i].original_length = getDecompressedFileLength( type, ai->file_handle, ai->fi_list[i].offset );
-    }
-    
-    return ai->fi_list[i].original_length;
-}
-
-size_t NsaReader::getFileLength( const char *file_name )
-{
-    size_t ret;
     int i;
-    
-#ifndef TOOLS_BUILD
-    // direct read
-    if ( ( ret = DirectReader::getFileLength( file_name ) ) ) return ret;
-#endif
-    // ns2 read
-    for ( i=0 ; i<num_of_ns2_archives ; i++ ){
-        if ( (ret = getFileLengthSub( &archive_info_ns2[i], file_name )) ) return ret;
-    }
-    
-    // nsa read
-    if ( ( ret = getFileLengthSub( &archive_info_nsa, file_name )) ) return ret;
-
-    // nsa? read
-    for ( i=0 ; i<num_of_nsa_archives-1 ; i++ ){
-        if ( (ret = getFileLengthSub( &archive_info2[i], file_name )) ) return ret;
-    }
-    
-    // sar read
-    if ( sar_flag ) return SarReader::getFileLength( file_name );
 
-    return 0;
-}
-
-size_t NsaReader::getFile( const char *file_name, unsigned char *buffer, int *location )
-{
-    size_t ret;
-
-    // direct read
-    if ( ( ret = DirectReader::getFile( file_name, buffer, location ) ) ) return ret;
-
-    // ns2 read
-    for ( int i=0 ; i<num_of_ns2_archives ; i++ ){
-        if ( (ret = getFileSub( &archive_info_ns2[i], file_name, buffer )) ){
-            if ( location ) *location = ARCHIVE_TYPE_NS2;
-            return ret;
-        }
-    }
+    // lookup priority: ns2, nsa, nsa?, then sar
+    for ( i=0 ; i<num_of_ns2_archives ; i++ )
+        addIndexArchive( &archive_info_ns2[i], ARCHIVE_TYPE_NS2 );
 
-    // nsa read
-    if ( (ret = getFileSub( &archive_info_nsa, file_name, buffer )) ){
-        if ( location ) *location = ARCHIVE_TYPE_NSA;
-        return ret;
-    }
+    addIndexArchive( &archive_info_nsa, ARCHIVE_TYPE_NSA );
 
-    // nsa? read
-    for ( int i=0 ; i<num_of_nsa_archives-1 ; i++ ){
-        if ( (ret = getFileSub( &archive_info2[i], file_name, buffer )) ){
-            if ( location ) *location = ARCHIVE_TYPE_NSA;
-            return ret;
-        }
-    }
-
-    // sar read
-    if ( sar_flag ) return SarReader::getFile( file_name, buffer, location );
-
-    return 0;
-}
-
-struct NsaReader::FileInfo NsaReader::getFileByIndex( unsigned int index )
-{
-    int i;
-    
-    for ( i=0 ; i<num_of_ns2_archives ; i++ ){
-        if ( index < archive_info_ns2[i].num_of_files ) return archive_info_ns2[i].fi_list[index];
-        index -= archive_info_ns2[i].num_of_files;
-    }
-    if ( index < archive_info_nsa.num_of_files ) return archive_info_nsa.fi_list[index];
-    index -= archive_info_nsa.num_of_files;
-
-    for ( i=0 ; i<num_of_nsa_archives-1 ; i++ ){
-        if ( index < archive_info2[i].num_of_files ) return archive_info2[i].fi_list[index];
-        index -= archive_info2[i].num_of_files;
-    }
-    fprintf( stderr, "NsaReader::getFileByIndex  Index %d is out of range\n", index );
+    for ( i=0 ; i<num_of_nsa_archives-1 ; i++ )
+        addIndexArchive( &archive_info2[i], ARCHIVE_TYPE_NSA );
 
-    return archive_info.fi_list[0];
+    if ( sar_flag ) SarReader::indexArchives();
 }
@@ -48,11 +48,6 @@ public:
     int processArchives( const PathProvider &provider );
 #endif
     const char *getArchiveName() const;
-    int getNumFiles();
-    
-    size_t getFileLength( const char *file_name );
-    size_t getFile( const char *file_name, unsigned char *buf, int *location=NULL );
-    struct FileInfo getFileByIndex( unsigned int index );
 
 #ifdef TOOLS_BUILD
     int openForConvert( const char *nsa_name, int archive_type=ARCHIVE_TYPE_NSA, int nsaoffset = 0 );
@@ -71,7 +66,7 @@ private:
     struct ArchiveInfo archive_info2[MAX_EXTRA_ARCHIVE]; // for the arc1.nsa, arc2.nsa files
     struct ArchiveInfo archive_info_ns2[MAX_NS2_ARCHIVE]; // for the ##.ns2 files
 
-    size_t getFileLengthSub( ArchiveInfo *ai, const char *file_name );
+    void indexArchives();
 };
 
 #endif // __NSA_READER_H__
@@ -141,6 +141,7 @@ static struct FuncLUT{
     {"split",   &ONScripterLabel::splitCommand},
     {"spclclk",   &ONScripterLabel::spclclkCommand},
     {"spbtn",   &ONScripterLabel::spbtnCommand},
+    {"soundpreload",   &ONScripterLabel::soundpreloadCommand},
     {"skipspeed", &ONScripterLabel::skipspeedCommand},
     {"skipoff",   &ONScripterLabel::skipoffCommand},
     {"shell",   &ONScripterLabel::shellCommand},
@@ -664,8 +665,10 @@ ONScripterLabel::ONScripterLabel()
   screenshot_surface(NULL), image_surface(NULL), tmp_image_buf(NULL),
   current_button_link(NULL), shelter_button_link(NULL),
   sprite_info(NULL), sprite2_info(NULL),
-  font_file(NULL), root_glyph_cache(NULL),
+  font_file(NULL), text_batch_area(NULL),
   string_buffer_breaks(NULL), string_buffer_margins(NULL),
+  string_buffer_px(NULL), string_buffer_px_n(NULL), string_buffer_px_len(0),
+  string_buffer_px_font(NULL),
   sin_table(NULL), cos_table(NULL), whirl_table(NULL),
   breakup_cells(NULL), breakup_cellforms(NULL), breakup_mask(NULL),
   shelter_select_link(NULL), default_cdrom_drive(NULL),
@@ -735,6 +738,39 @@ ONScripterLabel::ONScripterLabel()
 #else
     png_mask_type = PNG_MASK_USE_ALPHA;
 #endif
+    image_cache.setBudget( DEFAULT_IMAGE_CACHE_SIZE << 20 );
+    sound_cache.setBudget( DEFAULT_SOUND_CACHE_SIZE << 20 );
+    glyph_cache.setBudget( DEFAULT_GLYPH_CACHE_SIZE << 20 );
+    prefetch_flag = true;
+    prefetch_quit = false;
+    prefetch_thread = NULL;
+    prefetch_mutex = NULL;
+    prefetch_cond = NULL;
+    prefetch_pending = prefetch_running = prefetch_done = NULL;
+    num_prefetch_jobs = 0;
+    prefetch_scan_start = prefetch_scan_end = NULL;
+    prefetch_queued = prefetch_hits = 0;
+    compositor_threads = 0;
+    restore_images = NULL;
+    num_restore_images = 0;
+    restore_jobs = NULL;
+    num_restore_jobs = 0;
+    restore_threads = DEFAULT_RESTORE_THREADS;
+    effect_target_surface = NULL;
+    effect_mask_plane = NULL;
+    effect_mask_plane_surface = NULL;
+    effect_rect.x = effect_rect.y = 0;
+    effect_rect.w = effect_rect.h = 0;
+    effect_prerender_flag = false;
+    effect_prerender_thread = NULL;
+    for ( int j=0 ; j<EFFECT_PRERENDER_FRAMES ; j++ )
+        effect_frames[j] = NULL;
+    effect_prerender_link = NULL;
+    effect_prerender_no = 0;
+    music_stream_thread = NULL;
+    music_stream_underruns = 0;
+    effect_prerender_start = 0;
+    bilinear_sprites_flag = false;
     
     //init arrays
     int i=0;
@@ -775,6 +811,12 @@ ONScripterLabel::ONScripterLabel()
                 func |= CPUF_X86_SSE2;
                 printf("SSE2 ");
             }
+#ifdef USE_X86_AVX2_GFX
+            if (hasX86AVX2()) {
+                func |= CPUF_X86_AVX2;
+                printf("AVX2 ");
+            }
+#endif
             printf("\n");
         }
         setCpufuncs(func);
@@ -826,14 +868,11 @@ ONScripterLabel::ONScripterLabel()
     readColor( &linkcolor[1], "#88FF88" ); // cyan - mouseover link color
     sprite_info  = new AnimationInfo[MAX_SPRITE_NUM];
     sprite2_info = new AnimationInfo[MAX_SPRITE2_NUM];
+    sprite_index.setSize( MAX_SPRITE_NUM );
+    sprite2_index.setSize( MAX_SPRITE2_NUM );
 
     for (i=0 ; i<MAX_SPRITE2_NUM ; i++)
         sprite2_info[i].affine_flag = true;
-    for (i=0 ; i<NUM_GLYPH_CACHE ; i++){
-        if (i != NUM_GLYPH_CACHE-1) glyph_cache[i].next = &glyph_cache[i+1];
-    }
-    glyph_cache[NUM_GLYPH_CACHE-1].next = NULL;
-    root_glyph_cache = &glyph_cache[0];
 
     // External Players
     music_cmd = getenv("PLAYER_CMD");
@@ -842,6 +881,31 @@ ONScripterLabel::ONScripterLabel()
 
 ONScripterLabel::~ONScripterLabel()
 {
+    stopEffectPrerender();
+    stopPrefetch();
+    stopMusicStream();
+    compositor_pool.stop();
+    restore_pool.stop();
+    if (debug_level > 0){
+        printf("image cache: %u hits, %u misses, %d images (%lu bytes)\n",
+               image_cache.getHits(), image_cache.getMisses(),
+               image_cache.getNumEntries(),
+               (unsigned long)image_cache.getUsage());
+        printf("sound cache: %u hits, %u misses, %d sounds (%lu bytes)\n",
+               sound_cache.getHits(), sound_cache.getMisses(),
+               sound_cache.getNumEntries(),
+               (unsigned long)sound_cache.getUsage());
+        printf("image prefetch: %u of %u prefetched images used\n",
+               prefetch_hits, prefetch_queued);
+        printf("glyph cache: %u hits, %u misses, %d glyphs on %d pages (%lu bytes)\n",
+               glyph_cache.getHits(), glyph_cache.getMisses(),
+               glyph_cache.getNumEntries(), glyph_cache.getNumPages(),
+               (unsigned long)glyph_cache.getUsage());
+        printf("mask planes: %u hits, %u misses\n",
+               mask_planes.getHits(), mask_planes.getMisses());
+        printf("music stream: %u underruns\n", music_stream_underruns);
+    }
+
     reset();
 
     delete[] sprite_info;
@@ -1016,6 +1080,45 @@ void ONScripterLabel::setNoMovieUpscale()
     nomovieupscale_flag = true;
 }
 
+void ONScripterLabel::disablePrefetch()
+{
+    prefetch_flag = false;
+}
+
+void ONScripterLabel::setCompositorThreads(int num)
+{
+    if (num < 0) num = 0;
+    compositor_threads = num;
+}
+
+void ONScripterLabel::setRestoreThreads(int num)
+{
+    if (num < 0) num = 0;
+    restore_threads = num;
+}
+
+void ONScripterLabel::enableBilinearSprites()
+{
+    bilinear_sprites_flag = true;
+}
+
+void ONScripterLabel::enableEffectPrerender()
+{
+    effect_prerender_flag = true;
+}
+
+void ONScripterLabel::setImageCacheSize(int megabytes)
+{
+    if (megabytes < 0) megabytes = 0;
+    image_cache.setBudget( (size_t)megabytes << 20 );
+}
+
+void ONScripterLabel::setSoundCacheSize(int megabytes)
+{
+    if (megabytes < 0) megabytes = 0;
+    sound_cache.setBudget( (size_t)megabytes << 20 );
+}
+
 void ONScripterLabel::setGameIdentifier(const char *gameid)
 {
     setStr(&cmdline_game_id, gameid);
@@ -1163,7 +1266,9 @@ int ONScripterLabel::init()
         // insert save_path onto the front of archive_path
         DirPaths new_path = DirPaths(script_h.save_path);
         new_path.add(archive_path);
+        bool relist = archive_path.has_snapshot();
         archive_path = new_path;
+        if ( relist ) archive_path.snapshot();
     }
 
     // This function takes all of the screen resolution-setting
@@ -1205,9 +1310,20 @@ int ONScripterLabel::init()
     SDL_SetAlpha( effect_src_surface, 0, SDL_ALPHA_OPAQUE );
     SDL_SetAlpha( effect_dst_surface, 0, SDL_ALPHA_OPAQUE );
     SDL_SetAlpha( effect_tmp_surface, 0, SDL_ALPHA_OPAQUE );
+    effect_target_surface = accumulation_surface;
 
     num_loaded_images = 10; // to suppress temporal increase at the start-up
 
+    if ( prefetch_flag ) startPrefetch();
+    if ( compositor_threads > 0 &&
+         compositor_pool.start( compositor_threads ) < compositor_threads )
+        fprintf( stderr, "Warning: only started %d of %d compositor threads\n",
+                 compositor_pool.getNumThreads(), compositor_threads );
+    if ( restore_threads > 0 &&
+         restore_pool.start( restore_threads ) < restore_threads )
+        fprintf( stderr, "Warning: only started %d of %d restore threads\n",
+                 restore_pool.getNumThreads(), restore_threads );
+
     text_info.num_of_cells = 1;
     text_info.allocImage( screen_width, screen_height );
     text_info.fill(0, 0, 0, 0);
@@ -1437,6 +1553,11 @@ void ONScripterLabel::reset()
 
     if (string_buffer_breaks) delete[] string_buffer_breaks;
     string_buffer_breaks = NULL;
+    if (string_buffer_px) delete[] string_buffer_px;
+    if (string_buffer_px_n) delete[] string_buffer_px_n;
+    string_buffer_px = NULL;
+    string_buffer_px_n = NULL;
+    string_buffer_px_len = 0;
 
     resetSentenceFont();
 
@@ -1775,8 +1896,15 @@ void ONScripterLabel::flush( int refresh_mode, SDL_Rect *rect, bool clear_dirty_
     else{
         if ( rect ) dirty_rect.add( *rect );
 
-        if (dirty_rect.bounding_box.w * dirty_rect.bounding_box.h > 0)
-            flushDirect( dirty_rect.bounding_box, refresh_mode );
+        if (surround_rects) {
+            for (int i=0 ; i<dirty_rect.num_rects ; i++)
+                flushDirect( dirty_rect.rects[i], refresh_mode );
+        }
+        else if (dirty_rect.num_rects > 0) {
+            for (int i=0 ; i<dirty_rect.num_rects ; i++)
+                flushDirect( dirty_rect.rects[i], refresh_mode, false );
+            SDL_UpdateRects( screen_surface, dirty_rect.num_rects, dirty_rect.rects );
+        }
     }
 
     if ( clear_dirty_flag ) dirty_rect.clear();
@@ -2004,6 +2132,8 @@ void ONScripterLabel::executeLabel()
         if ( SDL_PumpEvents(), SDL_PeepEvents( NULL, 1, SDL_PEEKEVENT, SDL_QUITMASK) )
             endCommand();
 
+        if ( prefetch_thread ) prefetchImages();
+
         int ret = ScriptParser::parseLine();
         if ( ret == RET_NOMATCH ) ret = this->parseLine();
 
@@ -2319,7 +2449,7 @@ void ONScripterLabel::displayTextWindow( SDL_Surface *surface, SDL_Rect &clip )
         if ( rect.x + rect.w > surface->w ) rect.w = surface->w - rect.x;
         if ( rect.y + rect.h > surface->h ) rect.h = surface->h - rect.y;
 
-        SDL_LockSurface( surface );
+        if ( SDL_MUSTLOCK( surface ) ) SDL_LockSurface( surface );
         ONSBuf *buf = (ONSBuf *)surface->pixels + rect.y * surface->w + rect.x;
 
         SDL_PixelFormat *fmt = surface->format;
@@ -2337,7 +2467,7 @@ void ONScripterLabel::displayTextWindow( SDL_Surface *surface, SDL_Rect &clip )
             buf += surface->w - rect.w;
         }
 
-        SDL_UnlockSurface( surface );
+        if ( SDL_MUSTLOCK( surface ) ) SDL_UnlockSurface( surface );
     }
     else if ( sentence_font_info.image_surface ){
         drawTaggedSurface( surface, &sentence_font_info, clip );
@@ -2591,29 +2721,22 @@ void ONScripterLabel::loadEnvData()
 void ONScripterLabel::saveEnvData()
 {
     file_io_buf_ptr = 0;
-    bool output_flag = false;
-    for (int i=0 ; i<2 ; i++){
-        writeInt( fullscreen_mode?1:0, output_flag );
-        writeInt( volume_on_flag?1:0, output_flag );
-        writeInt( text_speed_no, output_flag );
-        writeInt( (skip_mode & SKIP_TO_EOP)?1:0, output_flag );
-        writeStr( default_env_font, output_flag );
-        writeInt( cdaudio_on_flag?1:0, output_flag );
-        writeStr( default_cdrom_drive, output_flag );
-        writeInt( DEFAULT_VOLUME - voice_volume, output_flag );
-        writeInt( DEFAULT_VOLUME - se_volume, output_flag );
-        writeInt( DEFAULT_VOLUME - music_volume, output_flag );
-        writeInt( kidokumode_flag?1:0, output_flag );
-        writeInt( bgmdownmode_flag?1:0, output_flag );
-        writeStr( savedir, output_flag );
-        writeInt( automode_time, output_flag );
-
-        if (i==1) break;
-        allocFileIOBuf();
-        output_flag = true;
-    }
-
-    saveFileIOBuf( "envdata" );
+    writeInt( fullscreen_mode?1:0, true );
+    writeInt( volume_on_flag?1:0, true );
+    writeInt( text_speed_no, true );
+    writeInt( (skip_mode & SKIP_TO_EOP)?1:0, true );
+    writeStr( default_env_font, true );
+    writeInt( cdaudio_on_flag?1:0, true );
+    writeStr( default_cdrom_drive, true );
+    writeInt( DEFAULT_VOLUME - voice_volume, true );
+    writeInt( DEFAULT_VOLUME - se_volume, true );
+    writeInt( DEFAULT_VOLUME - music_volume, true );
+    writeInt( kidokumode_flag?1:0, true );
+    writeInt( bgmdownmode_flag?1:0, true );
+    writeStr( savedir, true );
+    writeInt( automode_time, true );
+
+    updateFileIOBuf( "envdata", written_envdata );
 }
 
 int ONScripterLabel::refreshMode()
@@ -2626,6 +2749,11 @@ int ONScripterLabel::refreshMode()
 
 void ONScripterLabel::quit(bool no_error)
 {
+    stopEffectPrerender();
+    stopPrefetch();
+    stopMusicStream();
+    compositor_pool.stop();
+    restore_pool.stop();
     saveAll(no_error);
 
     if (async_movie) stopMovie(async_movie);
@@ -46,6 +46,14 @@
 #include "DirPaths.h"
 #include "ScriptParser.h"
 #include "DirtyRect.h"
+#include "ImageCache.h"
+#include "GlyphCache.h"
+#include "SpriteIndex.h"
+#include "WorkerPool.h"
+#include "EffectTileMap.h"
+#include "EffectFrameRing.h"
+#include "MaskPlaneCache.h"
+#include "SoundCache.h"
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
@@ -67,14 +75,51 @@
 #define MAX_PARAM_NUM 100
 #define MAX_EFFECT_NUM 256
 
+// megabytes of finished sprite images kept around for reuse
+#if defined(PDA)
+#define DEFAULT_IMAGE_CACHE_SIZE 8
+#else
+#define DEFAULT_IMAGE_CACHE_SIZE 64
+#endif
+// megabytes of decoded sound effects and voices kept around for reuse
+#if defined(PDA)
+#define DEFAULT_SOUND_CACHE_SIZE 4
+#else
+#define DEFAULT_SOUND_CACHE_SIZE 32
+#endif
+// script lines scanned ahead for image names, and decodes kept in flight
+#define PREFETCH_LOOKAHEAD_LINES 40
+#define MAX_PREFETCH_JOBS 16
+// images a saved game can ask for (cursors, window, bg, tachi, btndef and
+// sprites), and the extra threads decoding them while it loads
+#define MAX_RESTORE_IMAGES (MAX_SPRITE_NUM + MAX_SPRITE2_NUM + 8)
+#define DEFAULT_RESTORE_THREADS 2
+// shortest band of rows worth handing to a compositor thread
+#define MIN_COMPOSITE_BAND_HEIGHT 32
+// effect frames rendered ahead by --effect-prerender, and the spacing
+// between them in milliseconds
+#define EFFECT_PRERENDER_FRAMES 3
+#define EFFECT_PRERENDER_INTERVAL 16
+// how far ahead of the mixer a streaming ogg bgm is decoded, and the
+// bytes asked of the decoder at a time
+#define MUSIC_STREAM_MSEC 500
+#define MUSIC_STREAM_CHUNK 4096
+// bytes of a movie read ahead of SMPEG
+#if defined(PDA)
+#define MOVIE_READ_AHEAD_SIZE (1 << 20)
+#else
+#define MOVIE_READ_AHEAD_SIZE (8 << 20)
+#endif
+
 #define DEFAULT_VOLUME 100
 #define ONS_MIX_CHANNELS 50
-#define ONS_MIX_EXTRA_CHANNELS 5
+#define ONS_MIX_EXTRA_CHANNELS 6
 #define MIX_WAVE_CHANNEL (ONS_MIX_CHANNELS+0)
 #define MIX_CLICKVOICE_CHANNEL (ONS_MIX_CHANNELS+1)
 #define MIX_BGM_CHANNEL (ONS_MIX_CHANNELS+2)
 #define MIX_LOOPBGM_CHANNEL0 (ONS_MIX_CHANNELS+3)
 #define MIX_LOOPBGM_CHANNEL1 (ONS_MIX_CHANNELS+4)
+#define MIX_PRELOAD_CHANNEL (ONS_MIX_CHANNELS+5) // never played, see soundpreload
 
 #define FONT_DEFAULT_TTF 0
 #define FONT_DEFAULT_TTC 1
@@ -97,7 +142,12 @@
 #define DEFAULT_WM_TITLE "ONScripter-EN"
 #define DEFAULT_WM_ICON  "Ons-en"
 
-#define NUM_GLYPH_CACHE 30
+// megabytes of glyph atlas pages
+#if defined(PDA)
+#define DEFAULT_GLYPH_CACHE_SIZE 1
+#else
+#define DEFAULT_GLYPH_CACHE_SIZE 4
+#endif
 
 #define KEYPRESS_NULL ((SDLKey)(SDLK_LAST+1)) // "null" for keypress variables
 
@@ -149,6 +199,13 @@ public:
 #endif
     void setScaled();
     void setNoMovieUpscale();
+    void setImageCacheSize(int megabytes);
+    void setSoundCacheSize(int megabytes);
+    void disablePrefetch();
+    void setCompositorThreads(int num);
+    void setRestoreThreads(int num);
+    void enableBilinearSprites();
+    void enableEffectPrerender();
     inline void setStrict() { script_h.strict_warnings = true; }
     void setGameIdentifier(const char *gameid);
     enum {
@@ -216,6 +273,7 @@ public:
     int sp_rgb_gradationCommand();
     int spstrCommand();
     int spreloadCommand();
+    int soundpreloadCommand();
     int splitonceCommand();
     int splitCommand();
     int spclclkCommand();
@@ -759,6 +817,9 @@ private:
     /* ---------------------------------------- */
     /* General image-related variables */
     int png_mask_type;
+    ImageCache image_cache; // finished sprite surfaces, shared by refcount
+    bool makeImageCacheKey( AnimationInfo *anim, char *key, size_t len,
+                            float stretch_x=1.0, float stretch_y=1.0 );
 
     /* ---------------------------------------- */
     /* Background related variables */
@@ -774,6 +835,9 @@ private:
     /* Sprite related variables */
     AnimationInfo *sprite_info;
     AnimationInfo *sprite2_info;
+    SpriteIndex sprite_index, sprite2_index; // slots holding an image, in z order
+    void indexSprite( AnimationInfo *anim );
+    void pruneSpriteIndex( SpriteIndex &index, AnimationInfo *si );
     bool all_sprite_hide_flag;
     bool all_sprite2_hide_flag;
 
@@ -817,15 +881,8 @@ private:
     int  indent_offset;
     int  line_enter_status; // 0 - no enter, 1 - pretext, 2 - body start, 3 - within body
     int  page_enter_status; // 0 ... no enter, 1 ... body
-    struct GlyphCache{
-        GlyphCache *next;
-        Uint16 text;
-        TTF_Font *font;
-        SDL_Surface *surface;
-        GlyphCache()
-        : next(NULL), text(0), font(NULL), surface(NULL) {}
-        ~GlyphCache() { SDL_FreeSurface(surface); }
-    } *root_glyph_cache, glyph_cache[NUM_GLYPH_CACHE];
+    GlyphCache glyph_cache; // rendered glyphs, keyed on font/style/code
+    SDL_Rect *text_batch_area; // if set, drawChar grows this instead of dirty_rect
     int last_textpos_xy[2];
 
     int  refreshMode();
@@ -834,6 +891,8 @@ private:
     // from the full-width px and number of columns
 
     SDL_Surface *renderGlyph(TTF_Font *font, Uint16 text);
+    int glyphMetrics( TTF_Font *font, Uint16 text, int *minx, int *maxx,
+                      int *miny, int *maxy, int *advance );
     void drawGlyph( SDL_Surface *dst_surface, Fontinfo *info, SDL_Color &color, char *text, int xy[2], bool shadow_flag, AnimationInfo *cache_info, SDL_Rect *clip, SDL_Rect &dst_rect );
     void drawChar( char* text, Fontinfo *info, bool flush_flag, bool lookback_flag, SDL_Surface *surface, AnimationInfo *cache_info, int abs_offset=0, SDL_Rect *clip=NULL );
     void drawString( const char *str, uchar3 color, Fontinfo *info, bool flush_flag, SDL_Surface *surface, int abs_offset=0, SDL_Rect *rect = NULL, AnimationInfo *cache_info=NULL, bool skip_whitespace_flag=true );
@@ -860,6 +919,10 @@ private:
     //Mion: variables & functions for special text processing
     bool *string_buffer_breaks;  // can it break before a particular offset?
     char *string_buffer_margins; // where are the ruby margins, how long (in pixels)
+    float *string_buffer_px;     // findNextBreak's width for each offset, measured once per buffer
+    char *string_buffer_px_n;    // bytes each width covers; 0 if not measured yet
+    int string_buffer_px_len;
+    void *string_buffer_px_font; // the font those widths belong to
     bool line_has_nonspace;
     enum LineBreakType {
         SPACEBREAK = 1, // Western-style, break before spaces
@@ -890,6 +953,10 @@ private:
     int effect_start_time;
     int effect_start_time_old;
     int effect_tmp; //tmp variable for use by effect routines
+    EffectTileMap effect_tiles; // where effect_src_surface and effect_dst_surface differ
+    MaskPlaneCache mask_planes;
+    const unsigned char *effect_mask_plane; // blue channel of the current mask, screen-sized
+    SDL_Surface *effect_mask_plane_surface; // the mask it was taken from
     bool in_effect_blank;
     bool effectskip_flag;
     bool skip_effect;
@@ -919,6 +986,28 @@ private:
     void effectCascade( char *params, int duration );
     void effectTrvswave( char *params, int duration );
     void effectWhirl( char *params, int duration );
+    void renderEffectFrame( EffectLink *effect, int effect_no, bool first_time );
+    void finishEffect( int effect_no, bool clear_dirty_region );
+
+    /* Effect prerendering: once the effect surfaces are ready, a worker
+     * thread renders upcoming frames into a small ring of surfaces and
+     * doEffect only copies the one that is due to the screen */
+    SDL_Surface *effect_target_surface; // effect routines draw here
+    SDL_Rect effect_rect; // and redraw this much of it
+    bool effect_prerender_flag;
+    SDL_Thread *effect_prerender_thread;
+    EffectFrameRing effect_frame_ring;
+    SDL_Surface *effect_frames[EFFECT_PRERENDER_FRAMES];
+    EffectLink *effect_prerender_link;
+    int effect_prerender_no;
+    Uint32 effect_prerender_start;
+
+    bool canPrerenderEffect( int effect_no );
+    bool startEffectPrerender( EffectLink *effect, int effect_no );
+    void stopEffectPrerender();
+    bool presentEffectFrame( int effect_no, bool clear_dirty_region );
+    static int effectPrerenderThreadFunc( void *data );
+    void effectPrerenderThreadLoop();
 
     struct BreakupCell {
         int cell_x, cell_y;
@@ -1008,6 +1097,12 @@ private:
     int channelvolumes[ONS_MIX_CHANNELS]; //insani's addition
     bool channel_preloaded[ONS_MIX_CHANNELS]; //seems we need to track this...
     Mix_Chunk *wave_sample[ONS_MIX_CHANNELS+ONS_MIX_EXTRA_CHANNELS];
+    /* chunks for the dwave, wave, voice and click voice channels are
+     * shared through sound_cache; wave_sample slots give theirs back
+     * with freeChunk, never Mix_FreeChunk */
+    SoundCache sound_cache;
+    void freeChunk( Mix_Chunk *chunk );
+    bool isSoundCacheChannel( int channel );
 
     char *music_cmd;
     char *seqmusic_cmd;
@@ -1016,7 +1111,7 @@ private:
     void playCDAudio();
     int playWave(Mix_Chunk *chunk, int format, bool loop_flag, int channel);
     int playMP3();
-    int playOGG(int format, unsigned char *buffer, long length, bool loop_flag, int channel);
+    int playOGG(int format, unsigned char *buffer, long length, bool loop_flag, int channel, SDL_RWops *rw=NULL);
     int playExternalMusic(bool loop_flag);
     int playSequencedMusic(bool loop_flag);
     // Mion: for music status and fades
@@ -1032,9 +1127,21 @@ private:
     void stopDWAVE( int channel );
     void stopAllDWAVE();
     void playClickVoice();
-    OVInfo *openOggVorbis(unsigned char *buf, long len, int &channels, int &rate);
+    // reads rw, if given, instead of buf and closes it with the OVInfo
+    OVInfo *openOggVorbis(unsigned char *buf, long len, int &channels, int &rate, SDL_RWops *rw=NULL);
     int  closeOggVorbis(OVInfo *ovi);
 
+    /* a streaming ogg bgm is decoded and converted on its own thread,
+     * MUSIC_STREAM_MSEC ahead of the mixer; oggcallback only copies */
+    StreamRing music_ring;
+    SDL_Thread *music_stream_thread;
+    unsigned int music_stream_underruns;
+    bool startMusicStream();
+    void stopMusicStream();
+    bool decodeMusicStream();
+    static int musicStreamThreadFunc( void *data );
+    void musicStreamThreadLoop();
+
     /* ---------------------------------------- */
     /* Movie related variables */
     SMPEG *async_movie;
@@ -1095,20 +1202,109 @@ private:
     /* ---------------------------------------- */
     /* Image processing */
     SDL_Surface *loadImage(char *filename, bool *has_alpha=NULL);
+    SDL_Surface *convertLoadedImage(SDL_Surface *tmp, bool *has_alpha);
     SDL_Surface *createRectangleSurface(char *filename);
     SDL_Surface *createSurfaceFromFile(char *filename, int *location);
 
+    /* ---------------------------------------- */
+    /* Image prefetch: the main thread looks up upcoming image files named
+     * in the script and a worker thread reads and decodes them ahead of use */
+    struct PrefetchJob{
+        char *key; // same as the image cache key
+        char *file_name;
+        int trans_mode;
+        int num_of_cells;
+        uchar3 direct_color;
+        bool promote_alpha; // use TRANS_ALPHA if the image has an alpha channel
+        BaseReader::StreamSource src; // read by the worker, if src.fp is set
+        const unsigned char *view; // mapped entry data, decoded in place
+        unsigned char *buffer; // otherwise read on the main thread
+        size_t length;
+        SDL_Surface *surface; // decoded, alpha-processed, not yet resized
+        int orig_w, orig_h;
+        PrefetchJob *next;
+    };
+    bool prefetch_flag;
+    bool prefetch_quit;
+    SDL_Thread *prefetch_thread;
+    SDL_mutex *prefetch_mutex;
+    SDL_cond *prefetch_cond;
+    PrefetchJob *prefetch_pending, *prefetch_running, *prefetch_done;
+    int num_prefetch_jobs;
+    char *prefetch_scan_start, *prefetch_scan_end;
+    unsigned int prefetch_queued, prefetch_hits;
+
+    void startPrefetch();
+    void stopPrefetch();
+    void prefetchImages();
+    static void prefetchImageName( void *data, const char *cmd, const char *name );
+    void queuePrefetch( const char *cmd, const char *name );
+    bool isPrefetchQueued( const char *key );
+    SDL_Surface *takePrefetched( const char *key, AnimationInfo *anim );
+    PrefetchJob *readPrefetchJob( AnimationInfo *anim, const char *key );
+    void freePrefetchJob( PrefetchJob *job );
+    void decodePrefetchJob( PrefetchJob *job );
+    static int prefetchThreadFunc( void *data );
+    void prefetchThreadLoop();
+
+    /* ---------------------------------------- */
+    /* Save restoration: loadSaveFile2 first collects the images it needs
+     * and reads their files, then decodes them on restore_pool, and only
+     * then sets them up in their original order on the main thread */
+    struct RestoreImage{
+        AnimationInfo *anim; // NULL for the background
+        float stretch_x, stretch_y;
+    };
+    struct RestoreJob{
+        ONScripterLabel *ons;
+        PrefetchJob **jobs;
+    };
+    RestoreImage *restore_images;
+    int num_restore_images;
+    PrefetchJob *restore_jobs; // one per distinct image, freed by commitRestoreImages
+    int num_restore_jobs;
+    int restore_threads;
+    WorkerPool restore_pool;
+
+    void restoreImage( AnimationInfo *anim, float stretch_x=1.0, float stretch_y=1.0 );
+    void restoreBackground();
+    void queueRestoreJob( AnimationInfo *anim, float stretch_x, float stretch_y );
+    void decodeRestoreImages();
+    static void decodeRestoreJob( void *data, int job );
+    void commitRestoreImages();
+    SDL_Surface *takeRestored( const char *key, AnimationInfo *anim );
+
     void shiftCursorOnButton( int diff );
     void effectBlend( SDL_Surface *mask_surface, int trans_mode,
                       Uint32 mask_value = 255, SDL_Rect *clip=NULL,
                       SDL_Surface *src1=NULL, SDL_Surface *src2=NULL,
                       SDL_Surface *dst=NULL );
+    void effectBlendRect( SDL_Surface *mask_surface, int trans_mode,
+                          Uint32 mask_value, SDL_Rect &rect,
+                          SDL_Surface *src1, SDL_Surface *src2, SDL_Surface *dst );
     void alphaBlendText( SDL_Surface *dst_surface, SDL_Rect dst_rect,
                          SDL_Surface *txt_surface, SDL_Color &color,
                          SDL_Rect *clip, bool rotate_flag );
     void makeNegaSurface( SDL_Surface *surface, SDL_Rect &clip );
     void makeMonochromeSurface( SDL_Surface *surface, SDL_Rect &clip );
     void refreshSurface( SDL_Surface *surface, SDL_Rect *clip_src, int refresh_mode = REFRESH_NORMAL_MODE );
+    void compositeSurface( SDL_Surface *surface, SDL_Rect &clip, int refresh_mode );
+    bool isSpriteInClip( AnimationInfo *anim, SDL_Rect &clip );
+
+    /* Compositor threads: refreshSurface may split its clip rect into
+     * bands of rows and composite them side by side */
+    struct CompositeJob{
+        ONScripterLabel *ons;
+        SDL_Surface *surface;
+        SDL_Rect clip;
+        int refresh_mode;
+        int num_bands;
+    };
+    int compositor_threads;
+    WorkerPool compositor_pool;
+    bool bilinear_sprites_flag; // filter rotated/zoomed sprites (lsp2, drawsp2, etc.)
+    bool canCompositeInBands( SDL_Surface *surface, SDL_Rect &clip );
+    static void compositeBand( void *data, int band );
     void createBackground();
 
     /* ---------------------------------------- */
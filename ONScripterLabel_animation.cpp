@@ -190,6 +190,30 @@ void ONScripterLabel::resetCursorTime( int t )
     }
 }
 
+// describes everything setupAnimationInfo() bakes into a loaded image;
+// returns false for images that shouldn't be cached
+bool ONScripterLabel::makeImageCacheKey( AnimationInfo *anim, char *key, size_t len,
+                                         float stretch_x, float stretch_y )
+{
+    if ( !anim->file_name || anim->file_name[0] == '*' ) return false;
+
+    const char *mask = "";
+    if ( (anim->trans_mode == AnimationInfo::TRANS_MASK) && anim->mask_file_name )
+        mask = anim->mask_file_name;
+    int direct = 0;
+    if ( anim->trans_mode == AnimationInfo::TRANS_DIRECT )
+        direct = anim->direct_color[0] << 16 | anim->direct_color[1] << 8 |
+                 anim->direct_color[2];
+
+    int n = snprintf( key, len, "%s|%s|%d|%d|%06x|%d/%d|%d|%g,%g",
+                      anim->file_name, mask, anim->trans_mode,
+                      anim->num_of_cells, direct,
+                      screen_ratio1, screen_ratio2, disable_rescale_flag ? 1 : 0,
+                      stretch_x, stretch_y );
+
+    return (n > 0) && ((size_t)n < len);
+}
+
 #ifdef RCA_SCALE
 void ONScripterLabel::setupAnimationInfo( AnimationInfo *anim, Fontinfo *info,
                                           float stretch_x, float stretch_y )
@@ -197,6 +221,7 @@ void ONScripterLabel::setupAnimationInfo( AnimationInfo *anim, Fontinfo *info,
 void ONScripterLabel::setupAnimationInfo( AnimationInfo *anim, Fontinfo *info )
 #endif
 {
+    indexSprite( anim );
     if (anim->image_surface && !anim->stale_image) return;
 
     anim->deleteImage();
@@ -268,35 +293,60 @@ void ONScripterLabel::setupAnimationInfo( AnimationInfo *anim, Fontinfo *info )
     }
 #endif //ndef NO_LAYER_EFFECTS
     else {
-        bool has_alpha;
-        SDL_Surface *surface = loadImage( anim->file_name, &has_alpha );
+        char key[1024];
+#ifdef RCA_SCALE
+        bool use_cache = makeImageCacheKey( anim, key, sizeof(key), stretch_x, stretch_y );
+#else
+        bool use_cache = makeImageCacheKey( anim, key, sizeof(key) );
+#endif
+        SDL_Surface *surface = NULL;
+        bool did_resize = false;
 
-        // Not sure what this does
-        if (script_h.enc.getEncoding() == Encoding::CODE_UTF8 && has_alpha)
-            anim->trans_mode = AnimationInfo::TRANS_ALPHA;
+        int orig_w, orig_h, trans_mode;
+        if (use_cache)
+            surface = image_cache.get( key, &orig_w, &orig_h, &trans_mode );
+        if (surface){
+            anim->trans_mode = trans_mode;
+            anim->orig_pos.w = orig_w;
+            anim->orig_pos.h = orig_h;
+        }
+        else{
+            SDL_Surface *surface_m = NULL;
+            if (use_cache)
+                surface = takePrefetched( key, anim );
+            if (surface == NULL){
+                bool has_alpha;
+                surface = loadImage( anim->file_name, &has_alpha );
 
-        SDL_Surface *surface_m = NULL;
-        if (anim->trans_mode == AnimationInfo::TRANS_MASK)
-            surface_m = loadImage( anim->mask_file_name );
-        
+                // Not sure what this does
+                if (script_h.enc.getEncoding() == Encoding::CODE_UTF8 && has_alpha)
+                    anim->trans_mode = AnimationInfo::TRANS_ALPHA;
 
-        surface = anim->setupImageAlpha(surface, surface_m, has_alpha);
+                if (anim->trans_mode == AnimationInfo::TRANS_MASK)
+                    surface_m = loadImage( anim->mask_file_name );
+
+                surface = anim->setupImageAlpha(surface, surface_m, has_alpha);
+            }
 
-        bool did_resize = false;
 #ifdef RCA_SCALE
-        if (surface && ( (stretch_x > 1.0) || (stretch_y > 1.0) ||
-                         ((screen_ratio2 != screen_ratio1) && !disable_rescale_flag) )){
-            surface = anim->resize( surface, screen_ratio1, screen_ratio2, stretch_x, stretch_y );
+            if (surface && ( (stretch_x > 1.0) || (stretch_y > 1.0) ||
+                             ((screen_ratio2 != screen_ratio1) && !disable_rescale_flag) )){
+                surface = anim->resize( surface, screen_ratio1, screen_ratio2, stretch_x, stretch_y );
 #else
-        if (surface && (screen_ratio2 != screen_ratio1) && !disable_rescale_flag){
-            surface = anim->resize( surface, screen_ratio1, screen_ratio2 );
+            if (surface && (screen_ratio2 != screen_ratio1) && !disable_rescale_flag){
+                surface = anim->resize( surface, screen_ratio1, screen_ratio2 );
 #endif //RCA_SCALE
-            did_resize = true;
+                did_resize = true;
+            }
+
+            if ( surface_m ) SDL_FreeSurface(surface_m);
+
+            if (use_cache)
+                image_cache.add( key, surface, anim->orig_pos.w,
+                                 anim->orig_pos.h, anim->trans_mode );
         }
         anim->setImage( surface );
 
-        if ( surface_m ) SDL_FreeSurface(surface_m);
-
         if ((event_mode == IDLE_EVENT_MODE) &&
             ( did_resize || (trap_mode != TRAP_NONE) )) {
             // detect events from during image loading & resizing, but
@@ -524,7 +574,7 @@ void ONScripterLabel::drawTaggedSurface( SDL_Surface *dst_surface, AnimationInfo
                                   clip, anim->trans );
         else
             anim->blendOnSurface2( dst_surface, poly_rect.x, poly_rect.y,
-                                   clip, anim->trans );
+                                   clip, anim->trans, bilinear_sprites_flag );
 #ifndef NO_LAYER_EFFECTS
     } else if (anim->layer_no >= 0) {
         LayerInfo *tmp = layer_info;
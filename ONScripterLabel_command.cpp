@@ -156,7 +156,7 @@ int ONScripterLabel::wavestopCommand()
 {
     if ( audio_open_flag && wave_sample[MIX_WAVE_CHANNEL] ){
         Mix_Pause( MIX_WAVE_CHANNEL );
-        Mix_FreeChunk( wave_sample[MIX_WAVE_CHANNEL] );
+        freeChunk( wave_sample[MIX_WAVE_CHANNEL] );
         wave_sample[MIX_WAVE_CHANNEL] = NULL;
     }
     setStr( &wave_file_name, NULL );
@@ -604,6 +604,7 @@ int ONScripterLabel::sp_rgb_gradationCommand()
     AnimationInfo *si;
     if (no == -1) si = &sentence_font_info;
     else          si = &sprite_info[no];
+    si->unshareImage();
     SDL_Surface *surface = si->image_surface;
     if (surface == NULL) return RET_CONTINUE; //FIXME: alloc image instead?
 
@@ -851,6 +852,24 @@ int ONScripterLabel::spbtnCommand()
     return RET_CONTINUE;
 }
 
+int ONScripterLabel::soundpreloadCommand()
+{
+    // decode the listed sounds into sound_cache ahead of the scene that
+    // plays them; the chunks stay there for dwave and friends to pick up
+    bool more_args = true;
+    while (more_args){
+        const char *buf = script_h.readStr();
+        more_args = (script_h.getEndStatus() & ScriptHandler::END_COMMA) != 0;
+        if (sound_cache.getBudget() == 0) continue;
+
+        playSound(buf, SOUND_PRELOAD|SOUND_WAVE|SOUND_OGG, false, MIX_PRELOAD_CHANNEL);
+        freeChunk(wave_sample[MIX_PRELOAD_CHANNEL]);
+        wave_sample[MIX_PRELOAD_CHANNEL] = NULL;
+    }
+
+    return RET_CONTINUE;
+}
+
 int ONScripterLabel::skipspeedCommand()
 {
     if ( current_mode != DEFINE_MODE )
@@ -1443,6 +1462,9 @@ int ONScripterLabel::savescreenshotCommand()
         }
 
         SDL_SaveBMP( screenshot_surface, filename );
+        refreshFileSnapshot();
+        // the saved file may replace an image that was loaded earlier
+        image_cache.clear();
     }
     else
         printf("savescreenshot: file %s is not supported.\n", buf );
@@ -2315,12 +2337,12 @@ int ONScripterLabel::loopbgmstopCommand()
 {
     if ( wave_sample[MIX_LOOPBGM_CHANNEL0] ){
         Mix_Pause(MIX_LOOPBGM_CHANNEL0);
-        Mix_FreeChunk( wave_sample[MIX_LOOPBGM_CHANNEL0] );
+        freeChunk( wave_sample[MIX_LOOPBGM_CHANNEL0] );
         wave_sample[MIX_LOOPBGM_CHANNEL0] = NULL;
     }
     if ( wave_sample[MIX_LOOPBGM_CHANNEL1] ){
         Mix_Pause(MIX_LOOPBGM_CHANNEL1);
-        Mix_FreeChunk( wave_sample[MIX_LOOPBGM_CHANNEL1] );
+        freeChunk( wave_sample[MIX_LOOPBGM_CHANNEL1] );
         wave_sample[MIX_LOOPBGM_CHANNEL1] = NULL;
     }
     setStr(&loop_bgm_name[0], NULL);
@@ -3716,7 +3738,7 @@ int ONScripterLabel::drawsp3Command()
     }
 
     SDL_Rect clip = {0, 0, (Uint16)screen_surface->w, (Uint16)screen_surface->h};
-    si.blendOnSurface2( accumulation_surface, x, y, clip, alpha );
+    si.blendOnSurface2( accumulation_surface, x, y, clip, alpha, bilinear_sprites_flag );
     si.setCell(old_cell_no);
 
     return RET_CONTINUE;
@@ -3739,7 +3761,8 @@ int ONScripterLabel::drawsp2Command()
     si.setCell(cell_no);
 
     SDL_Rect clip = {0, 0, (Uint16)screen_surface->w, (Uint16)screen_surface->h};
-    si.blendOnSurface2( accumulation_surface, si.pos.x, si.pos.y, clip, alpha );
+    si.blendOnSurface2( accumulation_surface, si.pos.x, si.pos.y, clip, alpha,
+                        bilinear_sprites_flag );
 
     return RET_CONTINUE;
 }
@@ -3801,7 +3824,7 @@ int ONScripterLabel::drawbg2Command()
 
     SDL_Rect clip = {0, 0, (Uint16)screen_surface->w, (Uint16)screen_surface->h};
     bi.blendOnSurface2( accumulation_surface, bi.pos.x, bi.pos.y,
-                        clip, 256 );
+                        clip, 256, bilinear_sprites_flag );
 
     return RET_CONTINUE;
 }
@@ -4434,6 +4457,7 @@ int ONScripterLabel::btndefCommand()
 #else
             setupAnimationInfo( &btndef_info );
 #endif
+            btndef_info.unshareImage();
             SDL_SetAlpha( btndef_info.image_surface, DEFAULT_BLIT_FLAG, SDL_ALPHA_OPAQUE );
         }
     }
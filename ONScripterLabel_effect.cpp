@@ -44,6 +44,10 @@ bool ONScripterLabel::setEffect( EffectLink *effect, bool generate_effect_dst, b
 {
     if ( effect->effect == 0 ) return true;
 
+    effect_tiles.invalidate();
+    effect_mask_plane = NULL;
+    effect_mask_plane_surface = NULL;
+
     if (update_backup_surface)
         refreshSurface(backup_surface, &dirty_rect.bounding_box, REFRESH_NORMAL_MODE);
     
@@ -98,6 +102,12 @@ bool ONScripterLabel::setEffect( EffectLink *effect, bool generate_effect_dst, b
             setupAnimationInfo( &effect->anim );
 #endif
         }
+#if !defined(BPP16)
+        effect_mask_plane = mask_planes.get( effect->anim.image_name,
+                                             effect->anim.image_surface,
+                                             screen_width, screen_height );
+        effect_mask_plane_surface = effect->anim.image_surface;
+#endif
     }
     if ( effect_no == 11 || effect_no == 12 || effect_no == 13 || effect_no == 14 ||
          effect_no == 16 || effect_no == 17 )
@@ -134,11 +144,31 @@ bool ONScripterLabel::setEffect( EffectLink *effect, bool generate_effect_dst, b
         }
     }
 
+    // fades only need to blend where the two images differ
+    if ( effect_no == 10 || effect_no == 15 || effect_no == 18 ||
+         (effect_no == 99 && !(dll && (!strncmp(dll, "cascade.dll", 11) ||
+                                       !strncmp(dll, "breakup.dll", 11)))) ){
+        SDL_LockSurface( effect_src_surface );
+        SDL_LockSurface( effect_dst_surface );
+        effect_tiles.compare( (unsigned char *)effect_src_surface->pixels,
+                              (unsigned char *)effect_dst_surface->pixels,
+                              effect_src_surface->pitch, sizeof(ONSBuf),
+                              screen_width, screen_height, dirty_rect.bounding_box );
+        SDL_UnlockSurface( effect_dst_surface );
+        SDL_UnlockSurface( effect_src_surface );
+        if (debug_level > 0)
+            printf("effect tiles: %d of %d differ\n", effect_tiles.getNumChanged(),
+                   effect_tiles.getTilesW() * effect_tiles.getTilesH());
+    }
+
     return false;
 }
 
 bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
 {
+    if ( effect_prerender_thread )
+        return presentEffectFrame( effect_prerender_no, clear_dirty_region );
+
     bool first_time = (effect_counter == 0);
 
     effect_start_time = SDL_GetTicks();
@@ -156,6 +186,51 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
 
     skip_effect = false;
 
+    /* ---------------------------------------- */
+    /* Execute effect */
+    if (debug_level > 0 && first_time)
+        printf("Effect number %d, %d ms\n", effect_no, effect_duration );
+
+    if ( first_time && effect_prerender_flag &&
+         canPrerenderEffect( effect_no ) &&
+         startEffectPrerender( effect, effect_no ) )
+        return presentEffectFrame( effect_no, clear_dirty_region );
+
+    effect_rect = dirty_rect.bounding_box;
+    renderEffectFrame( effect, effect_no, first_time );
+
+    if (debug_level > 1)
+        printf("\teffect count %d / dur %d\n", effect_counter, effect_duration);
+
+    effect_counter += effect_timer_resolution;
+
+    //check for events before drawing
+    event_mode = IDLE_EVENT_MODE;
+    event_mode |= WAIT_NO_ANIM_MODE;
+    if (effectskip_flag) {
+        event_mode |= WAIT_INPUT_MODE;
+    }
+    waitEvent(0);
+    event_mode &= ~(WAIT_NO_ANIM_MODE | WAIT_INPUT_MODE);
+
+    if ( effect_counter < effect_duration && effect_no != 1 ){
+        if ( effect_no != 0 ) flush( REFRESH_NONE_MODE, NULL, false );
+
+        if (effectskip_flag && skip_effect)
+            effect_counter = effect_duration;
+
+        return true;
+    }
+    else {
+        //last call
+        finishEffect( effect_no, clear_dirty_region );
+        return false;
+    }
+}
+
+// draws the frame at effect_counter into effect_target_surface
+void ONScripterLabel::renderEffectFrame( EffectLink *effect, int effect_no, bool first_time )
+{
     int i, amp;
     int width, width2;
     int height, height2;
@@ -163,11 +238,6 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
     SDL_Rect dst_rect={0, 0, (Uint16)screen_width, (Uint16)screen_height};
     SDL_Rect quake_rect={0, 0, (Uint16)screen_width, (Uint16)screen_height};
 
-    /* ---------------------------------------- */
-    /* Execute effect */
-    if (debug_level > 0 && first_time)
-        printf("Effect number %d, %d ms\n", effect_no, effect_duration );
-
     bool not_implemented = false;
     switch ( effect_no ){
       case 0: // Instant display
@@ -287,7 +357,7 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
         // fall through
       case 10: // Cross fade
         height = 256 * effect_counter / effect_duration;
-        effectBlend( NULL, ALPHA_BLEND_CONST, height, &dirty_rect.bounding_box );
+        effectBlend( NULL, ALPHA_BLEND_CONST, height, &effect_rect, NULL, NULL, effect_target_surface );
         break;
 
       case 11: // Left scroll
@@ -359,7 +429,7 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
         break;
 
       case 15: // Fade with mask
-        effectBlend( effect->anim.image_surface, ALPHA_BLEND_FADE_MASK, 256 * effect_counter / effect_duration, &dirty_rect.bounding_box );
+        effectBlend( effect->anim.image_surface, ALPHA_BLEND_FADE_MASK, 256 * effect_counter / effect_duration, &effect_rect, NULL, NULL, effect_target_surface );
         break;
 
       case 16: // Mosaic out
@@ -371,7 +441,7 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
         break;
 
       case 18: // Cross fade with mask
-        effectBlend( effect->anim.image_surface, ALPHA_BLEND_CROSSFADE_MASK, 256 * effect_counter * 2 / effect_duration, &dirty_rect.bounding_box );
+        effectBlend( effect->anim.image_surface, ALPHA_BLEND_CROSSFADE_MASK, 256 * effect_counter * 2 / effect_duration, &effect_rect, NULL, NULL, effect_target_surface );
         break;
 
       case (MAX_EFFECT_NUM + 0): // quakey
@@ -391,7 +461,7 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
             quake_rect.y = screen_height + amp;
             quake_rect.h = -amp;
         }
-        SDL_FillRect( accumulation_surface, &quake_rect, SDL_MapRGBA( accumulation_surface->format, 0, 0, 0, 0xff ) );
+        SDL_FillRect( effect_target_surface, &quake_rect, SDL_MapRGBA( effect_target_surface->format, 0, 0, 0, 0xff ) );
         break;
 
       case (MAX_EFFECT_NUM + 1): // quakex
@@ -411,13 +481,13 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
             quake_rect.x = screen_width + amp;
             quake_rect.w = -amp;
         }
-        SDL_FillRect( accumulation_surface, &quake_rect, SDL_MapRGBA( accumulation_surface->format, 0, 0, 0, 0xff ) );
+        SDL_FillRect( effect_target_surface, &quake_rect, SDL_MapRGBA( effect_target_surface->format, 0, 0, 0, 0xff ) );
         break;
 
       case (MAX_EFFECT_NUM + 2 ): // quake
         dst_rect.x = effect->no*((int)(3.0*rand()/(RAND_MAX+1.0)) - 1) * 2;
         dst_rect.y = effect->no*((int)(3.0*rand()/(RAND_MAX+1.0)) - 1) * 2;
-        SDL_FillRect( accumulation_surface, NULL, SDL_MapRGBA( accumulation_surface->format, 0, 0, 0, 0xff ) );
+        SDL_FillRect( effect_target_surface, NULL, SDL_MapRGBA( effect_target_surface->format, 0, 0, 0, 0xff ) );
         drawEffect(&dst_rect, &src_rect, effect_dst_surface);
         break;
 
@@ -427,7 +497,7 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
             height = 30 * (effect_counter + effect_timer_resolution) / effect_duration;
             if (height > width){
                 doFlushout(height);
-                effectBlend( NULL, ALPHA_BLEND_CONST, effect_counter * 256 / effect_duration, &dirty_rect.bounding_box, effect_tmp_surface );
+                effectBlend( NULL, ALPHA_BLEND_CONST, effect_counter * 256 / effect_duration, &effect_rect, effect_tmp_surface, NULL, effect_target_surface );
             }
         }
         break;
@@ -463,59 +533,36 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
         if (not_implemented) {
             // do crossfade
             height = 256 * effect_counter / effect_duration;
-            effectBlend( NULL, ALPHA_BLEND_CONST, height, &dirty_rect.bounding_box );
+            effectBlend( NULL, ALPHA_BLEND_CONST, height, &effect_rect, NULL, NULL, effect_target_surface );
         }
         break;
     }
+}
 
-    if (debug_level > 1)
-        printf("\teffect count %d / dur %d\n", effect_counter, effect_duration);
-
-    effect_counter += effect_timer_resolution;
-
-    //check for events before drawing
-    event_mode = IDLE_EVENT_MODE;
-    event_mode |= WAIT_NO_ANIM_MODE;
-    if (effectskip_flag) {
-        event_mode |= WAIT_INPUT_MODE;
-    }
-    waitEvent(0);
-    event_mode &= ~(WAIT_NO_ANIM_MODE | WAIT_INPUT_MODE);
-
-    if ( effect_counter < effect_duration && effect_no != 1 ){
-        if ( effect_no != 0 ) flush( REFRESH_NONE_MODE, NULL, false );
-
-        if (effectskip_flag && skip_effect)
-            effect_counter = effect_duration;
-
-        return true;
+void ONScripterLabel::finishEffect( int effect_no, bool clear_dirty_region )
+{
+    effect_tiles.invalidate();
+    SDL_BlitSurface(effect_dst_surface, &dirty_rect.bounding_box,
+                    accumulation_surface, &dirty_rect.bounding_box);
+
+    if (effect_no != 0)
+        flush(REFRESH_NONE_MODE, NULL, clear_dirty_region);
+    if (effect_no == 1)
+        effect_counter = 0;
+    else if ((effect_no == 99) && (dll != NULL)){
+        dll = params = NULL;
     }
-    else {
-        //last call
-        SDL_BlitSurface(effect_dst_surface, &dirty_rect.bounding_box,
-                        accumulation_surface, &dirty_rect.bounding_box);
-
-        if (effect_no != 0)
-            flush(REFRESH_NONE_MODE, NULL, clear_dirty_region);
-        if (effect_no == 1)
-            effect_counter = 0;
-        else if ((effect_no == 99) && (dll != NULL)){
-            dll = params = NULL;
-        }
 
-        display_mode &= ~DISPLAY_MODE_UPDATED;
+    display_mode &= ~DISPLAY_MODE_UPDATED;
 
-        if (effect_blank != 0 && effect_counter != 0) {
-            event_mode = WAIT_TIMER_MODE;
-            if ( ctrl_pressed_status || (skip_mode & SKIP_TO_WAIT) )
-                waitEvent(1); //allow a moment to detect ctrl unpress, if any
-            else
-                waitEvent(effect_blank);
-        }
-        event_mode = IDLE_EVENT_MODE;
-
-        return false;
+    if (effect_blank != 0 && effect_counter != 0) {
+        event_mode = WAIT_TIMER_MODE;
+        if ( ctrl_pressed_status || (skip_mode & SKIP_TO_WAIT) )
+            waitEvent(1); //allow a moment to detect ctrl unpress, if any
+        else
+            waitEvent(effect_blank);
     }
+    event_mode = IDLE_EVENT_MODE;
 }
 
 // TODO: Remove when GCC bug is resolved: https://gcc.gnu.org/bugzilla/show_bug.cgi?id=110091
@@ -524,7 +571,7 @@ bool ONScripterLabel::doEffect( EffectLink *effect, bool clear_dirty_region )
 void ONScripterLabel::drawEffect(SDL_Rect *dst_rect, SDL_Rect *src_rect, SDL_Surface *surface)
 {
     SDL_Rect clipped_rect;
-    if (AnimationInfo::doClipping(dst_rect, &dirty_rect.bounding_box, &clipped_rect)) return;
+    if (AnimationInfo::doClipping(dst_rect, &effect_rect, &clipped_rect)) return;
     if (src_rect != dst_rect){
         src_rect->x += clipped_rect.x;
         src_rect->y += clipped_rect.y;
@@ -532,7 +579,7 @@ void ONScripterLabel::drawEffect(SDL_Rect *dst_rect, SDL_Rect *src_rect, SDL_Sur
         src_rect->h = clipped_rect.h;
     }
 
-    SDL_BlitSurface(surface, src_rect, accumulation_surface, dst_rect);
+    SDL_BlitSurface(surface, src_rect, effect_target_surface, dst_rect);
 }
 #pragma GCC diagnostic pop
 
@@ -543,18 +590,18 @@ void ONScripterLabel::generateMosaic( SDL_Surface *src_surface, int level )
     for ( i=0 ; i<level ; i++ ) width >>= 1;
 
 #ifdef BPP16
-    int total_width = accumulation_surface->pitch / 2;
+    int total_width = effect_target_surface->pitch / 2;
 #else
-    int total_width = accumulation_surface->pitch / 4;
+    int total_width = effect_target_surface->pitch / 4;
 #endif
     SDL_LockSurface( src_surface );
-    SDL_LockSurface( accumulation_surface );
+    SDL_LockSurface( effect_target_surface );
     ONSBuf *src_buffer = (ONSBuf *)src_surface->pixels;
 
     for ( i=screen_height-1 ; i>=0 ; i-=width ){
         for ( j=0 ; j<screen_width ; j+=width ){
             ONSBuf p = src_buffer[ i*total_width+j ];
-            ONSBuf *dst_buffer = (ONSBuf *)accumulation_surface->pixels + i*total_width + j;
+            ONSBuf *dst_buffer = (ONSBuf *)effect_target_surface->pixels + i*total_width + j;
 
             int height2 = width;
             if (i+1-width < 0) height2 = i+1;
@@ -569,7 +616,7 @@ void ONScripterLabel::generateMosaic( SDL_Surface *src_surface, int level )
         }
     }
 
-    SDL_UnlockSurface( accumulation_surface );
+    SDL_UnlockSurface( effect_target_surface );
     SDL_UnlockSurface( src_surface );
 }
 
@@ -580,15 +627,15 @@ void ONScripterLabel::doFlushout( int level )
     int i, j, ii, jj;
 
 #ifdef BPP16
-    int total_width = accumulation_surface->pitch / 2;
+    int total_width = effect_target_surface->pitch / 2;
 #else
-    int total_width = accumulation_surface->pitch / 4;
+    int total_width = effect_target_surface->pitch / 4;
 #endif
     SDL_LockSurface( effect_src_surface );
-    SDL_LockSurface( accumulation_surface );
+    SDL_LockSurface( effect_target_surface );
     ONSBuf *src_buffer = (ONSBuf *)effect_src_surface->pixels;
 
-    ONSBuf *dst_buffer = (ONSBuf *)accumulation_surface->pixels;
+    ONSBuf *dst_buffer = (ONSBuf *)effect_target_surface->pixels;
     const int factor = 32;
     const int maxlevel = 30;
     level += factor - maxlevel;
@@ -602,7 +649,188 @@ void ONScripterLabel::doFlushout( int level )
         }
     }
 
-    SDL_UnlockSurface( accumulation_surface );
+    SDL_UnlockSurface( effect_target_surface );
     SDL_UnlockSurface( effect_src_surface );
-    effectBlend( NULL, ALPHA_BLEND_CONST, 64, &dirty_rect.bounding_box, effect_tmp_surface, accumulation_surface, effect_tmp_surface );
+    effectBlend( NULL, ALPHA_BLEND_CONST, 64, &effect_rect, effect_tmp_surface, effect_target_surface, effect_tmp_surface );
+}
+
+/* ---------------------------------------- */
+/* Effect prerendering */
+
+// effects whose frames depend only on effect_counter and the frames
+// before them; quakes shake at random and get drawn as they go
+bool ONScripterLabel::canPrerenderEffect( int effect_no )
+{
+    if ( effect_duration <= 0 ) return false;
+
+    if ( effect_no >= 2 && effect_no <= 18 ) return true;
+    if ( effect_no == MAX_EFFECT_NUM + 3 ) return true; // flushout
+    if ( effect_no == 99 && dll != NULL )
+        return ( !strncmp(dll, "cascade.dll", 11) ||
+                 !strncmp(dll, "whirl.dll", 9) ||
+                 !strncmp(dll, "trvswave.dll", 12) ||
+                 !strncmp(dll, "breakup.dll", 11) );
+
+    return false;
+}
+
+// the ring surfaces are software surfaces that are read on one thread
+// while written on the other; SDL_BlitSurface would rebuild their blit
+// maps as it goes, so frames are moved with plain row copies instead
+static void copyEffectFrame( SDL_Surface *src, SDL_Surface *dst, const SDL_Rect &rect )
+{
+    int x = rect.x, y = rect.y, w = rect.w, h = rect.h;
+    if ( x < 0 ){ w += x; x = 0; }
+    if ( y < 0 ){ h += y; y = 0; }
+    if ( x + w > src->w ) w = src->w - x;
+    if ( x + w > dst->w ) w = dst->w - x;
+    if ( y + h > src->h ) h = src->h - y;
+    if ( y + h > dst->h ) h = dst->h - y;
+    if ( w <= 0 || h <= 0 ) return;
+
+    int bpp = src->format->BytesPerPixel;
+    unsigned char *s = (unsigned char *)src->pixels + y * src->pitch + x * bpp;
+    unsigned char *d = (unsigned char *)dst->pixels + y * dst->pitch + x * bpp;
+    for ( int i=0 ; i<h ; i++ ){
+        memcpy( d, s, w * bpp );
+        s += src->pitch;
+        d += dst->pitch;
+    }
+}
+
+bool ONScripterLabel::startEffectPrerender( EffectLink *effect, int effect_no )
+{
+    int i;
+    for ( i=0 ; i<EFFECT_PRERENDER_FRAMES ; i++ ){
+        if ( effect_frames[i] == NULL ){
+            effect_frames[i] = AnimationInfo::allocSurface( screen_width, screen_height );
+            if ( effect_frames[i] == NULL ) return false;
+            SDL_SetAlpha( effect_frames[i], 0, SDL_ALPHA_OPAQUE );
+        }
+    }
+    if ( effect_frame_ring.getSize() == 0 &&
+         !effect_frame_ring.open( EFFECT_PRERENDER_FRAMES ) )
+        return false;
+    effect_frame_ring.reset();
+
+    // the worker draws every frame over this much of the screen, and the
+    // main thread may change dirty_rect meanwhile, so it is fixed here
+    effect_rect = dirty_rect.bounding_box;
+
+    // the first frame is drawn over a copy of the current screen, each
+    // later one over a copy of the frame before it, just like the
+    // synchronous effects draw over accumulation_surface
+    copyEffectFrame( accumulation_surface, effect_frames[EFFECT_PRERENDER_FRAMES-1],
+                     effect_rect );
+
+    effect_prerender_link = effect;
+    effect_prerender_no = effect_no;
+    effect_prerender_start = SDL_GetTicks();
+
+    effect_prerender_thread = SDL_CreateThread( effectPrerenderThreadFunc, this );
+    if ( effect_prerender_thread == NULL ){
+        fprintf( stderr, "Warning: couldn't start the effect prerender thread\n" );
+        return false;
+    }
+
+    return true;
+}
+
+void ONScripterLabel::stopEffectPrerender()
+{
+    if ( effect_prerender_thread == NULL ) return;
+
+    effect_frame_ring.cancel();
+    SDL_WaitThread( effect_prerender_thread, NULL );
+    effect_prerender_thread = NULL;
+
+    effect_target_surface = accumulation_surface;
+    effect_prerender_link = NULL;
+}
+
+// main thread side of a prerendered effect: show the newest frame that is
+// due (waiting for it if it is a little early), then handle events the
+// same way the synchronous path does
+bool ONScripterLabel::presentEffectFrame( int effect_no, bool clear_dirty_region )
+{
+    int elapsed = SDL_GetTicks() - effect_prerender_start;
+    int frame = -1;
+
+    if ( elapsed < effect_duration )
+        frame = effect_frame_ring.acquire( elapsed );
+
+    if ( frame >= 0 ){
+        int early = effect_frame_ring.getCounter( frame ) - elapsed;
+        if ( early > EFFECT_PRERENDER_INTERVAL ) early = EFFECT_PRERENDER_INTERVAL;
+        if ( early > 0 ) SDL_Delay( early );
+
+        copyEffectFrame( effect_frames[ effect_frame_ring.getSlot( frame ) ],
+                         accumulation_surface, effect_rect );
+        effect_frame_ring.release( frame );
+    }
+    else if ( elapsed < effect_duration ){
+        // every frame is out, only the final image is left to show
+        int wait = effect_duration - elapsed;
+        if ( wait > EFFECT_PRERENDER_INTERVAL ) wait = EFFECT_PRERENDER_INTERVAL;
+        SDL_Delay( wait );
+    }
+
+    //check for events before drawing
+    event_mode = IDLE_EVENT_MODE;
+    event_mode |= WAIT_NO_ANIM_MODE;
+    if (effectskip_flag) {
+        event_mode |= WAIT_INPUT_MODE;
+    }
+    waitEvent(0);
+    event_mode &= ~(WAIT_NO_ANIM_MODE | WAIT_INPUT_MODE);
+
+    if ( (int)(SDL_GetTicks() - effect_prerender_start) < effect_duration &&
+         !(effectskip_flag && skip_effect) ){
+        if ( frame >= 0 ) flush( REFRESH_NONE_MODE, NULL, false );
+        return true;
+    }
+
+    //last call
+    stopEffectPrerender();
+    effect_counter = effect_duration;
+    finishEffect( effect_no, clear_dirty_region );
+
+    return false;
+}
+
+int ONScripterLabel::effectPrerenderThreadFunc( void *data )
+{
+    ((ONScripterLabel*)data)->effectPrerenderThreadLoop();
+    return 0;
+}
+
+// runs on the prerender thread: while it is alive the main thread leaves
+// effect_counter, effect_rect, effect_target_surface and the effect
+// surfaces alone
+void ONScripterLabel::effectPrerenderThreadLoop()
+{
+    int counter = 0, prev_counter = 0;
+    int seq;
+
+    while ( (seq = effect_frame_ring.beginFrame()) >= 0 ){
+        SDL_Surface *frame = effect_frames[ effect_frame_ring.getSlot( seq ) ];
+        SDL_Surface *prev = effect_frames[ effect_frame_ring.getSlot( seq + EFFECT_PRERENDER_FRAMES - 1 ) ];
+        copyEffectFrame( prev, frame, effect_rect );
+
+        effect_counter = counter;
+        effect_timer_resolution = counter - prev_counter;
+        effect_target_surface = frame;
+        renderEffectFrame( effect_prerender_link, effect_prerender_no, seq == 0 );
+
+        // the next frame is due one interval later, or right away if
+        // rendering has fallen behind the clock
+        prev_counter = counter;
+        counter += EFFECT_PRERENDER_INTERVAL;
+        int elapsed = SDL_GetTicks() - effect_prerender_start;
+        if ( counter < elapsed ) counter = elapsed;
+
+        bool last = ( counter >= effect_duration );
+        effect_frame_ring.endFrame( seq, prev_counter, last );
+        if ( last ) break;
+    }
 }
@@ -234,8 +234,8 @@ void ONScripterLabel::effectBreakup( char* /*params*/, int duration )
         x_dir = -x_dir;
         y_dir = -y_dir;
     }
-    SDL_BlitSurface(bg, NULL, accumulation_surface, NULL);
-    SDL_Surface *dst = accumulation_surface;
+    SDL_BlitSurface(bg, NULL, effect_target_surface, NULL);
+    SDL_Surface *dst = effect_target_surface;
 
     if (breakup_mode & BREAKUP_MODE_JUMBLE) {
         x_dir = -x_dir;
@@ -316,6 +316,6 @@ void ONScripterLabel::effectBreakup( char* /*params*/, int duration )
         }
     }
 
-    SDL_UnlockSurface( accumulation_surface );
+    SDL_UnlockSurface( effect_target_surface );
     SDL_UnlockSurface( chr );
 }
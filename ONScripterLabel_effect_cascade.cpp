@@ -65,7 +65,7 @@ void ONScripterLabel::effectCascade( char *params, int duration )
     if (mode & CASCADE_CROSS)
         dst_surface = effect_tmp_surface;
     else
-        dst_surface = accumulation_surface;
+        dst_surface = effect_target_surface;
 
     if (effect_counter == 0)
         effect_tmp = 0;
@@ -93,10 +93,10 @@ void ONScripterLabel::effectCascade( char *params, int duration )
                 dst_rect.x = start;
             }
             src_rect.x = 0;
-            SDL_BlitSurface(effect_src_surface, &dst_rect, accumulation_surface, &src_rect);
+            SDL_BlitSurface(effect_src_surface, &dst_rect, effect_target_surface, &src_rect);
             for (int i=start; i<end; i++) {
                 dst_rect.x = i;
-                SDL_BlitSurface(accumulation_surface, &src_rect, effect_src_surface, &dst_rect);
+                SDL_BlitSurface(effect_target_surface, &src_rect, effect_src_surface, &dst_rect);
             }
         }
         if (mode & CASCADE_DIR) {
@@ -147,10 +147,10 @@ void ONScripterLabel::effectCascade( char *params, int duration )
                 dst_rect.y = start;
             }
             src_rect.y = 0;
-            SDL_BlitSurface(effect_src_surface, &dst_rect, accumulation_surface, &src_rect);
+            SDL_BlitSurface(effect_src_surface, &dst_rect, effect_target_surface, &src_rect);
             for (int i=start; i<end; i++) {
                 dst_rect.y = i;
-                SDL_BlitSurface(accumulation_surface, &src_rect, effect_src_surface, &dst_rect);
+                SDL_BlitSurface(effect_target_surface, &src_rect, effect_src_surface, &dst_rect);
             }
         }
         if (mode & CASCADE_DIR) {
@@ -182,6 +182,6 @@ void ONScripterLabel::effectCascade( char *params, int duration )
     if (mode & CASCADE_CROSS) {
         // do crossfade
         width = 256 * effect_counter / duration;
-        effectBlend( NULL, ALPHA_BLEND_CONST, width, &dirty_rect.bounding_box, NULL, dst_surface );
+        effectBlend( NULL, ALPHA_BLEND_CONST, width, &effect_rect, NULL, dst_surface, effect_target_surface );
     }
 }
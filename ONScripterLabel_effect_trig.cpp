@@ -67,7 +67,7 @@ void ONScripterLabel::effectTrvswave( char* /*params*/, int duration )
     int ampl, wvlen;
     int y_offset = -screen_height / 2;
     int width = 256 * effect_counter / duration;
-    effectBlend( NULL, ALPHA_BLEND_CONST, width, &dirty_rect.bounding_box, NULL, NULL, effect_tmp_surface );
+    effectBlend( NULL, ALPHA_BLEND_CONST, width, &effect_rect, NULL, NULL, effect_tmp_surface );
     if (effect_counter * 2 < duration) {
         ampl = TRVSWAVE_AMPLITUDE * 2 * effect_counter / duration;
         wvlen = (Sint16)(1.0/(((1.0/TRVSWAVE_WVLEN_END - 1.0/TRVSWAVE_WVLEN_START) * 2 * effect_counter / duration) + (1.0/TRVSWAVE_WVLEN_START)));
@@ -75,14 +75,14 @@ void ONScripterLabel::effectTrvswave( char* /*params*/, int duration )
         ampl = TRVSWAVE_AMPLITUDE * 2 * (duration - effect_counter) / duration;
         wvlen = (Sint16)(1.0/(((1.0/TRVSWAVE_WVLEN_END - 1.0/TRVSWAVE_WVLEN_START) * 2 * (duration - effect_counter) / duration) + (1.0/TRVSWAVE_WVLEN_START)));
     }
-    SDL_FillRect( accumulation_surface, NULL, SDL_MapRGBA( accumulation_surface->format, 0, 0, 0, 0xff ) );
+    SDL_FillRect( effect_target_surface, NULL, SDL_MapRGBA( effect_target_surface->format, 0, 0, 0, 0xff ) );
     for (int i=0; i<screen_height; i++) {
         int theta = TRIG_TABLE_SIZE * y_offset / wvlen;
         while (theta < 0) theta += TRIG_TABLE_SIZE;
         theta %= TRIG_TABLE_SIZE;
         dst_rect.x = (Sint16)(ampl * sin_table[theta] / TRIG_FACTOR);
         //dst_rect.x = (Sint16)(ampl * sin(M_PI * 2.0 * y_offset / wvlen));
-        SDL_BlitSurface(effect_tmp_surface, &src_rect, accumulation_surface, &dst_rect);
+        SDL_BlitSurface(effect_tmp_surface, &src_rect, effect_target_surface, &dst_rect);
         ++src_rect.y;
         ++dst_rect.y;
         ++y_offset;
@@ -130,13 +130,13 @@ void ONScripterLabel::effectWhirl( char *params, int duration )
     //float rad_base = M_PI * 2 * one_minus_cos + rad_amp;
 
     int width = 256 * effect_counter / duration;
-    effectBlend( NULL, ALPHA_BLEND_CONST, width, &dirty_rect.bounding_box,
+    effectBlend( NULL, ALPHA_BLEND_CONST, width, &effect_rect,
                  NULL, NULL, effect_tmp_surface );
 
     SDL_LockSurface( effect_tmp_surface );
-    SDL_LockSurface( accumulation_surface );
+    SDL_LockSurface( effect_target_surface );
     ONSBuf *src_buffer = (ONSBuf *)effect_tmp_surface->pixels;
-    ONSBuf *dst_buffer = (ONSBuf *)accumulation_surface->pixels;
+    ONSBuf *dst_buffer = (ONSBuf *)effect_target_surface->pixels;
     int *whirl_buffer = whirl_table;
 
     for ( int i=0 ; i<screen_height ; ++i ){
@@ -175,6 +175,6 @@ void ONScripterLabel::effectWhirl( char *params, int duration )
         }
     }
 
-    SDL_UnlockSurface( accumulation_surface );
+    SDL_UnlockSurface( effect_target_surface );
     SDL_UnlockSurface( effect_tmp_surface );
 }
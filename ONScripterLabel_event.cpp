@@ -103,7 +103,21 @@ extern "C" void mp3callback( void *userdata, Uint8 *stream, int len )
 
 extern "C" void oggcallback( void *userdata, Uint8 *stream, int len )
 {
-    if (decodeOggVorbis((ONScripterLabel::MusicStruct*)userdata, stream, len, true) == 0){
+    ONScripterLabel::MusicStruct *music_struct = (ONScripterLabel::MusicStruct*)userdata;
+    bool finished;
+
+    if (music_struct->ring){
+        // already decoded and converted, only the volume is applied here
+        int vol = music_struct->is_mute ? 0 : music_struct->volume;
+        if (music_struct->voice_sample && *(music_struct->voice_sample))
+            vol /= 2;
+        finished = (music_struct->ring->read( stream, len, vol, music_struct->swap_bytes ) == 0 &&
+                    music_struct->ring->isDrained());
+    }
+    else
+        finished = (decodeOggVorbis(music_struct, stream, len, true) == 0);
+
+    if (finished){
         SDL_Event event;
         event.type = ONS_SOUND_EVENT;
         SDL_PushEvent(&event);
@@ -454,7 +468,7 @@ void ONScripterLabel::flushEventSub( SDL_Event &event )
                 //don't free preloaded channels, _except_:
                 //always free voice channel, for now - could be
                 //messy for bgmdownmode and/or voice-waiting FIXME
-                Mix_FreeChunk( wave_sample[ch] );
+                freeChunk( wave_sample[ch] );
                 wave_sample[ch] = NULL;
             }
             if (ch == MIX_LOOPBGM_CHANNEL0 &&
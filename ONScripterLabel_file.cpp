@@ -578,16 +578,16 @@ void ONScripterLabel::saveMagicNumber( bool output_flag )
 
 int ONScripterLabel::saveSaveFile( int no, const char *savestr, bool no_error )
 {
-    // make save data structure on memory
+    // make save data structure on memory, in one pass with file_io_buf
+    // growing as needed; the result then trades places with save_data_buf
     if ((no < 0) || (saveon_flag && internal_saveon_flag)){
         file_io_buf_ptr = 0;
-        saveMagicNumber( false );
-        saveSaveFile2( false );
-        allocFileIOBuf();
         saveMagicNumber( true );
         saveSaveFile2( true );
         save_data_len = file_io_buf_ptr;
-        memcpy(save_data_buf, file_io_buf, save_data_len);
+        unsigned char *tmp = save_data_buf;
+        save_data_buf = file_io_buf;
+        file_io_buf = tmp;
     }
 
     if ( no >= 0 ){
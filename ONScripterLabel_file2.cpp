@@ -44,6 +44,9 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
     
     int i, j;
     char *str = NULL;
+    int tachi_xy[3][2];
+    bool cursor_abs_flag[2] = { true, true };
+    Uint32 start_time = SDL_GetTicks();
     
     readInt(); // 1
     if ( !input_flag ) {
@@ -69,17 +72,13 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
         readStr( &cursor_info[0].image_name );
         if ( cursor_info[0].image_name ){
             parseTaggedString( &cursor_info[0] );
-            setupAnimationInfo( &cursor_info[0] );
-            if ( cursor_info[0].image_surface )
-                cursor_info[0 ].visible = true;
+            restoreImage( &cursor_info[0] );
         }
         cursor_info[1].remove();
         readStr( &cursor_info[1].image_name );
         if ( cursor_info[1].image_name ){
             parseTaggedString( &cursor_info[1] );
-            setupAnimationInfo( &cursor_info[1] );
-            if ( cursor_info[1].image_surface )
-                cursor_info[1 ].visible = true;
+            restoreImage( &cursor_info[1] );
         }
     }
 
@@ -131,7 +130,7 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
         readStr( &sentence_font_info.image_name );
         if ( !sentence_font.is_transparent && sentence_font_info.image_name ){
             parseTaggedString( &sentence_font_info );
-            setupAnimationInfo( &sentence_font_info );
+            restoreImage( &sentence_font_info );
         }
     }
 
@@ -139,10 +138,11 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
         for (i=0; i<6; i++)
             readInt();
     } else {
-        if ( readInt() == 1 ) cursor_info[0].abs_flag = false;
-        else                  cursor_info[0].abs_flag = true;
-        if ( readInt() == 1 ) cursor_info[1].abs_flag = false;
-        else                  cursor_info[1].abs_flag = true;
+        // set once their images are, as setupAnimationInfo resets it
+        if ( readInt() == 1 ) cursor_abs_flag[0] = false;
+        else                  cursor_abs_flag[0] = true;
+        if ( readInt() == 1 ) cursor_abs_flag[1] = false;
+        else                  cursor_abs_flag[1] = true;
         cursor_info[0].orig_pos.x = readInt();
         cursor_info[1].orig_pos.x = readInt();
         cursor_info[0].orig_pos.y = readInt();
@@ -157,7 +157,7 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
     } else {
         bg_info.remove();
         readStr( &bg_info.file_name );
-        createBackground();
+        restoreBackground();
     }
 
     if ( !input_flag ) {
@@ -175,25 +175,18 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
                 if (scr_stretch_y > 1.0) {
                     // RCA: Stretch characters to screen size.
                     // Note stretches are with Y-scale, so they don't get distorted
-                    setupAnimationInfo( &tachi_info[ i ], NULL, scr_stretch_y, scr_stretch_y );
+                    restoreImage( &tachi_info[ i ], scr_stretch_y, scr_stretch_y );
                 } else
 #endif
-                setupAnimationInfo( &tachi_info[i] );
+                restoreImage( &tachi_info[i] );
             }
         }
 
-        for ( i=0 ; i<3 ; i++ ) {
-            tachi_info[i].orig_pos.x = readInt() + tachi_info[i].orig_pos.w / 2;
-        }
-
-        for ( i=0 ; i<3 ; i++ ) {
-            tachi_info[i].orig_pos.y = readInt() + tachi_info[i].orig_pos.h;
-            UpdateAnimPosStretchXY(&tachi_info[i]);
-            tachi_info[i].orig_pos.x -= tachi_info[i].orig_pos.w / 2;
-            tachi_info[i].orig_pos.y -= tachi_info[i].orig_pos.h;
-            tachi_info[i].pos.x -= tachi_info[i].pos.w / 2;
-            tachi_info[i].pos.y -= tachi_info[i].pos.h;
-        }
+        // placed once their images are set up, as they hang from the bottom
+        for ( i=0 ; i<3 ; i++ )
+            tachi_xy[i][0] = readInt();
+        for ( i=0 ; i<3 ; i++ )
+            tachi_xy[i][1] = readInt();
     }
 
     readInt(); // 0
@@ -223,9 +216,9 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
             if ( sprite_info[i].image_name ){
                 parseTaggedString( &sprite_info[i] );
 #ifdef RCA_SCALE
-                setupAnimationInfo( &sprite_info[i], NULL, scr_stretch_x, scr_stretch_y );
+                restoreImage( &sprite_info[i], scr_stretch_x, scr_stretch_y );
 #else
-                setupAnimationInfo( &sprite_info[i] );
+                restoreImage( &sprite_info[i] );
 #endif
             }
             sprite_info[i].orig_pos.x = readInt();
@@ -454,8 +447,7 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
         readStr( &btndef_info.image_name );
         if ( btndef_info.image_name && btndef_info.image_name[0] != '\0' ){
             parseTaggedString( &btndef_info );
-            setupAnimationInfo( &btndef_info );
-            SDL_SetAlpha( btndef_info.image_surface, DEFAULT_BLIT_FLAG, SDL_ALPHA_OPAQUE );
+            restoreImage( &btndef_info );
         }
     }
 
@@ -529,9 +521,9 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
                 if ( sprite2_info[i].image_name ){
                     parseTaggedString( &sprite2_info[i] );
 #ifdef RCA_SCALE
-                    setupAnimationInfo( &sprite2_info[i], NULL, scr_stretch_x, scr_stretch_y );
+                    restoreImage( &sprite2_info[i], scr_stretch_x, scr_stretch_y );
 #else
-                    setupAnimationInfo( &sprite2_info[i] );
+                    restoreImage( &sprite2_info[i] );
 #endif
                 }
                 sprite2_info[i].orig_pos.x = readInt();
@@ -548,7 +540,6 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
                 else
                     sprite2_info[i].trans = j;
                 sprite2_info[i].blending_mode = readInt();
-                sprite2_info[i].calcAffineMatrix();
             }
         }
         readInt();
@@ -572,17 +563,54 @@ int ONScripterLabel::loadSaveFile2( int file_version, bool input_flag )
             for (i=0; i<3; i++)
                 humanpos[i] = readInt();
             underline_value = readInt();
-            //might as well update the tachi
-            for ( i=0 ; i<3 ; i++ ) {
+        }
+    }
+
+    if ( input_flag ){
+        // every image is known now: decode them side by side, then set
+        // them up in order and finish what depends on their sizes
+        Uint32 parse_time = SDL_GetTicks();
+        int num_decoded = num_restore_jobs;
+        decodeRestoreImages();
+        Uint32 decode_time = SDL_GetTicks();
+        commitRestoreImages();
+
+        for ( i=0 ; i<2 ; i++ ){
+            cursor_info[i].abs_flag = cursor_abs_flag[i];
+            if ( cursor_info[i].image_surface )
+                cursor_info[i].visible = true;
+        }
+
+        for ( i=0 ; i<3 ; i++ ) {
+            if (file_version >= 206){
+                //might as well update the tachi
                 tachi_info[i].orig_pos.x = humanpos[i];
                 tachi_info[i].orig_pos.y = underline_value + 1;
-                UpdateAnimPosStretchXY(&tachi_info[i]);
-                tachi_info[i].orig_pos.x -= tachi_info[i].orig_pos.w/2;
-                tachi_info[i].orig_pos.y -= tachi_info[i].orig_pos.h;
-                tachi_info[i].pos.x -= tachi_info[i].pos.w/2;
-                tachi_info[i].pos.y -= tachi_info[i].pos.h;
             }
+            else{
+                tachi_info[i].orig_pos.x = tachi_xy[i][0] + tachi_info[i].orig_pos.w / 2;
+                tachi_info[i].orig_pos.y = tachi_xy[i][1] + tachi_info[i].orig_pos.h;
+            }
+            UpdateAnimPosStretchXY(&tachi_info[i]);
+            tachi_info[i].orig_pos.x -= tachi_info[i].orig_pos.w / 2;
+            tachi_info[i].orig_pos.y -= tachi_info[i].orig_pos.h;
+            tachi_info[i].pos.x -= tachi_info[i].pos.w / 2;
+            tachi_info[i].pos.y -= tachi_info[i].pos.h;
+        }
+
+        if ( btndef_info.image_surface ){
+            btndef_info.unshareImage();
+            SDL_SetAlpha( btndef_info.image_surface, DEFAULT_BLIT_FLAG, SDL_ALPHA_OPAQUE );
         }
+
+        if (file_version >= 204)
+            for ( i=0 ; i<MAX_SPRITE2_NUM ; i++ )
+                sprite2_info[i].calcAffineMatrix();
+
+        if ( debug_level > 0 )
+            printf( "load: parse %u ms, decode %u ms (%d images on %d threads), commit %u ms\n",
+                    parse_time - start_time, decode_time - parse_time, num_decoded,
+                    restore_pool.getNumThreads() + 1, SDL_GetTicks() - decode_time );
     }
 
     int text_num = readInt();
@@ -31,6 +31,7 @@
 // Ogapee's 20091115 release source code.
 
 #include "ONScripterLabel.h"
+#include "ArchiveStream.h"
 #include <new>
 #include <cstdio>
 
@@ -49,6 +50,14 @@ SDL_Surface *ONScripterLabel::loadImage( char *filename, bool *has_alpha )
         tmp = createSurfaceFromFile(filename, &location);
     if (tmp == NULL) return NULL;
 
+    return convertLoadedImage( tmp, has_alpha );
+}
+
+// converts a freshly decoded image to the 32bpp sprite format and works out
+// whether its alpha channel is meaningful; safe to call from the prefetch
+// thread
+SDL_Surface *ONScripterLabel::convertLoadedImage( SDL_Surface *tmp, bool *has_alpha )
+{
     bool has_colorkey = false;
     Uint32 colorkey = 0;
 
@@ -191,10 +200,35 @@ SDL_Surface *ONScripterLabel::createRectangleSurface(char *filename)
     return tmp;
 }
 
+// safe to call from the prefetch thread
+static SDL_Surface *decodeImage( const unsigned char *buffer, size_t length,
+                                 const char *filename )
+{
+    const char *ext = strrchr(filename, '.');
+
+    SDL_RWops *src = SDL_RWFromConstMem(buffer, length);
+    SDL_Surface *tmp = IMG_Load_RW(src, 0);
+    if (!tmp && ext && (!strcmp(ext+1, "JPG") || !strcmp(ext+1, "jpg"))){
+        fprintf(stderr, " *** force-loading a JPG image [%s]\n", filename);
+        tmp = IMG_LoadJPG_RW(src);
+    }
+    SDL_RWclose(src);
+
+    if (!tmp)
+        fprintf( stderr, " *** can't load file [%s]: %s ***\n", filename, IMG_GetError() );
+
+    return tmp;
+}
+
 SDL_Surface *ONScripterLabel::createSurfaceFromFile(char *filename, int *location)
 {
     char* alt_buffer = 0;
-    unsigned long length = script_h.cBR->getFileLength( filename );
+    BaseReader::FileRef ref;
+    unsigned long length = 0;
+    if ( script_h.cBR->openFile( filename, ref ) ){
+        length = ref.length;
+        if ( location ) *location = ref.location;
+    }
 
     if (length == 0) {
         alt_buffer = new char[strlen(filename) + strlen(script_h.save_path) + 1];
@@ -228,6 +262,11 @@ SDL_Surface *ONScripterLabel::createSurfaceFromFile(char *filename, int *locatio
         script_h.findAndAddLog( script_h.log_info[ScriptHandler::FILE_LOG], filename, true );
     //printf(" ... loading %s length %ld\n", filename, length );
 
+    if (ref.view) {
+        // uncompressed archive entry: decode straight from the mapping
+        return decodeImage(ref.view, length, filename);
+    }
+
     mean_size_of_loaded_images += length*6/5; // reserve 20% larger size
     num_loaded_images++;
     if (tmp_image_buf_length < mean_size_of_loaded_images/num_loaded_images){
@@ -244,6 +283,8 @@ SDL_Surface *ONScripterLabel::createSurfaceFromFile(char *filename, int *locatio
                      "failed to load image file [%s] (%lu bytes)",
                      filename, length);
             errorAndCont( script_h.errbuf, "unable to allocate buffer", "Memory Issue" );
+            script_h.cBR->closeFile( ref );
+            if (alt_buffer) delete[] alt_buffer;
             return NULL;
         }
     }
@@ -253,7 +294,7 @@ SDL_Surface *ONScripterLabel::createSurfaceFromFile(char *filename, int *locatio
     }
 
     if (!alt_buffer) {
-        script_h.cBR->getFile( filename, buffer, location );
+        script_h.cBR->readFile( ref, buffer );
     }
     else {
         FILE* fp;
@@ -264,20 +305,9 @@ SDL_Surface *ONScripterLabel::createSurfaceFromFile(char *filename, int *locatio
         }
         delete[] alt_buffer;
     }
-    char *ext = strrchr(filename, '.');
-
-    SDL_RWops *src = SDL_RWFromMem(buffer, length);
-    SDL_Surface *tmp = IMG_Load_RW(src, 0);
-    if (!tmp && ext && (!strcmp(ext+1, "JPG") || !strcmp(ext+1, "jpg"))){
-        fprintf(stderr, " *** force-loading a JPG image [%s]\n", filename);
-        tmp = IMG_LoadJPG_RW(src);
-
-    }
-    SDL_RWclose(src);
 
+    SDL_Surface *tmp = decodeImage(buffer, length, filename);
     if (buffer != tmp_image_buf) delete[] buffer;
-    if (!tmp)
-        fprintf( stderr, " *** can't load file [%s]: %s ***\n", filename, IMG_GetError() );
 
     return tmp;
 }
@@ -293,6 +323,9 @@ void ONScripterLabel::effectBlend( SDL_Surface *mask_surface, int trans_mode,
 {
     SDL_Rect rect = {0, 0, (Uint16)screen_width, (Uint16)screen_height};
 
+    // the tile map compares the effect's own source and destination
+    bool use_tiles = (src1 == NULL && src2 == NULL);
+
     if (src1 == NULL)
         src1 = effect_src_surface;
     if (src2 == NULL)
@@ -312,7 +345,50 @@ void ONScripterLabel::effectBlend( SDL_Surface *mask_surface, int trans_mode,
     SDL_LockSurface( src2 );
     SDL_LockSurface( dst );
     if ( mask_surface ) SDL_LockSurface( mask_surface );
-    
+
+    if ( use_tiles && effect_tiles.covers( rect ) ){
+        // blend the tiles that differ; the others look the same all the
+        // way through, so they only need copying on the first frame
+        const int tile = EffectTileMap::TILE_SIZE;
+        for ( int ty=rect.y/tile ; ty*tile<rect.y+rect.h ; ty++ ){
+            int tx = rect.x/tile;
+            while ( tx*tile < rect.x+rect.w ){
+                int tx2 = effect_tiles.getRunEnd( tx, ty );
+                SDL_Rect run = { (Sint16)(tx*tile), (Sint16)(ty*tile),
+                                 (Uint16)((tx2-tx)*tile), (Uint16)tile };
+                if ( !AnimationInfo::doClipping( &run, &rect ) ){
+                    if ( effect_tiles.isChanged( tx, ty ) )
+                        effectBlendRect( mask_surface, trans_mode, mask_value, run,
+                                         src1, src2, dst );
+                    else if ( !effect_tiles.copied && src1 != dst ){
+                        for ( int i=0 ; i<run.h ; i++ ){
+                            int offset = dst->w * (run.y + i) + run.x;
+                            memcpy( (ONSBuf *)dst->pixels + offset,
+                                    (ONSBuf *)src1->pixels + offset,
+                                    run.w * sizeof(ONSBuf) );
+                        }
+                    }
+                }
+                tx = tx2;
+            }
+        }
+        effect_tiles.copied = true;
+    }
+    else{
+        effectBlendRect( mask_surface, trans_mode, mask_value, rect, src1, src2, dst );
+    }
+
+    if ( mask_surface ) SDL_UnlockSurface( mask_surface );
+    SDL_UnlockSurface( dst );
+    SDL_UnlockSurface( src2 );
+    SDL_UnlockSurface( src1 );
+}
+
+// blends one rect; the surfaces are already locked
+void ONScripterLabel::effectBlendRect( SDL_Surface *mask_surface, int trans_mode,
+                                       Uint32 mask_value, SDL_Rect &rect,
+                                       SDL_Surface *src1, SDL_Surface *src2, SDL_Surface *dst )
+{
     ONSBuf *src1_buffer = (ONSBuf *)src1->pixels + src1->w * rect.y + rect.x;
     ONSBuf *src2_buffer = (ONSBuf *)src2->pixels + src2->w * rect.y + rect.x;
     ONSBuf *dst_buffer  = (ONSBuf *)dst->pixels + dst->w * rect.y + rect.x;
@@ -327,6 +403,23 @@ void ONScripterLabel::effectBlend( SDL_Surface *mask_surface, int trans_mode,
 
     if (( trans_mode == ALPHA_BLEND_FADE_MASK ||
           trans_mode == ALPHA_BLEND_CROSSFADE_MASK ) && mask_surface) {
+#if !defined(BPP16)
+        if ( effect_mask_plane && mask_surface == effect_mask_plane_surface ){
+            // the mask is already tiled to the screen, a byte per pixel
+            Uint8 *mask_buffer = (Uint8 *)effect_mask_plane + screen_width * rect.y + rect.x;
+            for ( int i=0 ; i<rect.h ; i++ ) {
+                ons_gfx::imageFilterEffectMaskBlend8(dst_buffer, src1_buffer,
+                                                     src2_buffer, mask_buffer,
+                                                     overflow_mask, mask_value,
+                                                     rect.w);
+                src1_buffer += screen_width;
+                src2_buffer += screen_width;
+                dst_buffer  += screen_width;
+                mask_buffer += screen_width;
+            }
+            return;
+        }
+#endif
         for ( int i=0 ; i<rect.h ; i++ ) {
             ONSBuf *mask_buffer = (ONSBuf *)mask_surface->pixels + mask_surface->w * ((rect.y+i)%mask_surface->h);
 
@@ -385,11 +478,6 @@ void ONScripterLabel::effectBlend( SDL_Surface *mask_surface, int trans_mode,
 #endif
         }
     }
-    
-    if ( mask_surface ) SDL_UnlockSurface( mask_surface );
-    SDL_UnlockSurface( dst );
-    SDL_UnlockSurface( src2 );
-    SDL_UnlockSurface( src1 );
 }
 
 // alphaBlendText
@@ -465,7 +553,7 @@ void ONScripterLabel::alphaBlendText( SDL_Surface *dst_surface, SDL_Rect dst_rec
 
 void ONScripterLabel::makeNegaSurface( SDL_Surface *surface, SDL_Rect &clip )
 {
-    SDL_LockSurface( surface );
+    if ( SDL_MUSTLOCK( surface ) ) SDL_LockSurface( surface );
     ONSBuf *buf = (ONSBuf *)surface->pixels + clip.y * surface->w + clip.x;
 
     ONSBuf mask = surface->format->Rmask | surface->format->Gmask | surface->format->Bmask;
@@ -475,12 +563,12 @@ void ONScripterLabel::makeNegaSurface( SDL_Surface *surface, SDL_Rect &clip )
         buf += surface->w - clip.w;
     }
 
-    SDL_UnlockSurface( surface );
+    if ( SDL_MUSTLOCK( surface ) ) SDL_UnlockSurface( surface );
 }
 
 void ONScripterLabel::makeMonochromeSurface( SDL_Surface *surface, SDL_Rect &clip )
 {
-    SDL_LockSurface( surface );
+    if ( SDL_MUSTLOCK( surface ) ) SDL_LockSurface( surface );
     ONSBuf *buffer = (ONSBuf *)surface->pixels + clip.y * surface->w + clip.x;
 
     for ( int i=clip.h ; i>0 ; i-- ){
@@ -493,7 +581,38 @@ void ONScripterLabel::makeMonochromeSurface( SDL_Surface *surface, SDL_Rect &cli
         buffer += surface->w - clip.w;
     }
 
-    SDL_UnlockSurface( surface );
+    if ( SDL_MUSTLOCK( surface ) ) SDL_UnlockSurface( surface );
+}
+
+// every sprite slot gets its image through setupAnimationInfo(), so that is
+// where it joins the index; slots emptied by csp and friends are dropped
+// lazily by pruneSpriteIndex()
+void ONScripterLabel::indexSprite( AnimationInfo *anim )
+{
+    if ( anim >= sprite_info && anim < sprite_info + MAX_SPRITE_NUM )
+        sprite_index.add( anim - sprite_info );
+    else if ( anim >= sprite2_info && anim < sprite2_info + MAX_SPRITE2_NUM )
+        sprite2_index.add( anim - sprite2_info );
+}
+
+void ONScripterLabel::pruneSpriteIndex( SpriteIndex &index, AnimationInfo *si )
+{
+    for ( int i=index.num-1 ; i>=0 ; i-- )
+        if ( !si[ index.list[i] ].image_surface )
+            index.remove( index.list[i] );
+}
+
+bool ONScripterLabel::isSpriteInClip( AnimationInfo *anim, SDL_Rect &clip )
+{
+#ifndef NO_LAYER_EFFECTS
+    if ( anim->trans_mode == AnimationInfo::TRANS_LAYER ) return true;
+#endif
+    // relative sprites move with the text cursor; let drawTaggedSurface clip
+    if ( !anim->abs_flag ) return true;
+
+    SDL_Rect &rect = anim->affine_flag ? anim->bounding_rect : anim->pos;
+    return ( rect.x < clip.x + clip.w && clip.x < rect.x + rect.w &&
+             rect.y < clip.y + clip.h && clip.y < rect.y + rect.h );
 }
 
 void ONScripterLabel::refreshSurface( SDL_Surface *surface, SDL_Rect *clip_src, int refresh_mode )
@@ -503,16 +622,71 @@ void ONScripterLabel::refreshSurface( SDL_Surface *surface, SDL_Rect *clip_src,
     SDL_Rect clip = {0, 0, (Uint16)surface->w, (Uint16)surface->h};
     if (clip_src) if ( AnimationInfo::doClipping( &clip, clip_src ) ) return;
 
-    int i, top;
     SDL_BlitSurface( bg_info.image_surface, &clip, surface, &clip );
 
+    pruneSpriteIndex( sprite_index, sprite_info );
+    pruneSpriteIndex( sprite2_index, sprite2_info );
+
+    if ( !canCompositeInBands( surface, clip ) ){
+        compositeSurface( surface, clip, refresh_mode );
+        return;
+    }
+
+    // every pixel sees the same sequence of blends whichever band it is
+    // in, so the result matches the serial path exactly
+    CompositeJob job;
+    job.ons = this;
+    job.surface = surface;
+    job.clip = clip;
+    job.refresh_mode = refresh_mode;
+    job.num_bands = compositor_pool.getNumThreads() + 1;
+    if ( job.num_bands > clip.h / MIN_COMPOSITE_BAND_HEIGHT )
+        job.num_bands = clip.h / MIN_COMPOSITE_BAND_HEIGHT;
+    compositor_pool.run( compositeBand, &job, job.num_bands );
+}
+
+bool ONScripterLabel::canCompositeInBands( SDL_Surface *surface, SDL_Rect &clip )
+{
+    if ( compositor_pool.getNumThreads() == 0 ) return false;
+    if ( clip.h < MIN_COMPOSITE_BAND_HEIGHT*2 ) return false;
+    // the blend routines only skip SDL_LockSurface on surfaces that don't
+    // need it, and its lock count isn't safe to share between threads
+    if ( SDL_MUSTLOCK( surface ) ) return false;
+#ifndef NO_LAYER_EFFECTS
+    // layers move their own sprites and blur across rows while drawing
+    if ( layer_info ) return false;
+#endif
+    return true;
+}
+
+void ONScripterLabel::compositeBand( void *data, int band )
+{
+    CompositeJob *job = (CompositeJob*)data;
+
+    SDL_Rect clip = job->clip;
+    int y1 = job->clip.h * band / job->num_bands;
+    int y2 = job->clip.h * (band+1) / job->num_bands;
+    clip.y += y1;
+    clip.h = y2 - y1;
+
+    job->ons->compositeSurface( job->surface, clip, job->refresh_mode );
+}
+
+// everything refreshSurface draws over the background; must only read
+// shared state, since compositor threads run it on disjoint bands at once
+void ONScripterLabel::compositeSurface( SDL_Surface *surface, SDL_Rect &clip, int refresh_mode )
+{
+    int i, k, top;
+
     if ( !all_sprite_hide_flag ){
         if ( z_order < 10 && refresh_mode & REFRESH_SAYA_MODE )
             top = 9;
         else
             top = z_order;
-        for ( i=MAX_SPRITE_NUM-1 ; i>top ; i-- ){
-            if ( sprite_info[i].image_surface && sprite_info[i].visible ){
+        for ( k=sprite_index.num-1 ; k>=0 ; k-- ){
+            i = sprite_index.list[k];
+            if ( i <= top ) break;
+            if ( sprite_info[i].visible && isSpriteInClip( &sprite_info[i], clip ) ){
                 drawTaggedSurface( surface, &sprite_info[i], clip );
             }
         }
@@ -530,8 +704,9 @@ void ONScripterLabel::refreshSurface( SDL_Surface *surface, SDL_Rect *clip_src,
         if ( nega_mode == 2 ) makeNegaSurface( surface, clip );
 
         if (!all_sprite2_hide_flag){
-            for ( i=MAX_SPRITE2_NUM-1 ; i>=0 ; i-- ){
-                if ( sprite2_info[i].image_surface && sprite2_info[i].visible ){
+            for ( k=sprite2_index.num-1 ; k>=0 ; k-- ){
+                i = sprite2_index.list[k];
+                if ( sprite2_info[i].visible && isSpriteInClip( &sprite2_info[i], clip ) ){
                     drawTaggedSurface( surface, &sprite2_info[i], clip );
                 }
             }
@@ -548,8 +723,11 @@ void ONScripterLabel::refreshSurface( SDL_Surface *surface, SDL_Rect *clip_src,
             top = 10;
         else
             top = 0;
-        for ( i=z_order ; i>=top ; i-- ){
-            if ( sprite_info[i].image_surface && sprite_info[i].visible ){
+        for ( k=sprite_index.num-1 ; k>=0 ; k-- ){
+            i = sprite_index.list[k];
+            if ( i > z_order ) continue;
+            if ( i < top ) break;
+            if ( sprite_info[i].visible && isSpriteInClip( &sprite_info[i], clip ) ){
                 drawTaggedSurface( surface, &sprite_info[i], clip );
             }
         }
@@ -558,8 +736,9 @@ void ONScripterLabel::refreshSurface( SDL_Surface *surface, SDL_Rect *clip_src,
     if ( !windowback_flag ){
         //Mion - ogapee2008
         if (!all_sprite2_hide_flag){
-            for ( i=MAX_SPRITE2_NUM-1 ; i>=0 ; i-- ){
-                if ( sprite2_info[i].image_surface && sprite2_info[i].visible ){
+            for ( k=sprite2_index.num-1 ; k>=0 ; k-- ){
+                i = sprite2_index.list[k];
+                if ( sprite2_info[i].visible && isSpriteInClip( &sprite2_info[i], clip ) ){
                     drawTaggedSurface( surface, &sprite2_info[i], clip );
                 }
             }
@@ -693,3 +872,474 @@ void ONScripterLabel::createBackground()
 
     bg_info.fill(bg_info.color[0], bg_info.color[1], bg_info.color[2], 0xff);
 }
+
+/* ---------------------------------------- */
+/* Image prefetch */
+
+void ONScripterLabel::startPrefetch()
+{
+    if ( prefetch_thread ) return;
+
+    prefetch_mutex = SDL_CreateMutex();
+    prefetch_cond = SDL_CreateCond();
+    prefetch_quit = false;
+    prefetch_scan_start = prefetch_scan_end = NULL;
+    if ( prefetch_mutex && prefetch_cond )
+        prefetch_thread = SDL_CreateThread( prefetchThreadFunc, this );
+
+    if ( prefetch_thread == NULL ){
+        fprintf( stderr, "Warning: couldn't start the image prefetch thread\n" );
+        if ( prefetch_cond ) SDL_DestroyCond( prefetch_cond );
+        if ( prefetch_mutex ) SDL_DestroyMutex( prefetch_mutex );
+        prefetch_cond = NULL;
+        prefetch_mutex = NULL;
+    }
+}
+
+void ONScripterLabel::stopPrefetch()
+{
+    if ( prefetch_thread == NULL ) return;
+
+    SDL_LockMutex( prefetch_mutex );
+    prefetch_quit = true;
+    SDL_CondSignal( prefetch_cond );
+    SDL_UnlockMutex( prefetch_mutex );
+    SDL_WaitThread( prefetch_thread, NULL );
+    prefetch_thread = NULL;
+
+    while ( prefetch_pending ){
+        PrefetchJob *job = prefetch_pending;
+        prefetch_pending = job->next;
+        freePrefetchJob( job );
+    }
+    while ( prefetch_done ){
+        PrefetchJob *job = prefetch_done;
+        prefetch_done = job->next;
+        freePrefetchJob( job );
+    }
+    num_prefetch_jobs = 0;
+
+    SDL_DestroyCond( prefetch_cond );
+    SDL_DestroyMutex( prefetch_mutex );
+    prefetch_cond = NULL;
+    prefetch_mutex = NULL;
+}
+
+void ONScripterLabel::freePrefetchJob( PrefetchJob *job )
+{
+    if ( job->surface ) SDL_FreeSurface( job->surface );
+    if ( job->buffer ) delete[] job->buffer;
+    if ( job->src.fp ) fclose( job->src.fp );
+    delete[] job->key;
+    delete[] job->file_name;
+    delete job;
+}
+
+// called before each command; rescans once the script has moved
+// out of the last scanned stretch
+void ONScripterLabel::prefetchImages()
+{
+    // nsa and its kin may still replace the reader during *define, and
+    // jobs can point into its mapped archives
+    if ( current_mode == DEFINE_MODE ) return;
+
+    char *current = script_h.getCurrent();
+    if ( (current >= prefetch_scan_start) && (current < prefetch_scan_end) )
+        return;
+
+    if ( prefetch_scan_start &&
+         ((current < prefetch_scan_start) || (current > prefetch_scan_end)) ){
+        // jumped elsewhere; whatever hasn't been decoded yet is stale
+        SDL_LockMutex( prefetch_mutex );
+        while ( prefetch_pending ){
+            PrefetchJob *job = prefetch_pending;
+            prefetch_pending = job->next;
+            freePrefetchJob( job );
+            num_prefetch_jobs--;
+        }
+        SDL_UnlockMutex( prefetch_mutex );
+    }
+
+    prefetch_scan_start = current;
+    prefetch_scan_end = script_h.scanImageNames( current, PREFETCH_LOOKAHEAD_LINES,
+                                                 prefetchImageName, this );
+    if ( prefetch_scan_end <= prefetch_scan_start )
+        prefetch_scan_end = prefetch_scan_start + 1;
+}
+
+void ONScripterLabel::prefetchImageName( void *data, const char *cmd, const char *name )
+{
+    ((ONScripterLabel*)data)->queuePrefetch( cmd, name );
+}
+
+void ONScripterLabel::queuePrefetch( const char *cmd, const char *name )
+{
+    // layers, string sprites and masked images are set up on demand only
+    const char *tag = name;
+    if ( *tag == '*' ) return;
+    if ( *tag == ':' ){
+        while ( *++tag == ' ' );
+        if ( *tag == 's' || *tag == 'm' ) return;
+    }
+
+    if ( num_prefetch_jobs >= MAX_PREFETCH_JOBS ){
+        // make room by dropping the oldest decoded image nobody asked for
+        SDL_LockMutex( prefetch_mutex );
+        PrefetchJob **link = &prefetch_done;
+        if ( *link ){
+            while ( (*link)->next ) link = &(*link)->next;
+            freePrefetchJob( *link );
+            *link = NULL;
+            num_prefetch_jobs--;
+        }
+        SDL_UnlockMutex( prefetch_mutex );
+        if ( num_prefetch_jobs >= MAX_PREFETCH_JOBS ) return;
+    }
+
+    AnimationInfo anim;
+    anim.setImageName( name );
+    parseTaggedString( &anim );
+    if ( !strcmp( cmd, "bg" ) ){
+        // as set up by createBackground()
+        anim.trans_mode = AnimationInfo::TRANS_COPY;
+        anim.num_of_cells = 1;
+    }
+    if ( !anim.file_name || (anim.num_of_cells <= 0) ||
+         (anim.trans_mode == AnimationInfo::TRANS_MASK) )
+        return;
+
+    char key[1024];
+#ifdef RCA_SCALE
+    if ( !makeImageCacheKey( &anim, key, sizeof(key), scr_stretch_x, scr_stretch_y ) )
+        return;
+#else
+    if ( !makeImageCacheKey( &anim, key, sizeof(key) ) ) return;
+#endif
+    if ( image_cache.has( key ) || isPrefetchQueued( key ) ) return;
+
+    PrefetchJob *job = readPrefetchJob( &anim, key );
+    if ( job == NULL ) return;
+
+    SDL_LockMutex( prefetch_mutex );
+    PrefetchJob **link = &prefetch_pending;
+    while ( *link ) link = &(*link)->next;
+    *link = job;
+    num_prefetch_jobs++;
+    prefetch_queued++;
+    SDL_CondSignal( prefetch_cond );
+    SDL_UnlockMutex( prefetch_mutex );
+
+    if ( debug_level > 1 )
+        printf( "prefetch: queued [%s]\n", job->file_name );
+}
+
+// looks up anim's image file for a new job.  A mapped entry is decoded
+// where it lies and anything openStream takes is read by whoever decodes
+// the job; only LZSS and SPB entries are still read here
+ONScripterLabel::PrefetchJob *ONScripterLabel::readPrefetchJob( AnimationInfo *anim, const char *key )
+{
+    BaseReader::FileRef ref;
+    if ( !script_h.cBR->openFile( anim->file_name, ref ) ) return NULL;
+
+    PrefetchJob *job = new PrefetchJob;
+    job->view = NULL;
+    job->buffer = NULL;
+    job->length = ref.length;
+    if ( ref.view ){
+        job->view = ref.view;
+        script_h.cBR->closeFile( ref );
+    }
+    else if ( !script_h.cBR->openStream( ref, job->src ) ){
+        job->buffer = new(std::nothrow) unsigned char[ ref.length ];
+        if ( job->buffer == NULL ){
+            script_h.cBR->closeFile( ref );
+            delete job;
+            return NULL;
+        }
+        job->length = script_h.cBR->readFile( ref, job->buffer );
+    }
+    job->key = new char[ strlen(key) + 1 ];
+    strcpy( job->key, key );
+    job->file_name = new char[ strlen(anim->file_name) + 1 ];
+    strcpy( job->file_name, anim->file_name );
+    job->trans_mode = anim->trans_mode;
+    job->num_of_cells = anim->num_of_cells;
+    memcpy( job->direct_color, anim->direct_color, sizeof(uchar3) );
+    job->promote_alpha = (script_h.enc.getEncoding() == Encoding::CODE_UTF8);
+    job->surface = NULL;
+    job->orig_w = job->orig_h = 0;
+    job->next = NULL;
+
+    return job;
+}
+
+bool ONScripterLabel::isPrefetchQueued( const char *key )
+{
+    bool found = false;
+
+    SDL_LockMutex( prefetch_mutex );
+    if ( prefetch_running && !strcmp( prefetch_running->key, key ) )
+        found = true;
+    for ( PrefetchJob *job = prefetch_pending ; job && !found ; job = job->next )
+        if ( !strcmp( job->key, key ) ) found = true;
+    for ( PrefetchJob *job = prefetch_done ; job && !found ; job = job->next )
+        if ( !strcmp( job->key, key ) ) found = true;
+    SDL_UnlockMutex( prefetch_mutex );
+
+    return found;
+}
+
+// hands over a decoded image if the worker has finished it; never waits,
+// and drops the job if the worker hasn't got to it yet since the caller
+// is about to load the image itself
+SDL_Surface *ONScripterLabel::takePrefetched( const char *key, AnimationInfo *anim )
+{
+    if ( restore_jobs ){
+        SDL_Surface *surface = takeRestored( key, anim );
+        if ( surface ) return surface;
+    }
+    if ( prefetch_thread == NULL ) return NULL;
+
+    PrefetchJob *job = NULL;
+
+    SDL_LockMutex( prefetch_mutex );
+    PrefetchJob **link = &prefetch_done;
+    while ( *link && strcmp( (*link)->key, key ) ) link = &(*link)->next;
+    if ( *link == NULL ){
+        link = &prefetch_pending;
+        while ( *link && strcmp( (*link)->key, key ) ) link = &(*link)->next;
+    }
+    if ( *link ){
+        job = *link;
+        *link = job->next;
+        num_prefetch_jobs--;
+    }
+    SDL_UnlockMutex( prefetch_mutex );
+
+    if ( job == NULL ) return NULL;
+
+    SDL_Surface *surface = job->surface;
+    job->surface = NULL;
+    if ( surface ){
+        prefetch_hits++;
+        anim->trans_mode = job->trans_mode;
+        anim->orig_pos.w = job->orig_w;
+        anim->orig_pos.h = job->orig_h;
+        if ( filelog_flag )
+            script_h.findAndAddLog( script_h.log_info[ScriptHandler::FILE_LOG], job->file_name, true );
+    }
+    freePrefetchJob( job );
+
+    return surface;
+}
+
+// reading through job->src, decoding and alpha setup only, so any thread
+// may run it
+void ONScripterLabel::decodePrefetchJob( PrefetchJob *job )
+{
+    if ( job->src.fp ){
+        ArchiveStream stream( job->src );
+        job->src.fp = NULL;
+        job->buffer = new(std::nothrow) unsigned char[ job->length ];
+        if ( job->buffer == NULL ) return;
+        job->length = stream.read( job->buffer, job->length );
+    }
+
+    SDL_Surface *surface = decodeImage( job->view ? job->view : job->buffer,
+                                        job->length, job->file_name );
+    if ( job->buffer ) delete[] job->buffer;
+    job->buffer = NULL;
+    job->view = NULL;
+    if ( surface == NULL ) return;
+
+    bool has_alpha;
+    surface = convertLoadedImage( surface, &has_alpha );
+
+    AnimationInfo anim;
+    anim.trans_mode = job->trans_mode;
+    if ( job->promote_alpha && has_alpha )
+        anim.trans_mode = AnimationInfo::TRANS_ALPHA;
+    anim.num_of_cells = job->num_of_cells;
+    memcpy( anim.direct_color, job->direct_color, sizeof(uchar3) );
+    job->surface = anim.setupImageAlpha( surface, NULL, has_alpha );
+    job->trans_mode = anim.trans_mode;
+    job->orig_w = anim.orig_pos.w;
+    job->orig_h = anim.orig_pos.h;
+}
+
+int ONScripterLabel::prefetchThreadFunc( void *data )
+{
+    ((ONScripterLabel*)data)->prefetchThreadLoop();
+    return 0;
+}
+
+// runs on the prefetch thread: only reading through the job's own file
+// handle, decoding and alpha setup happen here; looking files up and
+// resizing stay on the main thread
+void ONScripterLabel::prefetchThreadLoop()
+{
+    SDL_LockMutex( prefetch_mutex );
+    while ( !prefetch_quit ){
+        PrefetchJob *job = prefetch_pending;
+        if ( job == NULL ){
+            SDL_CondWait( prefetch_cond, prefetch_mutex );
+            continue;
+        }
+        prefetch_pending = job->next;
+        job->next = NULL;
+        prefetch_running = job;
+        SDL_UnlockMutex( prefetch_mutex );
+
+        decodePrefetchJob( job );
+
+        SDL_LockMutex( prefetch_mutex );
+        prefetch_running = NULL;
+        job->next = prefetch_done;
+        prefetch_done = job;
+    }
+    SDL_UnlockMutex( prefetch_mutex );
+}
+
+/* ---------------------------------------- */
+/* Save restoration */
+
+// parse phase: remembers anim for commitRestoreImages() and looks up its file
+void ONScripterLabel::restoreImage( AnimationInfo *anim, float stretch_x, float stretch_y )
+{
+    // string sprites and layers have no file to decode; set them up now
+    if ( (anim->trans_mode == AnimationInfo::TRANS_STRING) ||
+         (anim->trans_mode == AnimationInfo::TRANS_LAYER) ||
+         (num_restore_images >= MAX_RESTORE_IMAGES) ){
+#ifdef RCA_SCALE
+        setupAnimationInfo( anim, NULL, stretch_x, stretch_y );
+#else
+        setupAnimationInfo( anim );
+#endif
+        return;
+    }
+
+    if ( restore_images == NULL )
+        restore_images = new RestoreImage[ MAX_RESTORE_IMAGES ];
+    RestoreImage &image = restore_images[ num_restore_images++ ];
+    image.anim = anim;
+    image.stretch_x = stretch_x;
+    image.stretch_y = stretch_y;
+
+    queueRestoreJob( anim, stretch_x, stretch_y );
+}
+
+// parse phase: like restoreImage() for bg_info, which createBackground()
+// fills from an image of its own
+void ONScripterLabel::restoreBackground()
+{
+    if ( restore_images == NULL )
+        restore_images = new RestoreImage[ MAX_RESTORE_IMAGES ];
+    if ( num_restore_images >= MAX_RESTORE_IMAGES ){
+        createBackground();
+        return;
+    }
+    restore_images[ num_restore_images++ ].anim = NULL;
+
+    const char *name = bg_info.file_name;
+    if ( !name || !strcmp( name, "white" ) || !strcmp( name, "black" ) ||
+         (name[0] == '#') )
+        return;
+
+    // as set up by createBackground()
+    AnimationInfo anim;
+    setStr( &anim.image_name, name );
+    parseTaggedString( &anim );
+    anim.trans_mode = AnimationInfo::TRANS_COPY;
+    anim.num_of_cells = 1;
+#ifdef RCA_SCALE
+    if ( scr_stretch_y > 1.0 || scr_stretch_x > 1.0 )
+        queueRestoreJob( &anim, scr_stretch_x, scr_stretch_y );
+    else
+#endif
+    queueRestoreJob( &anim, 1.0, 1.0 );
+}
+
+// looks up the file for anim unless the image is cached or already queued
+void ONScripterLabel::queueRestoreJob( AnimationInfo *anim, float stretch_x, float stretch_y )
+{
+    // masked images need a second file; setupAnimationInfo loads those
+    if ( !anim->file_name || (anim->num_of_cells <= 0) ||
+         (anim->trans_mode == AnimationInfo::TRANS_MASK) )
+        return;
+
+    char key[1024];
+    if ( !makeImageCacheKey( anim, key, sizeof(key), stretch_x, stretch_y ) ) return;
+    if ( image_cache.has( key ) ) return;
+
+    PrefetchJob **link = &restore_jobs;
+    for ( ; *link ; link = &(*link)->next )
+        if ( !strcmp( (*link)->key, key ) ) return;
+
+    *link = readPrefetchJob( anim, key );
+    if ( *link ) num_restore_jobs++;
+}
+
+// decode phase: the main thread works through the jobs alongside restore_pool
+void ONScripterLabel::decodeRestoreImages()
+{
+    if ( num_restore_jobs == 0 ) return;
+
+    RestoreJob job;
+    job.ons = this;
+    job.jobs = new PrefetchJob*[ num_restore_jobs ];
+    int i = 0;
+    for ( PrefetchJob *p = restore_jobs ; p ; p = p->next )
+        job.jobs[i++] = p;
+    restore_pool.run( decodeRestoreJob, &job, num_restore_jobs );
+    delete[] job.jobs;
+}
+
+void ONScripterLabel::decodeRestoreJob( void *data, int job )
+{
+    RestoreJob *restore = (RestoreJob*)data;
+    restore->ons->decodePrefetchJob( restore->jobs[job] );
+}
+
+// commit phase: sets the images up in the order the save listed them
+void ONScripterLabel::commitRestoreImages()
+{
+    for ( int i=0 ; i<num_restore_images ; i++ ){
+        RestoreImage &image = restore_images[i];
+        if ( image.anim == NULL )
+            createBackground();
+        else
+#ifdef RCA_SCALE
+            setupAnimationInfo( image.anim, NULL, image.stretch_x, image.stretch_y );
+#else
+            setupAnimationInfo( image.anim );
+#endif
+    }
+    if ( restore_images ) delete[] restore_images;
+    restore_images = NULL;
+    num_restore_images = 0;
+
+    while ( restore_jobs ){
+        PrefetchJob *job = restore_jobs;
+        restore_jobs = job->next;
+        freePrefetchJob( job );
+    }
+    num_restore_jobs = 0;
+}
+
+// the job keeps its reference until the commit is over, so every image
+// in the save with the same key gets the one decoded surface
+SDL_Surface *ONScripterLabel::takeRestored( const char *key, AnimationInfo *anim )
+{
+    PrefetchJob *job = restore_jobs;
+    while ( job && strcmp( job->key, key ) ) job = job->next;
+    if ( job == NULL || job->surface == NULL ) return NULL;
+
+    job->surface->refcount++;
+    anim->trans_mode = job->trans_mode;
+    anim->orig_pos.w = job->orig_w;
+    anim->orig_pos.h = job->orig_h;
+    if ( filelog_flag )
+        script_h.findAndAddLog( script_h.log_info[ScriptHandler::FILE_LOG], job->file_name, true );
+
+    return job->surface;
+}
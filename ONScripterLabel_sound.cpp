@@ -36,6 +36,8 @@
 // Ogapee's 20091115 release source code.
 
 #include "ONScripterLabel.h"
+#include "ArchiveStream.h"
+#include "ReadAheadStream.h"
 #include <new>
 #ifdef LINUX
 #include <signal.h>
@@ -123,6 +125,22 @@ extern SDL_TimerID timer_seqmusic_id;
          ((buf[0] == 'I') && (buf[1] == 'D') && (buf[2] == '3') &&  \
           (buf[3] != 0xFF) && (buf[4] != 0xFF) && !(buf[5] & 0x1F))
 
+//MPEG audio frame sync
+#define IS_MPA_HDR(buf)                                             \
+         ((buf[0] == 0xFF) && ((buf[1] & 0xE0) == 0xE0))
+
+//size of the ID3v2 tag, header included; 0 if it's malformed
+static int getID3v2Size(const unsigned char *buf)
+{
+    int size = 0;
+    for (int i=0; i<4; i++) {
+        if (buf[6+i] & 0x80) return 0;
+        size <<= 7;
+        size += buf[6+i];
+    }
+    return size + 10;
+}
+
 extern long decodeOggVorbis(ONScripterLabel::MusicStruct *music_struct, Uint8 *buf_dst, long len, bool do_rate_conversion)
 {
     int current_section;
@@ -201,9 +219,6 @@ int ONScripterLabel::playSound(const char *filename, int format, bool loop_flag,
 {
     if ( !audio_open_flag ) return SOUND_NONE;
 
-    long length = script_h.cBR->getFileLength( filename );
-    if (length == 0) return SOUND_NONE;
-
     //Mion: account for mode_wave_demo setting
     //(i.e. if not set, then don't play non-bgm wave/ogg during skip mode)
     if (!mode_wave_demo_flag &&
@@ -214,27 +229,119 @@ int ONScripterLabel::playSound(const char *filename, int format, bool loop_flag,
             return SOUND_NONE;
     }
 
-    unsigned char *buffer;
+    char key[1024];
+    bool use_cache = false;
+    if ((format & (SOUND_OGG | SOUND_WAVE)) && isSoundCacheChannel(channel)){
+        // chunks are converted to the mixer's format when loaded
+        int len = snprintf(key, sizeof(key), "%d/%d/%d/%d/%s",
+                           audio_format.freq, audio_format.format,
+                           audio_format.channels,
+                           format & (SOUND_OGG | SOUND_WAVE), filename);
+        use_cache = (len > 0 && len < (int)sizeof(key));
+    }
+    if (use_cache){
+        int type;
+        Mix_Chunk *chunk = sound_cache.get(key, &type);
+        if (chunk){
+            playWave(chunk, format, loop_flag, channel);
+            return type;
+        }
+    }
+
+    BaseReader::FileRef ref;
+    if ( !script_h.cBR->openFile( filename, ref ) ) return SOUND_NONE;
+    long length = ref.length;
+
+    unsigned char *buffer = NULL;
+    bool ogg_tried = false;
 
     if ((format & (SOUND_MP3 | SOUND_OGG_STREAMING)) && 
         (length == music_buffer_length) &&
         music_buffer ){
         buffer = music_buffer;
+        script_h.cBR->closeFile( ref );
     }
-    else{
+    else if (format & (SOUND_OGG | SOUND_OGG_STREAMING)){
+        // vorbisfile pulls its input as it decodes, so an ogg can be read
+        // straight out of the archive instead of whole before it starts
+        BaseReader::StreamSource src;
+        if ( script_h.cBR->openStream( ref, src ) ){
+            SDL_RWops *rw = ArchiveStream::createRWops( src );
+            if (rw){
+                int ret = playOGG(format, NULL, length, loop_flag, channel, rw);
+                if (ret == SOUND_OGG && use_cache && wave_sample[channel])
+                    sound_cache.add(key, wave_sample[channel], SOUND_OGG);
+                if (ret & (SOUND_OGG | SOUND_OGG_STREAMING)) return ret;
+                ogg_tried = true;
+            }
+            // not an ogg after all; the checks below want it whole
+            if ( !script_h.cBR->openFile( filename, ref ) ) return SOUND_NONE;
+        }
+    }
+
+    if ((buffer == NULL) && (format & SOUND_MP3) && !music_cmd){
+        // SMPEG pulls its input as it plays too, so an mp3 is streamed out
+        // of the archive; the stream starts past any ID3v2 tag since SMPEG
+        // doesn't skip it, which needs a stored (not NBZ) entry
+        BaseReader::StreamSource src;
+        if ( script_h.cBR->openStream( ref, src ) ){
+            bool stored = (src.compression_type == BaseReader::NO_COMPRESSION);
+            bool ref_open = false;
+            long skip = -1;
+            unsigned char header[10];
+            SDL_RWops *rw = ArchiveStream::createRWops( src );
+            if (rw && SDL_RWread( rw, header, 1, sizeof(header) ) == sizeof(header)){
+                if (HAS_ID3V2_TAG(header)){
+                    if (stored) skip = getID3v2Size(header);
+                    if (skip >= length) skip = -1;
+                }
+                else if (IS_MPA_HDR(header))
+                    skip = 0;
+            }
+            if (rw && skip > 0){
+                if (debug_level > 0) printf("Found ID3v2 tag, size %ld bytes\n", skip);
+                SDL_RWclose( rw );
+                rw = NULL;
+                if ( !script_h.cBR->openFile( filename, ref ) ) return SOUND_NONE;
+                if ( script_h.cBR->openStream( ref, src ) ){
+                    src.offset += skip;
+                    src.length -= skip;
+                    src.original_length -= skip;
+                    rw = ArchiveStream::createRWops( src );
+                }
+                else
+                    ref_open = true;
+            }
+            if (rw && skip >= 0){
+                SDL_RWseek( rw, 0, RW_SEEK_SET );
+                mp3_sample = SMPEG_new_rwops( rw, NULL, 0 );
+                if (playMP3() == 0) return SOUND_MP3;
+            }
+            else if (rw)
+                SDL_RWclose( rw );
+            // not one to stream; the checks below want it whole
+            if ( !ref_open && !script_h.cBR->openFile( filename, ref ) )
+                return SOUND_NONE;
+        }
+    }
+
+    if (buffer == NULL){
         buffer = new(std::nothrow) unsigned char[length];
         if (buffer == NULL) {
             snprintf(script_h.errbuf, MAX_ERRBUF_LEN,
                      "failed to load sound file [%s] (%lu bytes)",
                      filename, length);
             errorAndCont( script_h.errbuf, "unable to allocate buffer", "Memory Issue" );
+            script_h.cBR->closeFile( ref );
             return SOUND_NONE;
         }
-        script_h.cBR->getFile( filename, buffer );
+        script_h.cBR->readFile( ref, buffer );
     }
 
-    if (format & (SOUND_OGG | SOUND_OGG_STREAMING)){
+    if ((format & (SOUND_OGG | SOUND_OGG_STREAMING)) && !ogg_tried){
         int ret = playOGG(format, buffer, length, loop_flag, channel);
+        if (ret == SOUND_OGG && use_cache && wave_sample[channel])
+            sound_cache.add(key, wave_sample[channel], SOUND_OGG);
         if (ret & (SOUND_OGG | SOUND_OGG_STREAMING)) return ret;
     }
 
@@ -263,12 +370,15 @@ int ONScripterLabel::playSound(const char *filename, int format, bool loop_flag,
             // _and_ that the file contains uncompressed PCM data
             char *fmtname = new char[strlen(filename) + strlen(".fmt") + 1];
             sprintf(fmtname, "%s.fmt", filename);
-            unsigned int fmtlen = script_h.cBR->getFileLength( fmtname );
+            BaseReader::FileRef fmtref;
+            unsigned int fmtlen = 0;
+            if ( script_h.cBR->openFile( fmtname, fmtref ) ) fmtlen = fmtref.length;
+            if ( fmtlen < 8 ) script_h.cBR->closeFile( fmtref );
             if ( fmtlen >= 8) {
                 // a file called filename + ".fmt" exists, of appropriate size;
                 // read fmt info
                 unsigned char *buffer2 = new unsigned char[fmtlen];
-                script_h.cBR->getFile( fmtname, buffer2 );
+                script_h.cBR->readFile( fmtref, buffer2 );
 
                 int channels, bits;
                 unsigned long rate=0, data_length=0;
@@ -315,6 +425,7 @@ int ONScripterLabel::playSound(const char *filename, int format, bool loop_flag,
         }
         Mix_Chunk *chunk = Mix_LoadWAV_RW(SDL_RWFromMem(buffer, length), 1);
         if (playWave(chunk, format, loop_flag, channel) == 0){
+            if (use_cache) sound_cache.add(key, chunk, SOUND_WAVE);
             delete[] buffer;
             return SOUND_WAVE;
         }
@@ -348,18 +459,9 @@ int ONScripterLabel::playSound(const char *filename, int format, bool loop_flag,
         int id3v2_size = 0;
         if (HAS_ID3V2_TAG(buffer)) {
             //found an ID3v2 tag, skipping since SMPEG doesn't
-            for (int i=0; i<4; i++) {
-                if (buffer[6+i] & 0x80) {
-                    id3v2_size = 0;
-                    break;
-                }
-                id3v2_size <<= 7;
-                id3v2_size += buffer[6+i];
-            }
-            if (id3v2_size > 0) {
-                id3v2_size += 10;
-                if (debug_level > 0) printf("Found ID3v2 tag, size %d bytes\n", id3v2_size);
-            }
+            id3v2_size = getID3v2Size(buffer);
+            if (id3v2_size > 0 && debug_level > 0)
+                printf("Found ID3v2 tag, size %d bytes\n", id3v2_size);
         }
 
         mp3_sample = SMPEG_new_rwops( SDL_RWFromMem( buffer + id3v2_size, length - id3v2_size ), NULL, 0 );
@@ -428,10 +530,24 @@ void ONScripterLabel::playCDAudio()
     }
 }
 
+void ONScripterLabel::freeChunk(Mix_Chunk *chunk)
+{
+    if (chunk && !sound_cache.release(chunk))
+        Mix_FreeChunk(chunk);
+}
+
+bool ONScripterLabel::isSoundCacheChannel(int channel)
+{
+    // not the bgm and loopbgm channels: those sounds are long and seldom
+    // replayed, and loopbgm keeps its own pair loaded anyway
+    return (channel < ONS_MIX_CHANNELS) || (channel == MIX_WAVE_CHANNEL) ||
+           (channel == MIX_CLICKVOICE_CHANNEL) || (channel == MIX_PRELOAD_CHANNEL);
+}
+
 int ONScripterLabel::playWave(Mix_Chunk *chunk, int format, bool loop_flag, int channel)
 {
     Mix_Pause( channel );
-    if ( wave_sample[channel] ) Mix_FreeChunk( wave_sample[channel] );
+    if ( wave_sample[channel] ) freeChunk( wave_sample[channel] );
     wave_sample[channel] = chunk;
 
     if (!chunk) return -1;
@@ -486,10 +602,10 @@ int ONScripterLabel::playMP3()
     return 0;
 }
 
-int ONScripterLabel::playOGG(int format, unsigned char *buffer, long length, bool loop_flag, int channel)
+int ONScripterLabel::playOGG(int format, unsigned char *buffer, long length, bool loop_flag, int channel, SDL_RWops *rw)
 {
     int channels, rate;
-    OVInfo *ovi = openOggVorbis(buffer, length, channels, rate);
+    OVInfo *ovi = openOggVorbis(buffer, length, channels, rate, rw);
     if (ovi == NULL) return SOUND_OTHER;
 
     if (format & SOUND_OGG){
@@ -532,6 +648,7 @@ int ONScripterLabel::playOGG(int format, unsigned char *buffer, long length, boo
     music_struct.ovi = ovi;
     music_struct.volume = music_volume;
     music_struct.is_mute = !volume_on_flag;
+    startMusicStream();
     Mix_HookMusic(oggcallback, &music_struct);
 
     music_buffer = buffer;
@@ -669,35 +786,64 @@ int ONScripterLabel::playMPEG( const char *filename, bool async_flag, bool use_p
     if (surround_rects) delete[] surround_rects;
     surround_rects = NULL;
 
-    unsigned long length = script_h.cBR->getFileLength( filename );
-
-    if (length == 0) {
+    BaseReader::FileRef ref;
+    if ( !script_h.cBR->openFile( filename, ref ) ) {
         snprintf(script_h.errbuf, MAX_ERRBUF_LEN,
                  "couldn't load movie '%s'", filename);
         errorAndCont(script_h.errbuf);
         return 0;
     }
-
-    movie_buffer = new unsigned char[length];
-    script_h.cBR->getFile( filename, movie_buffer );
+    unsigned long length = ref.length;
+
+    // SMPEG pulls the movie in as it plays, so stream it out of the
+    // archive instead of reading all of it before the first frame
+    SDL_RWops *rw = NULL;
+    unsigned char header[11];
+    memset( header, 0, sizeof(header) );
+    BaseReader::StreamSource src;
+    if ( script_h.cBR->openStream( ref, src ) ){
+        rw = ArchiveStream::createRWops( src );
+        if ( rw ){
+            SDL_RWread( rw, header, 1, sizeof(header) );
+            SDL_RWseek( rw, 0, RW_SEEK_SET );
+        }
+        else if ( !script_h.cBR->openFile( filename, ref ) )
+            return 0;
+    }
+    if ( rw == NULL ){
+        movie_buffer = new unsigned char[length];
+        script_h.cBR->readFile( ref, movie_buffer );
+        memcpy( header, movie_buffer, (length < sizeof(header)) ? length : sizeof(header) );
+        rw = SDL_RWFromMem( movie_buffer, length );
+    }
 
     /* check for AVI header format */
-    if ( IS_AVI_HDR(movie_buffer) ){
+    if ( IS_AVI_HDR(header) ){
         snprintf(script_h.errbuf, MAX_ERRBUF_LEN,
                  "movie file '%s' is in AVI format", filename);
         errorAndCont(script_h.errbuf);
+        SDL_RWclose( rw );
         if (movie_buffer) delete[] movie_buffer;
         movie_buffer = NULL;
         return 0;
     }
 
-    SMPEG *mpeg_sample = SMPEG_new_rwops( SDL_RWFromMem( movie_buffer, length ), NULL, 0 );
+    if ( movie_buffer == NULL ){
+        SDL_RWops *read_ahead = ReadAheadStream::createRWops( rw, length, MOVIE_READ_AHEAD_SIZE );
+        if ( read_ahead == rw )
+            fprintf( stderr, "Warning: couldn't start the movie read-ahead thread\n" );
+        rw = read_ahead;
+    }
+
+    SMPEG *mpeg_sample = SMPEG_new_rwops( rw, NULL, 0 );
     char *errstr = SMPEG_error( mpeg_sample );
     if (errstr){
         
         snprintf(script_h.errbuf, MAX_ERRBUF_LEN,
                  "SMPEG error on '%s'", filename);
         errorAndCont(script_h.errbuf, errstr);
+        // closes rw, stopping the read-ahead thread with it
+        SMPEG_delete( mpeg_sample );
         if (movie_buffer) delete[] movie_buffer;
         movie_buffer = NULL;
         return 0;
@@ -950,13 +1096,14 @@ void ONScripterLabel::stopBGM( bool continue_flag )
     if (music_struct.ovi){
         Mix_HaltMusic();
         Mix_HookMusic( NULL, NULL );
+        stopMusicStream();
         closeOggVorbis(music_struct.ovi);
         music_struct.ovi = NULL;
     }
 
     if ( wave_sample[MIX_BGM_CHANNEL] ){
         Mix_Pause( MIX_BGM_CHANNEL );
-        Mix_FreeChunk( wave_sample[MIX_BGM_CHANNEL] );
+        freeChunk( wave_sample[MIX_BGM_CHANNEL] );
         wave_sample[MIX_BGM_CHANNEL] = NULL;
     }
 
@@ -1009,7 +1156,7 @@ void ONScripterLabel::stopDWAVE( int channel )
             //don't free preloaded channels, _except_:
             //always free voice channel, for now - could be
             //messy for bgmdownmode and/or voice-waiting FIXME
-            Mix_FreeChunk( wave_sample[channel] );
+            freeChunk( wave_sample[channel] );
             wave_sample[channel] = NULL;
             channel_preloaded[channel] = false;
         }
@@ -1028,7 +1175,7 @@ void ONScripterLabel::stopAllDWAVE()
             if ( !channel_preloaded[ch] || ch == 0 ){
                 //always free voice channel sample, for now - could be
                 //messy for bgmdownmode and/or voice-waiting FIXME
-                Mix_FreeChunk( wave_sample[ch] );
+                freeChunk( wave_sample[ch] );
                 wave_sample[ch] = NULL;
             }
         }
@@ -1108,7 +1255,10 @@ static size_t oc_read_func(void *ptr, size_t size, size_t nmemb, void *datasourc
     size_t len = size*nmemb;
     if ((size_t)ogg_vorbis_info->pos+len > (size_t)ogg_vorbis_info->length) 
         len = (size_t)(ogg_vorbis_info->length - ogg_vorbis_info->pos);
-    memcpy(ptr, ogg_vorbis_info->buf+ogg_vorbis_info->pos, len);
+    if (ogg_vorbis_info->rw)
+        len = SDL_RWread(ogg_vorbis_info->rw, ptr, 1, len);
+    else
+        memcpy(ptr, ogg_vorbis_info->buf+ogg_vorbis_info->pos, len);
     ogg_vorbis_info->pos += len;
 
     return len;
@@ -1127,6 +1277,8 @@ static int oc_seek_func(void *datasource, ogg_int64_t offset, int whence)
         pos = ogg_vorbis_info->length + offset;
 
     if (pos < 0 || pos > ogg_vorbis_info->length) return -1;
+    if (ogg_vorbis_info->rw &&
+        SDL_RWseek(ogg_vorbis_info->rw, (int)pos, RW_SEEK_SET) < 0) return -1;
 
     ogg_vorbis_info->pos = pos;
 
@@ -1145,7 +1297,7 @@ static long oc_tell_func(void *datasource)
     return (long)ogg_vorbis_info->pos;
 }
 #endif
-OVInfo *ONScripterLabel::openOggVorbis( unsigned char *buf, long len, int &channels, int &rate )
+OVInfo *ONScripterLabel::openOggVorbis( unsigned char *buf, long len, int &channels, int &rate, SDL_RWops *rw )
 {
     OVInfo *ovi = NULL;
 
@@ -1153,6 +1305,7 @@ OVInfo *ONScripterLabel::openOggVorbis( unsigned char *buf, long len, int &chann
     ovi = new OVInfo();
 
     ovi->buf = buf;
+    ovi->rw = rw;
     ovi->decoded_length = 0;
     ovi->length = len;
     ovi->pos = 0;
@@ -1164,6 +1317,7 @@ OVInfo *ONScripterLabel::openOggVorbis( unsigned char *buf, long len, int &chann
     oc.tell_func  = oc_tell_func;
     if (ov_open_callbacks(ovi, &ovi->ovf, NULL, 0, oc) < 0){
         delete ovi;
+        if (rw) SDL_RWclose(rw);
         return NULL;
     }
 
@@ -1171,6 +1325,7 @@ OVInfo *ONScripterLabel::openOggVorbis( unsigned char *buf, long len, int &chann
     if (vi == NULL){
         ov_clear(&ovi->ovf);
         delete ovi;
+        if (rw) SDL_RWclose(rw);
         return NULL;
     }
 
@@ -1186,20 +1341,120 @@ OVInfo *ONScripterLabel::openOggVorbis( unsigned char *buf, long len, int &chann
     ovi->mult2 = (int)(ovi->cvt.len_ratio*10.0);
 
     ovi->decoded_length = (long)(ov_pcm_total(&ovi->ovf, -1) * channels * 2);
+#else
+    if (rw) SDL_RWclose(rw);
 #endif
 
     return ovi;
 }
 
+bool ONScripterLabel::startMusicStream()
+{
+    OVInfo *ovi = music_struct.ovi;
+
+    // cvt.buf is the one buffer the decoder works in, sized for a chunk
+    int len_mult = ovi->cvt.needed ? ovi->cvt.len_mult : 1;
+    if (ovi->cvt_len < MUSIC_STREAM_CHUNK*len_mult){
+        if (ovi->cvt.buf) delete[] ovi->cvt.buf;
+        ovi->cvt.buf = new Uint8[MUSIC_STREAM_CHUNK*len_mult];
+        ovi->cvt_len = MUSIC_STREAM_CHUNK*len_mult;
+    }
+
+    int size = audio_format.freq * audio_format.channels * 2 / 1000 * MUSIC_STREAM_MSEC;
+    if (size < ovi->cvt_len*2) size = ovi->cvt_len*2;
+    if (!music_ring.open(size)) return false;
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    music_struct.swap_bytes = !ovi->cvt.needed;
+#else
+    music_struct.swap_bytes = false;
+#endif
+
+    // have something ready for the first callback
+    for (int i=0 ; i<2 ; i++)
+        if (!decodeMusicStream()) break;
+
+    music_stream_thread = SDL_CreateThread( musicStreamThreadFunc, this );
+    if (music_stream_thread == NULL){
+        fprintf( stderr, "Warning: couldn't start the music stream thread\n" );
+        music_ring.close();
+        return false;
+    }
+    music_struct.ring = &music_ring;
+
+    return true;
+}
+
+void ONScripterLabel::stopMusicStream()
+{
+    if (music_stream_thread == NULL) return;
+
+    music_ring.cancel();
+    SDL_WaitThread( music_stream_thread, NULL );
+    music_stream_thread = NULL;
+
+    // the callback may still be hooked, so keep it off the ring first
+    SDL_LockAudio();
+    music_struct.ring = NULL;
+    SDL_UnlockAudio();
+
+    music_stream_underruns += music_ring.getUnderruns();
+    music_ring.close();
+}
+
+// decodes and converts one chunk of the bgm into music_ring;
+// false at the end of the stream
+bool ONScripterLabel::decodeMusicStream()
+{
+    OVInfo *ovi = music_struct.ovi;
+    long src_len = 0;
+
+#ifdef USE_OGG_VORBIS
+    int current_section;
+#ifdef INTEGER_OGG_VORBIS
+    src_len = ov_read( &ovi->ovf, (char*)ovi->cvt.buf, MUSIC_STREAM_CHUNK, &current_section);
+#else
+    src_len = ov_read( &ovi->ovf, (char*)ovi->cvt.buf, MUSIC_STREAM_CHUNK, 0, 2, 1, &current_section);
+#endif
+#endif
+    if (src_len <= 0){
+        music_ring.setFinished();
+        return false;
+    }
+
+    int len = src_len;
+    if (ovi->cvt.needed){
+        ovi->cvt.len = src_len;
+        SDL_ConvertAudio(&ovi->cvt);
+        len = ovi->cvt.len_cvt;
+    }
+    music_ring.write( ovi->cvt.buf, len );
+
+    return true;
+}
+
+int ONScripterLabel::musicStreamThreadFunc( void *data )
+{
+    ((ONScripterLabel*)data)->musicStreamThreadLoop();
+    return 0;
+}
+
+void ONScripterLabel::musicStreamThreadLoop()
+{
+    while (music_ring.waitForSpace( music_struct.ovi->cvt_len ))
+        if (!decodeMusicStream()) break;
+}
+
 int ONScripterLabel::closeOggVorbis(OVInfo *ovi)
 {
-    if (ovi->buf){
+    if (ovi->buf || ovi->rw){
         ovi->buf = NULL;
 #ifdef USE_OGG_VORBIS
         ovi->length = 0;
         ovi->pos = 0;
         ov_clear(&ovi->ovf);
 #endif
+        if (ovi->rw) SDL_RWclose(ovi->rw);
+        ovi->rw = NULL;
     }
     if (ovi->cvt.buf){
         delete[] ovi->cvt.buf;
@@ -169,39 +169,36 @@ static inline bool isNonPrinting(const char *text)
 
 SDL_Surface *ONScripterLabel::renderGlyph(TTF_Font *font, Uint16 text)
 {
-    GlyphCache *gc = root_glyph_cache;
-    GlyphCache *pre_gc = gc;
-    while(1){
-        if (gc->text == text &&
-            gc->font == font){
-            if (gc != pre_gc){
-                pre_gc->next = gc->next;
-                gc->next = root_glyph_cache;
-                root_glyph_cache = gc;
-            }
-            return gc->surface;
-        }
-        if (gc->next == NULL) break;
-        pre_gc = gc;
-        gc = gc->next;
-    }
-
-    pre_gc->next = NULL;
-    gc->next = root_glyph_cache;
-    root_glyph_cache = gc;
-
-    gc->text = text;
-    gc->font = font;
-    if (gc->surface != NULL) SDL_FreeSurface(gc->surface);
+    int style = TTF_GetFontStyle( font );
+    SDL_Surface *surface = glyph_cache.get( font, style, text );
+    if (surface) return surface;
 
     /* Initializing SDL_Color.unused here to silence warnings about unused
        variables. 32 bit operations should be faster than 24 bit ones anyway.
        Users will be delighted by this 0.0000001 microsecond increase in speed.
      (contribution by Andrius, March 2010) */
     static SDL_Color fcol={0xff, 0xff, 0xff, 0xff}, bcol={0, 0, 0, 0};
-    gc->surface = TTF_RenderGlyph_Shaded( font, text, fcol, bcol );
+    return glyph_cache.add( font, style, text,
+                            TTF_RenderGlyph_Shaded( font, text, fcol, bcol ) );
+}
 
-    return gc->surface;
+int ONScripterLabel::glyphMetrics( TTF_Font *font, Uint16 text, int *minx, int *maxx,
+                                   int *miny, int *maxy, int *advance )
+{
+    int style = TTF_GetFontStyle( font );
+    GlyphCache::Metrics m;
+    if (!glyph_cache.getMetrics( font, style, text, &m )){
+        if (TTF_GlyphMetrics( font, text, &m.minx, &m.maxx, &m.miny, &m.maxy, &m.advance ) != 0)
+            return -1;
+        glyph_cache.addMetrics( font, style, text, m );
+    }
+
+    *minx = m.minx;
+    *maxx = m.maxx;
+    *miny = m.miny;
+    *maxy = m.maxy;
+    *advance = m.advance;
+    return 0;
 }
 
 void ONScripterLabel::drawGlyph( SDL_Surface *dst_surface, Fontinfo *info, SDL_Color &color, char* text, int xy[2], bool shadow_flag, AnimationInfo *cache_info, SDL_Rect *clip, SDL_Rect &dst_rect )
@@ -231,8 +228,8 @@ void ONScripterLabel::drawGlyph( SDL_Surface *dst_surface, Fontinfo *info, SDL_C
         (info->is_bold?TTF_STYLE_BOLD:TTF_STYLE_NORMAL) )
         TTF_SetFontStyle( (TTF_Font*)info->ttf_font, (info->is_bold?TTF_STYLE_BOLD:TTF_STYLE_NORMAL));
 #endif
-    TTF_GlyphMetrics( (TTF_Font*)info->ttf_font, unicode,
-                      &minx, &maxx, &miny, &maxy, &advanced );
+    glyphMetrics( (TTF_Font*)info->ttf_font, unicode,
+                  &minx, &maxx, &miny, &maxy, &advanced );
     //printf("min %d %d %d %d %d %d\n", minx, maxx, miny, maxy, advanced,TTF_FontAscent((TTF_Font*)info->ttf_font)  );
 
     SDL_Surface *tmp_surface = renderGlyph( (TTF_Font*)info->ttf_font, unicode );
@@ -358,7 +355,10 @@ void ONScripterLabel::drawChar( char* text, Fontinfo *info, bool flush_flag,
              !flush_flag &&
              (!clip || AnimationInfo::doClipping( &dst_rect, clip ) == 0) ){
             info->addShadeArea(dst_rect, shade_distance);
-            dirty_rect.add( dst_rect );
+            if ( text_batch_area )
+                *text_batch_area = dirty_rect.calcBoundingBox( *text_batch_area, dst_rect );
+            else
+                dirty_rect.add( dst_rect );
         }
         else if ( flush_flag ){
             info->addShadeArea(dst_rect, shade_distance);
@@ -407,6 +407,11 @@ void ONScripterLabel::drawString( const char *str, uchar3 color, Fontinfo *info,
     setColor(org_color, info->color);
     setColor(info->color, color);
 
+    // one dirty rect for the whole string rather than one per glyph
+    SDL_Rect batch_area = {0, 0, 0, 0};
+    SDL_Rect *outer_batch_area = text_batch_area;
+    if ( !outer_batch_area ) text_batch_area = &batch_area;
+
     bool tateyoko = (info->getTateyokoMode() == Fontinfo::TATE_MODE);
     char text[5] = { '\0', '\0', '\0', '\0', '\0' };
     while( *str ){
@@ -552,6 +557,12 @@ void ONScripterLabel::drawString( const char *str, uchar3 color, Fontinfo *info,
     }
     for ( i=0 ; i<3 ; i++ ) info->color[i] = org_color[i];
 
+    if ( !outer_batch_area ){
+        text_batch_area = NULL;
+        if ( batch_area.w > 0 && batch_area.h > 0 )
+            dirty_rect.add( batch_area );
+    }
+
     /* ---------------------------------------- */
     /* Calculate the area of selection */
     SDL_Rect clipped_rect = info->calcUpdatedArea(start_xy, screen_ratio1, screen_ratio2, script_h.enc.getEncoding());
@@ -568,11 +579,16 @@ void ONScripterLabel::restoreTextBuffer(SDL_Surface *surface)
 {
     text_info.fill( 0, 0, 0, 0 );
 
+    // one dirty rect for the page rather than one per glyph
+    SDL_Rect area = {0, 0, 0, 0};
+
     char out_text[5] = { '\0', '\0', '\0', '\0', '\0' };
     Fontinfo f_info = sentence_font;
     f_info.clear();
     bool tateyoko = (f_info.getTateyokoMode() == Fontinfo::TATE_MODE);
 
+    text_batch_area = &area;
+
     int n;
     for ( int i=0 ; i<current_page->text_count ; i+=n  ){
         n = script_h.enc.getBytes(current_page->text[i]);
@@ -649,6 +665,9 @@ void ONScripterLabel::restoreTextBuffer(SDL_Surface *surface)
             drawChar( out_text, &f_info, false, false, surface, &text_info );
         }
     }
+
+    text_batch_area = NULL;
+    if ( area.w > 0 && area.h > 0 ) dirty_rect.add( area );
 }
 
 void ONScripterLabel::enterTextDisplayMode(bool text_flag)
@@ -1569,6 +1588,16 @@ bool ONScripterLabel::processBreaks(bool cont_line, LineBreakType style)
     string_buffer_margins = new char[len];
     for (i=0; i<len; i++) string_buffer_margins[i] = 0;
 
+    // findNextBreak runs once per character and re-measures the rest of
+    // the word each time; remember every width it takes for this buffer
+    if (string_buffer_px) delete[] string_buffer_px;
+    if (string_buffer_px_n) delete[] string_buffer_px_n;
+    string_buffer_px_len = len+2;
+    string_buffer_px = new float[string_buffer_px_len];
+    string_buffer_px_n = new char[string_buffer_px_len];
+    for (i=0; i<(unsigned int)string_buffer_px_len; i++) string_buffer_px_n[i] = 0;
+    string_buffer_px_font = sentence_font.ttf_font;
+
     i = 0;
     // first skip past starting text commands
     do {
@@ -1851,7 +1880,19 @@ int ONScripterLabel::findNextBreak(int offset, int &len)
                 }
                 //if (debug_msg) printf("Checking char: %x-%x-%x-%x [%s]\n", check_text[0], check_text[1], check_text[2], check_text[3], check_text);
                 //if (debug_msg) printf("\tAdded length: %f\n", strpxlen(check_text, &sentence_font));
-                len += strpxlen(check_text, &sentence_font);
+                if (string_buffer_px_font != sentence_font.ttf_font){
+                    for (int j=0; j<string_buffer_px_len; j++) string_buffer_px_n[j] = 0;
+                    string_buffer_px_font = sentence_font.ttf_font;
+                }
+                if (i < string_buffer_px_len){
+                    if (string_buffer_px_n[i] != n){
+                        string_buffer_px[i] = strpxlen(check_text, &sentence_font);
+                        string_buffer_px_n[i] = n;
+                    }
+                    len += string_buffer_px[i];
+                }
+                else
+                    len += strpxlen(check_text, &sentence_font);
                 //if (debug_msg) printf("\tLen: %d\n", len);
                 //if (debug_msg) printf("\tAdvancing to next character (%d of %d) by %d bytes\n", i+1, toCheck, n);
             }
@@ -2155,8 +2196,8 @@ float ONScripterLabel::strpxlen(const char *buf, Fontinfo *fi)
         int minx, maxx, miny, maxy, advanced_int;
         //TTF_GlyphMetrics((TTF_Font*)fi->ttf_font[font_index], unicode,
         //                 &minx, &maxx, &miny, &maxy, &advanced_int);
-        TTF_GlyphMetrics((TTF_Font*)fi->ttf_font, unicode,
-                         &minx, &maxx, &miny, &maxy, &advanced_int);
+        glyphMetrics((TTF_Font*)fi->ttf_font, unicode,
+                     &minx, &maxx, &miny, &maxy, &advanced_int);
 
         advanced = (float) advanced_int;
 
@@ -16,6 +16,9 @@ public:
     virtual const char *get_all_paths() const = 0;
     virtual int get_num_paths() const = 0;
     virtual size_t max_path_len() const = 0;
+    // 1 if the file is known to exist under one of the paths, 0 if it is
+    // known not to, -1 if the provider keeps no listing to ask
+    virtual int has_file( const char* /*path*/ ) const { return -1; }
 };
 
 #endif // __PATHPROVIDER_H__
@@ -0,0 +1,228 @@
+/* -*- C++ -*-
+ *
+ *  ReadAheadStream.cpp - An SDL_RWops read ahead of its reader on a thread
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ReadAheadStream.h"
+#include <string.h>
+
+ReadAheadStream::ReadAheadStream( SDL_RWops *src, size_t length, int size )
+{
+    this->src = src;
+    this->length = length;
+    if (size < 1) size = 1;
+    this->size = size;
+    data = new unsigned char[size];
+    pos = 0;
+    src_pos = -1;
+    thread = NULL;
+    mutex = SDL_CreateMutex();
+    data_cond = SDL_CreateCond();
+    space_cond = SDL_CreateCond();
+
+    buf_start = 0;
+    rpos = fill = 0;
+    generation = 0;
+    eof = cancelled = false;
+}
+
+ReadAheadStream::~ReadAheadStream()
+{
+    if (thread){
+        SDL_LockMutex( mutex );
+        cancelled = true;
+        SDL_CondSignal( space_cond );
+        SDL_UnlockMutex( mutex );
+        SDL_WaitThread( thread, NULL );
+    }
+    if (space_cond) SDL_DestroyCond( space_cond );
+    if (data_cond) SDL_DestroyCond( data_cond );
+    if (mutex) SDL_DestroyMutex( mutex );
+    delete[] data;
+    if (src) SDL_RWclose( src );
+}
+
+bool ReadAheadStream::start()
+{
+    if (thread) return true;
+    if (mutex == NULL || data_cond == NULL || space_cond == NULL)
+        return false;
+
+    thread = SDL_CreateThread( threadFunc, this );
+    return thread != NULL;
+}
+
+size_t ReadAheadStream::read( void *buf, size_t len )
+{
+    if (pos >= length) return 0;
+    if (len > length - pos) len = length - pos;
+
+    unsigned char *dst = (unsigned char*)buf;
+    size_t done = 0;
+
+    SDL_LockMutex( mutex );
+    if (pos < buf_start || pos > buf_start + fill)
+        restart( pos );
+    else if (pos > buf_start)
+        drop( (int)(pos - buf_start) );
+
+    while (done < len){
+        while (fill == 0 && !eof)
+            SDL_CondWait( data_cond, mutex );
+        if (fill == 0) break;
+
+        int n = size - rpos;
+        if (n > fill) n = fill;
+        if ((size_t)n > len - done) n = (int)(len - done);
+        int p = rpos;
+        SDL_UnlockMutex( mutex );
+        memcpy( dst + done, data + p, n );
+        SDL_LockMutex( mutex );
+        drop( n );
+        done += n;
+    }
+    SDL_UnlockMutex( mutex );
+    pos += done;
+
+    return done;
+}
+
+bool ReadAheadStream::seek( size_t pos )
+{
+    if (pos > length) return false;
+    this->pos = pos;
+
+    return true;
+}
+
+void ReadAheadStream::restart( size_t pos )
+{
+    generation++;
+    buf_start = pos;
+    rpos = fill = 0;
+    eof = false;
+    SDL_CondSignal( space_cond );
+}
+
+void ReadAheadStream::drop( int len )
+{
+    rpos = (rpos + len) % size;
+    fill -= len;
+    buf_start += len;
+    SDL_CondSignal( space_cond );
+}
+
+int ReadAheadStream::threadFunc( void *data )
+{
+    ((ReadAheadStream*)data)->threadLoop();
+    return 0;
+}
+
+void ReadAheadStream::threadLoop()
+{
+    SDL_LockMutex( mutex );
+    while (!cancelled){
+        if (eof || fill == size){
+            SDL_CondWait( space_cond, mutex );
+            continue;
+        }
+
+        unsigned int gen = generation;
+        size_t offset = buf_start + fill;
+        int wpos = (rpos + fill) % size;
+        int len = size - fill;
+        if (len > size - wpos) len = size - wpos;
+        if (len > READ_LENGTH) len = READ_LENGTH;
+        if (offset >= length) len = 0;
+        else if ((size_t)len > length - offset) len = (int)(length - offset);
+        SDL_UnlockMutex( mutex );
+
+        // the reader never looks past fill, so this needs no lock
+        int ret = 0;
+        if (len > 0 &&
+            (src_pos == (long)offset ||
+             SDL_RWseek( src, (int)offset, RW_SEEK_SET ) >= 0))
+            ret = SDL_RWread( src, data + wpos, 1, len );
+        src_pos = (ret > 0) ? (long)offset + ret : -1;
+
+        SDL_LockMutex( mutex );
+        if (gen != generation) continue;
+        if (ret <= 0) eof = true;
+        else          fill += ret;
+        SDL_CondSignal( data_cond );
+    }
+    SDL_UnlockMutex( mutex );
+}
+
+int ReadAheadStream::rwSeek( SDL_RWops *rw, int offset, int whence )
+{
+    ReadAheadStream *stream = (ReadAheadStream*)rw->hidden.unknown.data1;
+
+    long pos = offset;
+    if ( whence == RW_SEEK_CUR )      pos += (long)stream->tell();
+    else if ( whence == RW_SEEK_END ) pos += (long)stream->getLength();
+    if ( pos < 0 || !stream->seek( (size_t)pos ) ){
+        SDL_SetError( "ReadAheadStream: can't seek to %ld", pos );
+        return -1;
+    }
+
+    return (int)stream->tell();
+}
+
+int ReadAheadStream::rwRead( SDL_RWops *rw, void *ptr, int size, int maxnum )
+{
+    ReadAheadStream *stream = (ReadAheadStream*)rw->hidden.unknown.data1;
+    if ( size <= 0 || maxnum <= 0 ) return 0;
+
+    return (int)(stream->read( ptr, (size_t)size*maxnum ) / size);
+}
+
+int ReadAheadStream::rwWrite( SDL_RWops * /*rw*/, const void * /*ptr*/, int /*size*/, int /*num*/ )
+{
+    SDL_SetError( "ReadAheadStream: read only" );
+    return -1;
+}
+
+int ReadAheadStream::rwClose( SDL_RWops *rw )
+{
+    if ( rw ){
+        delete (ReadAheadStream*)rw->hidden.unknown.data1;
+        SDL_FreeRW( rw );
+    }
+    return 0;
+}
+
+SDL_RWops *ReadAheadStream::createRWops( SDL_RWops *src, size_t length, int size )
+{
+    ReadAheadStream *stream = new ReadAheadStream( src, length, size );
+    SDL_RWops *rw = SDL_AllocRW();
+    if ( rw == NULL || !stream->start() ){
+        if ( rw ) SDL_FreeRW( rw );
+        stream->src = NULL;
+        delete stream;
+        return src;
+    }
+
+    rw->seek  = rwSeek;
+    rw->read  = rwRead;
+    rw->write = rwWrite;
+    rw->close = rwClose;
+    rw->hidden.unknown.data1 = stream;
+
+    return rw;
+}
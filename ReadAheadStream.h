@@ -0,0 +1,83 @@
+/* -*- C++ -*-
+ *
+ *  ReadAheadStream.h - An SDL_RWops read ahead of its reader on a thread
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __READ_AHEAD_STREAM_H__
+#define __READ_AHEAD_STREAM_H__
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+// Keeps up to size bytes of src read ahead of the reader on a thread of
+// its own, so a reader going forward, like SMPEG, finds its next bytes
+// already in memory.  seek() only moves the reader; a read landing past
+// what has been read ahead, or before it, starts the thread over there.
+// Meant for one reader at a time.
+class ReadAheadStream
+{
+public:
+    ReadAheadStream( SDL_RWops *src, size_t length, int size ); // takes src
+    ~ReadAheadStream();
+
+    bool start(); // false if the thread can't be started
+
+    size_t read( void *buf, size_t len );
+    bool seek( size_t pos );
+    size_t tell() const { return pos; }
+    size_t getLength() const { return length; }
+
+    // an SDL_RWops owning a new ReadAheadStream on src, freed by
+    // SDL_RWclose; src itself if the thread can't be started
+    static SDL_RWops *createRWops( SDL_RWops *src, size_t length, int size );
+
+private:
+    ReadAheadStream( const ReadAheadStream & );
+    ReadAheadStream& operator =( const ReadAheadStream & );
+
+    enum { READ_LENGTH = 65536 };
+
+    void restart( size_t pos );
+    void drop( int len );
+    static int threadFunc( void *data );
+    void threadLoop();
+
+    static int rwSeek( SDL_RWops *rw, int offset, int whence );
+    static int rwRead( SDL_RWops *rw, void *ptr, int size, int maxnum );
+    static int rwWrite( SDL_RWops *rw, const void *ptr, int size, int num );
+    static int rwClose( SDL_RWops *rw );
+
+    SDL_RWops *src;
+    size_t length;
+    unsigned char *data;
+    int size;
+    size_t pos;     // the reader's, not yet matched up with buf_start
+    long src_pos;   // where the thread left src, -1 if unknown
+    SDL_Thread *thread;
+    SDL_mutex *mutex;
+    SDL_cond *data_cond, *space_cond;
+
+    // guarded by mutex; fill bytes from rpos in data are src from
+    // buf_start on, and only the reader touches them
+    size_t buf_start;
+    int rpos, fill;
+    unsigned int generation; // bumped by restart() to void reads in flight
+    bool eof, cancelled;
+};
+
+#endif // __READ_AHEAD_STREAM_H__
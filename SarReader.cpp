@@ -31,6 +31,9 @@
 // creating new archives via nsamake, ns2make & sarmake
 
 #include "SarReader.h"
+#ifdef HAVE_MMAP_ARCHIVES
+#include <sys/stat.h>
+#endif
 #define WRITE_LENGTH 4096
 
 SarReader::SarReader( PathProvider &provider, const unsigned char *key_table )
@@ -38,11 +41,18 @@ SarReader::SarReader( PathProvider &provider, const unsigned char *key_table )
 {
     root_archive_info = last_archive_info = &archive_info;
     num_of_sar_archives = 0;
+
+    index_list = NULL;
+    index_table = NULL;
+    num_of_index_entries = index_list_size = 0;
+    index_table_mask = 0;
+    index_dirty = true;
 }
 
 SarReader::~SarReader()
 {
     close();
+    clearIndex();
 }
 
 int SarReader::open( const char *name )
@@ -104,6 +114,7 @@ SarReader::ArchiveInfo* SarReader::openForCreate( const char *name )
     last_archive_info->next = info;
     last_archive_info = last_archive_info->next;
     num_of_sar_archives++;
+    index_dirty = true;
 
     return info;
 }
@@ -113,7 +124,9 @@ SarReader::ArchiveInfo* SarReader::openForCreate( const char *name )
 int SarReader::readArchive( struct ArchiveInfo *ai, int archive_type, int offset )
 {
     unsigned int i=0;
-    
+
+    index_dirty = true;
+
     /* Read header */
     for (int j=0; j<offset; j++)
         i = readChar( ai->file_handle );
@@ -219,10 +232,34 @@ int SarReader::readArchive( struct ArchiveInfo *ai, int archive_type, int offset
             }
         }
     }
-    
+
+    mapArchive( ai );
+
     return 0;
 }
 
+// Maps the whole archive so that uncompressed entries can be copied or
+// handed out without going through stdio; stays on stdio if that fails.
+void SarReader::mapArchive( ArchiveInfo *ai )
+{
+#ifdef HAVE_MMAP_ARCHIVES
+    if ( ai->mapped_data || ai->file_handle == NULL ) return;
+
+    struct stat st;
+    int fd = fileno( ai->file_handle );
+    if ( fstat( fd, &st ) != 0 || st.st_size <= 0 ) return;
+    if ( (off_t)(size_t)st.st_size != st.st_size ) return;
+
+    void *data = mmap( NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    if ( data == MAP_FAILED ) return;
+
+    ai->mapped_data = (unsigned char*)data;
+    ai->mapped_length = (size_t)st.st_size;
+#else
+    (void)ai;
+#endif
+}
+
 #ifdef TOOLS_BUILD
 
 int SarReader::writeHeaderSub( ArchiveInfo *ai, FILE *fp, int archive_type, int offset )
@@ -384,6 +421,9 @@ int SarReader::close()
         delete last_archive_info;
     }
     num_of_sar_archives = 0;
+    last_archive_info = &archive_info;
+    archive_info.next = NULL;
+    clearIndex();
 
     return 0;
 }
@@ -394,21 +434,104 @@ const char *SarReader::getArchiveName() const
 }
 
 int SarReader::getNumFiles(){
+    if ( index_dirty ) buildIndex();
+
+    return num_of_index_entries;
+}
+
+// FNV-1a over the already case-folded name
+static unsigned int hashName( const char *name )
+{
+    unsigned int h = 2166136261u;
+    while ( *name ){
+        h ^= (unsigned char) *name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void SarReader::clearIndex()
+{
+    if (index_list) delete[] index_list;
+    if (index_table) delete[] index_table;
+    index_list = NULL;
+    index_table = NULL;
+    num_of_index_entries = index_list_size = 0;
+    index_table_mask = 0;
+    index_dirty = true;
+}
+
+void SarReader::addIndexArchive( ArchiveInfo *ai, int location )
+{
+    unsigned int needed = num_of_index_entries + ai->num_of_files;
+    if ( needed > index_list_size ){
+        unsigned int size = index_list_size ? index_list_size : 256;
+        while ( size < needed ) size <<= 1;
+        IndexEntry *tmp = new IndexEntry[size];
+        if (index_list){
+            memcpy( tmp, index_list, sizeof(IndexEntry) * num_of_index_entries );
+            delete[] index_list;
+        }
+        index_list = tmp;
+        index_list_size = size;
+    }
+
+    for ( unsigned int i=0 ; i<ai->num_of_files ; i++ ){
+        IndexEntry &ie = index_list[num_of_index_entries++];
+        ie.ai = ai;
+        ie.no = i;
+        ie.location = location;
+    }
+}
+
+void SarReader::indexArchives()
+{
     ArchiveInfo *info = archive_info.next;
-    int num = 0;
-    
     for ( int i=0 ; i<num_of_sar_archives ; i++ ){
-        num += info->num_of_files;
+        addIndexArchive( info, ARCHIVE_TYPE_SAR );
         info = info->next;
     }
-    
-    return num;
 }
 
-int SarReader::getIndexFromFile( ArchiveInfo *ai, const char *file_name )
+void SarReader::buildIndex()
+{
+    unsigned int i, h;
+
+    num_of_index_entries = 0;
+    indexArchives();
+
+    unsigned int size = 16;
+    while ( size < num_of_index_entries * 2 ) size <<= 1;
+    if ( size != index_table_mask + 1 || !index_table ){
+        if (index_table) delete[] index_table;
+        index_table = new int[size];
+        index_table_mask = size - 1;
+    }
+    for ( i=0 ; i<size ; i++ ) index_table[i] = -1;
+
+    // keep the first entry for each name, so earlier archives take priority
+    for ( i=0 ; i<num_of_index_entries ; i++ ){
+        const char *name = index_list[i].ai->fi_list[ index_list[i].no ].name;
+        h = hashName( name ) & index_table_mask;
+        while ( index_table[h] >= 0 ){
+            IndexEntry &ie = index_list[ index_table[h] ];
+            if ( !strcmp( name, ie.ai->fi_list[ie.no].name ) ) break;
+            h = (h + 1) & index_table_mask;
+        }
+        if ( index_table[h] < 0 ) index_table[h] = i;
+    }
+
+    index_dirty = false;
+}
+
+SarReader::IndexEntry *SarReader::findIndex( const char *file_name )
 {
     unsigned int i, len;
 
+    if ( file_name == NULL ) return NULL;
+    if ( index_dirty ) buildIndex();
+    if ( num_of_index_entries == 0 ) return NULL;
+
     len = strlen( file_name );
     if ( len > MAX_FILE_NAME_LENGTH ) len = MAX_FILE_NAME_LENGTH;
     memcpy( capital_name, file_name, len );
@@ -418,50 +541,123 @@ int SarReader::getIndexFromFile( ArchiveInfo *ai, const char *file_name )
         if ( 'a' <= capital_name[i] && capital_name[i] <= 'z' ) capital_name[i] += 'A' - 'a';
         else if ( capital_name[i] == '/' ) capital_name[i] = '\\';
     }
-    for ( i=0 ; i<ai->num_of_files ; i++ ){
-        if ( !strcmp( capital_name, ai->fi_list[i].name ) ) break;
+
+    unsigned int h = hashName( capital_name ) & index_table_mask;
+    while ( index_table[h] >= 0 ){
+        IndexEntry *ie = &index_list[ index_table[h] ];
+        if ( !strcmp( capital_name, ie->ai->fi_list[ie->no].name ) ) return ie;
+        h = (h + 1) & index_table_mask;
     }
 
-    return i;
+    return NULL;
 }
 
-size_t SarReader::getFileLength( const char *file_name )
+size_t SarReader::getFileLengthSub( IndexEntry *ie, const char *file_name )
 {
-#ifndef TOOLS_BUILD
-    size_t ret;
-    if ( ( ret = DirectReader::getFileLength( file_name ) ) ) return ret;
-#endif
-    ArchiveInfo *info = archive_info.next;
-    unsigned int j = 0;
-    for ( int i=0 ; i<num_of_sar_archives ; i++ ){
-        j = getIndexFromFile( info, file_name );
-        if ( j != info->num_of_files ) break;
-        info = info->next;
-    }
-    if ( !info ) return 0;
-    
-    if ( info->fi_list[j].original_length != 0 ){
-        return info->fi_list[j].original_length;
+    FileInfo &fi = ie->ai->fi_list[ie->no];
+
+    if ( fi.original_length != 0 ){
+        return fi.original_length;
     }
 
-    int type = info->fi_list[j].compression_type;
+    int type = fi.compression_type;
     if ( type == NO_COMPRESSION )
         type = getRegisteredCompressionType( file_name );
     if ( type == NBZ_COMPRESSION || type == SPB_COMPRESSION ) {
-        info->fi_list[j].original_length = getDecompressedFileLength( type, info->file_handle, info->fi_list[j].offset );
+        fi.original_length = getDecompressedFileLength( type, ie->ai->file_handle, fi.offset );
     }
     
-    return info->fi_list[j].original_length;
+    return fi.original_length;
+}
+
+bool SarReader::openFile( const char *file_name, FileRef &ref )
+{
+#ifndef TOOLS_BUILD
+    // loose files take priority over archived ones
+    if ( DirectReader::openFile( file_name, ref ) ) return true;
+#else
+    closeFile( ref );
+#endif
+    IndexEntry *ie = findIndex( file_name );
+    if ( !ie ) return false;
+
+    FileInfo &fi = ie->ai->fi_list[ie->no];
+    ref.length = getFileLengthSub( ie, file_name );
+    if ( ref.length == 0 ) return false;
+
+    ref.ai = ie->ai;
+    ref.no = ie->no;
+    ref.location = ie->location;
+    ref.compression_type = fi.compression_type;
+    if ( ref.compression_type == NO_COMPRESSION )
+        ref.compression_type = getRegisteredCompressionType( file_name );
+
+    // encrypted archives need every byte translated, so no direct view
+    if ( ref.compression_type == NO_COMPRESSION && !key_table_flag &&
+         ref.ai->mapped_data && fi.offset + fi.length <= ref.ai->mapped_length )
+        ref.view = ref.ai->mapped_data + fi.offset;
+
+    return true;
+}
+
+size_t SarReader::readFile( FileRef &ref, unsigned char *buffer )
+{
+    if ( ref.ai == NULL ) return DirectReader::readFile( ref, buffer );
+
+    size_t ret = getFileSub( ref.ai, ref.no, ref.compression_type, buffer );
+    closeFile( ref );
+
+    return ret;
 }
 
-size_t SarReader::getFileSub( ArchiveInfo *ai, const char *file_name, unsigned char *buf )
+bool SarReader::openStream( FileRef &ref, StreamSource &src )
 {
-    unsigned int i = getIndexFromFile( ai, file_name );
-    if ( i == ai->num_of_files ) return 0;
+    if ( ref.ai == NULL ) return DirectReader::openStream( ref, src );
+
+    // LZSS and SPB can only be decoded whole, and NBZ is never encrypted
+    if ( ref.compression_type != NO_COMPRESSION &&
+         ref.compression_type != NBZ_COMPRESSION ) return false;
+    FileInfo &fi = ref.ai->fi_list[ref.no];
+    if ( ref.compression_type == NBZ_COMPRESSION &&
+         (key_table_flag || fi.length < 4) ) return false;
+
+    // a handle of its own, so the stream never moves ai->file_handle
+    FILE *fp = ::fopen( ref.ai->file_name, "rb" );
+    if ( fp == NULL ) fp = fopen( ref.ai->file_name, "rb" );
+    if ( fp == NULL ) return false;
+
+    src = StreamSource();
+    src.fp = fp;
+    src.offset = fi.offset;
+    src.length = fi.length;
+    src.original_length = ref.length;
+    src.compression_type = ref.compression_type;
+    if ( src.compression_type == NBZ_COMPRESSION ){
+        src.offset += 4;
+        src.length -= 4;
+    }
+    if ( key_table_flag ){
+        src.key_table_flag = true;
+        memcpy( src.key_table, key_table, 256 );
+    }
+    closeFile( ref );
+
+    return true;
+}
 
-    int type = ai->fi_list[i].compression_type;
-    if ( type == NO_COMPRESSION ) type = getRegisteredCompressionType( file_name );
+size_t SarReader::getFileLength( const char *file_name )
+{
+    FileRef ref;
+    if ( !openFile( file_name, ref ) ) return 0;
 
+    size_t len = ref.length;
+    closeFile( ref );
+
+    return len;
+}
+
+size_t SarReader::getFileSub( ArchiveInfo *ai, unsigned int i, int type, unsigned char *buf )
+{
     if      ( type == NBZ_COMPRESSION ){
         return decodeNBZ( ai->file_handle, ai->fi_list[i].offset, buf );
     }
@@ -472,6 +668,17 @@ size_t SarReader::getFileSub( ArchiveInfo *ai, const char *file_name, unsigned c
         return decodeSPB( ai->file_handle, ai->fi_list[i].offset, buf );
     }
 
+    if ( ai->mapped_data &&
+         ai->fi_list[i].offset + ai->fi_list[i].length <= ai->mapped_length ){
+        const unsigned char *src = ai->mapped_data + ai->fi_list[i].offset;
+        size_t ret = ai->fi_list[i].length;
+        if ( key_table_flag )
+            for (size_t j=0 ; j<ret ; j++) buf[j] = key_table[src[j]];
+        else
+            memcpy( buf, src, ret );
+        return ret;
+    }
+
     fseek( ai->file_handle, ai->fi_list[i].offset, SEEK_SET );
     size_t ret = fread( buf, 1, ai->fi_list[i].length, ai->file_handle );
     for (size_t j=0 ; j<ret ; j++) buf[j] = key_table[buf[j]];
@@ -480,29 +687,23 @@ size_t SarReader::getFileSub( ArchiveInfo *ai, const char *file_name, unsigned c
 
 size_t SarReader::getFile( const char *file_name, unsigned char *buf, int *location )
 {
-    size_t ret;
-    if ( ( ret = DirectReader::getFile( file_name, buf, location ) ) ) return ret;
+    FileRef ref;
+    if ( location ) *location = ARCHIVE_TYPE_NONE;
+    if ( !openFile( file_name, ref ) ) return 0;
 
-    ArchiveInfo *info = archive_info.next;
-    size_t j = 0;
-    for ( int i=0 ; i<num_of_sar_archives ; i++ ){
-        if ( (j = getFileSub( info, file_name, buf )) > 0 ) break;
-        info = info->next;
-    }
-    if ( location ) *location = ARCHIVE_TYPE_SAR;
+    if ( location ) *location = ref.location;
     
-    return j;
+    return readFile( ref, buf );
 }
 
 struct SarReader::FileInfo SarReader::getFileByIndex( unsigned int index )
 {
-    ArchiveInfo *info = archive_info.next;
-    for ( int i=0 ; i<num_of_sar_archives ; i++ ){
-        if ( index < info->num_of_files ) return info->fi_list[index];
-        index -= info->num_of_files;
-        info = info->next;
-    }
+    if ( index_dirty ) buildIndex();
+    if ( index < num_of_index_entries )
+        return index_list[index].ai->fi_list[ index_list[index].no ];
+
     fprintf( stderr, "SarReader::getFileByIndex  Index %d is out of range\n", index );
 
-    return archive_info.fi_list[index];
+    FileInfo fi;
+    return fi;
 }
@@ -47,6 +47,9 @@ public:
     
     size_t getFileLength( const char *file_name );
     size_t getFile( const char *file_name, unsigned char *buf, int *location=NULL );
+    bool openFile( const char *file_name, FileRef &ref );
+    size_t readFile( FileRef &ref, unsigned char *buffer );
+    bool openStream( FileRef &ref, StreamSource &src );
     struct FileInfo getFileByIndex( unsigned int index );
 
 #ifdef TOOLS_BUILD
@@ -61,9 +64,28 @@ protected:
     struct ArchiveInfo *root_archive_info, *last_archive_info;
     int num_of_sar_archives;
 
+    // Unified name index over every opened archive, in lookup priority
+    // order; the first archive holding a given name wins.
+    struct IndexEntry{
+        ArchiveInfo *ai;
+        unsigned int no;
+        int location;
+    };
+    IndexEntry *index_list;
+    unsigned int num_of_index_entries, index_list_size;
+    int *index_table; // open addressing, -1 = empty slot
+    unsigned int index_table_mask;
+    bool index_dirty;
+
     int readArchive( ArchiveInfo *ai, int archive_type = ARCHIVE_TYPE_SAR, int offset = 0 );
-    int getIndexFromFile( ArchiveInfo *ai, const char *file_name );
-    size_t getFileSub( ArchiveInfo *ai, const char *file_name, unsigned char *buf );
+    void mapArchive( ArchiveInfo *ai );
+    void buildIndex();
+    virtual void indexArchives();
+    void addIndexArchive( ArchiveInfo *ai, int location );
+    void clearIndex();
+    IndexEntry *findIndex( const char *file_name );
+    size_t getFileLengthSub( IndexEntry *ie, const char *file_name );
+    size_t getFileSub( ArchiveInfo *ai, unsigned int no, int type, unsigned char *buf );
 
 #ifdef TOOLS_BUILD
     int writeHeaderSub( ArchiveInfo *ai, FILE *fp, int archive_type = ARCHIVE_TYPE_SAR, int offset = 0 );
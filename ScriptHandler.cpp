@@ -58,10 +58,17 @@
 ScriptHandler::ScriptHandler()
 {
     num_of_labels = 0;
+    label_hash = NULL;
+    label_hash_size = 0;
+    for (int i=0 ; i<ALIAS_HASH_SIZE ; i++)
+        num_alias_hash[i] = str_alias_hash[i] = NULL;
     script_buffer = NULL;
     kidoku_buffer = NULL;
+    kidoku_written = NULL;
     log_info[LABEL_LOG].filename = "NScrllog.dat";
     log_info[FILE_LOG].filename  = "NScrflog.dat";
+    log_info[LABEL_LOG].num_written = log_info[FILE_LOG].num_written = -1;
+    log_info[LABEL_LOG].written_length = log_info[FILE_LOG].written_length = 0;
     clickstr_list = NULL;
 
     string_buffer       = new char[STRING_BUFFER_LENGTH];
@@ -111,6 +118,8 @@ ScriptHandler::~ScriptHandler()
 
     if ( script_buffer ) delete[] script_buffer;
     if ( kidoku_buffer ) delete[] kidoku_buffer;
+    if ( kidoku_written ) delete[] kidoku_written;
+    if ( label_hash ) delete[] label_hash;
 
     delete[] string_buffer;
     delete[] str_string_buffer;
@@ -179,6 +188,8 @@ void ScriptHandler::reset()
     };
     last_str_alias = &root_str_alias;
     last_str_alias->next = NULL;
+    for (int i=0 ; i<ALIAS_HASH_SIZE ; i++)
+        num_alias_hash[i] = str_alias_hash[i] = NULL;
 
     // reset misc. variables
     end_status = END_NONE;
@@ -281,6 +292,11 @@ void ScriptHandler::setSavedir( const char *dir )
           , 0755
 #endif
          );
+
+    // nothing has been written to the new savedir yet
+    if ( kidoku_written ) delete[] kidoku_written;
+    kidoku_written = NULL;
+    log_info[LABEL_LOG].num_written = log_info[FILE_LOG].num_written = -1;
 }
 
 // basic parser function
@@ -1119,23 +1135,33 @@ char *ScriptHandler::getAddressByLine( int line )
     return addr;
 }
 
+// label_info[] is in script order, so both lookups below are binary
+// searches for the last label starting at or before the given point
+
 ScriptHandler::LabelInfo ScriptHandler::getLabelByAddress( char *address )
 {
-    int i;
-    for ( i=0 ; i<num_of_labels-1 ; i++ ){
-        if ( label_info[i+1].start_address > address )
-            return label_info[i];
+    int lo = 1, hi = num_of_labels;
+    while ( lo < hi ){
+        int mid = (lo + hi) / 2;
+        if ( label_info[mid].start_address > address )
+            hi = mid;
+        else
+            lo = mid + 1;
     }
-    return label_info[i];
+    return label_info[ (lo > 1) ? lo-1 : 0 ];
 }
 
 ScriptHandler::LabelInfo ScriptHandler::getLabelByLine( int line )
 {
-    int i;
-    for ( i=0 ; i<num_of_labels-1 ; i++ ){
-        if ( label_info[i+1].start_line > line )
-            return label_info[i];
+    int lo = 1, hi = num_of_labels;
+    while ( lo < hi ){
+        int mid = (lo + hi) / 2;
+        if ( label_info[mid].start_line > line )
+            hi = mid;
+        else
+            lo = mid + 1;
     }
+    int i = (lo > 1) ? lo-1 : 0;
     if (i == num_of_labels-1) {
         int num_lines = label_info[i].start_line + label_info[i].num_of_lines;
         if (line >= num_lines) {
@@ -1184,6 +1210,80 @@ void ScriptHandler::skipLine( int no )
     next_script = current_script;
 }
 
+static bool isImageFileName( const char *name, int len )
+{
+    static const char *exts[] = { ".bmp", ".jpg", ".jpeg", ".png", ".gif", NULL };
+    for ( int i=0 ; exts[i] ; i++ ){
+        int j, n = strlen(exts[i]);
+        if ( len <= n ) continue;
+        for ( j=0 ; j<n ; j++ ){
+            char ch = name[len - n + j];
+            if ( 'A' <= ch && 'Z' >= ch ) ch += 'a' - 'A';
+            if ( ch != exts[i][j] ) break;
+        }
+        if ( j == n ) return true;
+    }
+    return false;
+}
+
+char *ScriptHandler::scanImageNames( char *pos, int max_lines,
+                                     ImageNameFunc func, void *data )
+{
+    char *end = script_buffer + script_buffer_length;
+    if ( (pos < script_buffer) || (pos >= end) ) return pos;
+
+    char cmd[32], name[256];
+    cmd[0] = '\0';
+    bool cmd_start = true;
+    int lines = 0;
+
+    while ( pos < end && lines < max_lines ){
+        if ( *pos == 0x0a ){
+            lines++;
+            pos++;
+            cmd_start = true;
+            continue;
+        }
+        if ( cmd_start ){
+            SKIP_SPACE(pos);
+            if ( *pos == '*' ) break; // next label
+            unsigned int i = 0;
+            while ( (*pos >= 'a' && *pos <= 'z') || (*pos >= 'A' && *pos <= 'Z') ||
+                    (*pos >= '0' && *pos <= '9') || *pos == '_' ){
+                char ch = *pos++;
+                if ( 'A' <= ch && 'Z' >= ch ) ch += 'a' - 'A';
+                if ( i < sizeof(cmd) - 1 ) cmd[i++] = ch;
+            }
+            cmd[i] = '\0';
+            cmd_start = false;
+            if ( !strcmp( cmd, "goto" ) || !strcmp( cmd, "return" ) ) break;
+            continue;
+        }
+        if ( *pos == ':' ){
+            cmd_start = true;
+            pos++;
+        }
+        else if ( *pos == ';' ){
+            while ( pos < end && *pos != 0x0a ) pos++;
+        }
+        else if ( *pos == '"' ){
+            char *start = ++pos;
+            while ( pos < end && *pos != '"' && *pos != 0x0a ) pos++;
+            int len = pos - start;
+            if ( *pos == '"' ) pos++;
+            if ( len < (int)sizeof(name) && isImageFileName( start, len ) ){
+                memcpy( name, start, len );
+                name[len] = '\0';
+                func( data, cmd, name );
+            }
+        }
+        else
+            pos++;
+    }
+
+    return pos;
+}
+
 // function for kidoku history
 bool ScriptHandler::isKidoku()
 {
@@ -1211,18 +1311,42 @@ void ScriptHandler::setKidokuskip( bool kidokuskip_flag )
 
 void ScriptHandler::saveKidokuData(bool no_error)
 {
-    FILE *fp;
+    FILE *fp = NULL;
+    size_t len = script_buffer_length/8;
+    size_t first = 0, last = len;
+
+    // marks only ever get set, so write back just the bytes that changed
+    if ( kidoku_written ){
+        while ( first < len && kidoku_buffer[first] == kidoku_written[first] ) first++;
+        if ( first == len ) return;
+        while ( kidoku_buffer[last-1] == kidoku_written[last-1] ) last--;
 
-    if ( ( fp = fopen( "kidoku.dat", "wb", true, true ) ) == NULL ){
+        fp = fopen( "kidoku.dat", "r+b", true, true );
+        if ( fp && fseek( fp, (long)first, SEEK_SET ) != 0 ){
+            fclose( fp );
+            fp = NULL;
+        }
+        if ( fp == NULL ){
+            first = 0;
+            last = len;
+        }
+    }
+
+    if ( fp == NULL && ( fp = fopen( "kidoku.dat", "wb", true, true ) ) == NULL ){
         if (!no_error)
             errorAndCont( "can't open kidoku.dat for writing", NULL, "I/O Warning" );
         return;
     }
 
-    if ( fwrite( kidoku_buffer, 1, script_buffer_length/8, fp ) !=
-         size_t(script_buffer_length/8) ){
+    if ( fwrite( kidoku_buffer + first, 1, last - first, fp ) != last - first ){
         if (!no_error)
             errorAndCont( "couldn't write to kidoku.dat", NULL, "I/O Warning" );
+        if ( kidoku_written ) delete[] kidoku_written;
+        kidoku_written = NULL;
+    }
+    else{
+        if ( kidoku_written == NULL ) kidoku_written = new char[ len + 1 ];
+        memcpy( kidoku_written + first, kidoku_buffer + first, last - first );
     }
     fclose( fp );
 }
@@ -1241,6 +1365,10 @@ void ScriptHandler::loadKidokuData()
             if (ferror(fp))
                 errorAndCont( "couldn't read from kidoku.dat", NULL, "I/O Warning" );
         }
+        else{
+            kidoku_written = new char[ script_buffer_length/8 + 1 ];
+            memcpy( kidoku_written, kidoku_buffer, script_buffer_length/8 + 1 );
+        }
         fclose( fp );
     }
 }
@@ -1945,6 +2073,20 @@ int ScriptHandler::labelScript()
 
     label_info[num_of_labels].start_address = NULL;
 
+    // index the names; on duplicates the first label wins, as before
+    if ( label_hash ) delete[] label_hash;
+    label_hash_size = 16;
+    while ( label_hash_size < num_of_labels*2 ) label_hash_size <<= 1;
+    label_hash = new int[ label_hash_size ];
+    for ( int i=0 ; i<label_hash_size ; i++ ) label_hash[i] = -1;
+    for ( int i=0 ; i<num_of_labels ; i++ ){
+        unsigned int h = hashName( label_info[i].name ) & (label_hash_size-1);
+        while ( label_hash[h] != -1 &&
+                strcmp( label_info[ label_hash[h] ].name, label_info[i].name ) )
+            h = (h+1) & (label_hash_size-1);
+        if ( label_hash[h] == -1 ) label_hash[h] = i;
+    }
+
     return 0;
 }
 
@@ -2021,17 +2163,51 @@ void ScriptHandler::resetLog( LogInfo &info )
     info.root_log.next = NULL;
     info.current_log = &info.root_log;
     info.num_logs = 0;
+    info.num_written = -1;
 }
 
 ScriptHandler::ArrayVariable *ScriptHandler::getRootArrayVariable(){
     return root_array_variable;
 }
 
+unsigned int ScriptHandler::hashName( const char *name )
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    while (*name){
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+ScriptHandler::Alias *ScriptHandler::findAlias( Alias **hash, const char *str )
+{
+    Alias *alias = hash[ hashName(str) & (ALIAS_HASH_SIZE-1) ];
+    while( alias ){
+        if ( !strcmp( alias->alias, str ) ) return alias;
+        alias = alias->hash_next;
+    }
+    return NULL;
+}
+
+void ScriptHandler::addAlias( Alias **hash, Alias *alias )
+{
+    // a redefined alias stays shadowed by the first one, as with the
+    // old list walk
+    if ( findAlias( hash, alias->alias ) ) return;
+
+    Alias **bucket = &hash[ hashName(alias->alias) & (ALIAS_HASH_SIZE-1) ];
+    alias->hash_next = *bucket;
+    *bucket = alias;
+}
+
 void ScriptHandler::addNumAlias( const char *str, int no )
 {
     Alias *p_num_alias = new Alias( str, no );
     last_num_alias->next = p_num_alias;
     last_num_alias = last_num_alias->next;
+    addAlias( num_alias_hash, p_num_alias );
 }
 
 void ScriptHandler::addStrAlias( const char *str1, const char *str2 )
@@ -2039,32 +2215,25 @@ void ScriptHandler::addStrAlias( const char *str1, const char *str2 )
     Alias *p_str_alias = new Alias( str1, str2 );
     last_str_alias->next = p_str_alias;
     last_str_alias = last_str_alias->next;
+    addAlias( str_alias_hash, p_str_alias );
 }
 
 bool ScriptHandler::findNumAlias( const char *str, int *value )
 {
-    Alias *p_num_alias = root_num_alias.next;
-    while( p_num_alias ){
-	if ( !strcmp( p_num_alias->alias, str ) ){
-	    *value = p_num_alias->num;
-	    return true;
-	}
-	p_num_alias = p_num_alias->next;
-    }
-    return false;
+    Alias *p_num_alias = findAlias( num_alias_hash, str );
+    if ( !p_num_alias ) return false;
+
+    *value = p_num_alias->num;
+    return true;
 }
 
 bool ScriptHandler::findStrAlias( const char *str, char* buffer )
 {
-    Alias *p_str_alias = root_str_alias.next;
-    while( p_str_alias ){
-	if ( !strcmp( p_str_alias->alias, str ) ){
-	    strcpy( buffer, p_str_alias->str );
-	    return true;
-	}
-	p_str_alias = p_str_alias->next;
-    }
-    return false;
+    Alias *p_str_alias = findAlias( str_alias_hash, str );
+    if ( !p_str_alias ) return false;
+
+    strcpy( buffer, p_str_alias->str );
+    return true;
 }
 
 void ScriptHandler::processError( const char *str, const char *title, const char *detail, bool is_warning, bool is_simple )
@@ -2278,9 +2447,14 @@ int ScriptHandler::findLabel( const char *label )
         capital_label[i] = label[i];
         if ( 'A' <= capital_label[i] && capital_label[i] <= 'Z' ) capital_label[i] += 'a' - 'A';
     }
-    for ( i=0 ; i<num_of_labels ; i++ ){
-        if ( !strcmp( label_info[i].name, capital_label ) )
-            return i;
+    capital_label[255] = '\0';
+    if ( !label_hash ) return -1;
+
+    unsigned int h = hashName( capital_label ) & (label_hash_size-1);
+    while ( label_hash[h] != -1 ){
+        if ( !strcmp( label_info[ label_hash[h] ].name, capital_label ) )
+            return label_hash[h];
+        h = (h+1) & (label_hash_size-1);
     }
 
     return -1;
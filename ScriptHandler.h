@@ -186,6 +186,12 @@ public:
             end_status |= END_1BYTE_CHAR;
     }
     void skipLine( int no=1 );
+
+    // for image prefetch: reports quoted image names found in the script
+    // from pos onward, stopping after max_lines, at the next label or at
+    // a goto/return; returns where the scan stopped
+    typedef void (*ImageNameFunc)( void *data, const char *cmd, const char *name );
+    char *scanImageNames( char *pos, int max_lines, ImageNameFunc func, void *data );
     void setLinepage( bool val ){ linepage_flag = val; };
     void setZenkakko( bool val ){ zenkakko_flag = val; };
     void setEnglishMode( bool val ){ english_mode = val; };
@@ -255,6 +261,10 @@ public:
         LogLink *current_log;
         int num_logs;
         const char *filename;
+        // entries and bytes already in the file, so writeLog can append
+        // the rest; num_written is -1 when the file must be rewritten
+        int num_written;
+        size_t written_length;
     } log_info[2];
     LogLink *findAndAddLog( LogInfo &info, const char *name, bool add_flag );
     void resetLog( LogInfo &info );
@@ -371,24 +381,25 @@ private:
     
     struct Alias{
         struct Alias *next;
+        struct Alias *hash_next; // next in the same alias_hash bucket
         char *alias;
         int  num;
         char *str;
 
         Alias(){
-            next = NULL;
+            next = hash_next = NULL;
             alias = NULL;
             str = NULL;
         };
         Alias( const char *name, int num ){
-            next = NULL;
+            next = hash_next = NULL;
             alias = new char[ strlen(name) + 1];
             strcpy( alias, name );
             str = NULL;
             this->num = num;
         };
         Alias( const char *name, const char *str ){
-            next = NULL;
+            next = hash_next = NULL;
             alias = new char[ strlen(name) + 1];
             strcpy( alias, name );
             this->str = new char[ strlen(str) + 1];
@@ -401,6 +412,9 @@ private:
     };
     
     int findLabel( const char* label );
+    static unsigned int hashName( const char *name );
+    Alias *findAlias( Alias **hash, const char *str );
+    void addAlias( Alias **hash, Alias *alias );
 
     char *checkComma( char *buf );
     void parseStr( char **buf );
@@ -435,6 +449,9 @@ private:
 
     Alias root_num_alias, *last_num_alias;
     Alias root_str_alias, *last_str_alias;
+    enum { ALIAS_HASH_SIZE = 4096 };
+    Alias *num_alias_hash[ALIAS_HASH_SIZE]; // the lists above, bucketed by name
+    Alias *str_alias_hash[ALIAS_HASH_SIZE];
     
     ArrayVariable *root_array_variable, *current_array_variable;
 
@@ -458,10 +475,13 @@ private:
 
     LabelInfo *label_info;
     int num_of_labels;
+    int *label_hash; // open-addressed indices into label_info, -1 if empty
+    int label_hash_size; // a power of two
 
     bool skip_enabled;
     bool kidokuskip_flag;
     char *kidoku_buffer;
+    char *kidoku_written; // kidoku.dat as last read or written, or NULL
 
     bool zenkakko_flag;
     int  end_status;
@@ -238,6 +238,7 @@ ScriptParser::ScriptParser()
     is_bundled = false;
 #endif
     nsa_offset = 0;
+    file_snapshot_flag = true;
     force_button_shortcut_flag = false;
     
     file_io_buf_ptr = 0;
@@ -493,6 +494,9 @@ void ScriptParser::resetDefineFlags()
 
 int ScriptParser::open()
 {
+    if ( file_snapshot_flag && archive_path.snapshot() && debug_level > 0 )
+        printf( "listed the files under '%s'\n", archive_path.get_all_paths() );
+
     script_h.cBR = new DirectReader( archive_path, key_table );
     script_h.cBR->open();
 
@@ -756,16 +760,26 @@ void ScriptParser::setNsaOffset(const char *off)
         nsa_offset = offset;
 }
 
+void ScriptParser::disableFileSnapshot()
+{
+    file_snapshot_flag = false;
+}
+
+// files written by the game (csv, screenshots) may land under the
+// archive path, so relist it before they get looked up
+void ScriptParser::refreshFileSnapshot()
+{
+    if ( archive_path.has_snapshot() ) archive_path.snapshot();
+}
+
 void ScriptParser::saveGlovalData(bool no_error)
 {
     if ( !globalon_flag ) return;
 
     file_io_buf_ptr = 0;
-    writeVariables( script_h.global_variable_border, VARIABLE_RANGE, false );
-    allocFileIOBuf();
     writeVariables( script_h.global_variable_border, VARIABLE_RANGE, true );
 
-    if (saveFileIOBuf( "gloval.sav" ) && !no_error)
+    if (updateFileIOBuf( "gloval.sav", written_gloval ) && !no_error)
         errorAndExit( "can't open 'gloval.sav' for writing", NULL, "I/O Error", true );
 }
 
@@ -786,24 +800,52 @@ void ScriptParser::allocFileIOBuf()
     file_io_buf_ptr = 0;
 }
 
+// makes room for len more bytes at file_io_buf_ptr, so the write
+// functions can fill the buffer in one pass; save_data_buf keeps the
+// same size, as allocFileIOBuf has it
+void ScriptParser::growFileIOBuf( size_t len )
+{
+    size_t new_len = file_io_buf_len ? file_io_buf_len : 4096;
+    while (new_len < file_io_buf_ptr + len) new_len *= 2;
+
+    unsigned char *buf = new unsigned char[new_len];
+    if (file_io_buf){
+        memcpy(buf, file_io_buf, file_io_buf_len);
+        delete[] file_io_buf;
+    }
+    file_io_buf = buf;
+
+    buf = new unsigned char[new_len];
+    if (save_data_buf){
+        memcpy(buf, save_data_buf, save_data_len);
+        delete[] save_data_buf;
+    }
+    save_data_buf = buf;
+    file_io_buf_len = new_len;
+}
+
+char *ScriptParser::saveFilePath( const char *filename )
+{
+    // all files except envdata go in savedir
+    const char *root = script_h.save_path;
+    if (strcmp( filename, "envdata" ) && script_h.savedir)
+        root = script_h.savedir;
+
+    char *fullname = new char[strlen(root)+strlen(filename)+1];
+    sprintf( fullname, "%s%s", root, filename );
+
+    return fullname;
+}
+
 int ScriptParser::saveFileIOBuf( const char *filename, int offset, const char *savestr )
 {
     FILE *fp;
     int retval = 0;
     size_t ret = 0;
-    bool usesavedir = true;
-    // all files except envdata go in savedir
-    if (!strcmp( filename, "envdata" ))
-        usesavedir = false;
 
     //Mion: create a temporary file, to avoid overwriting valid files
     // (if an error occurs)
-    const char *root = script_h.save_path;
-    if (usesavedir && script_h.savedir)
-        root = script_h.savedir;
-
-    char *fullname = new char[strlen(root)+strlen(filename)+1];
-    sprintf( fullname, "%s%s", root, filename );
+    char *fullname = saveFilePath( filename );
     char *tmp = new char[strlen(fullname) + 9];
     sprintf(tmp, "%s.tmpfile", fullname);
 
@@ -847,6 +889,31 @@ int ScriptParser::saveFileIOBuf( const char *filename, int offset, const char *s
     return retval;
 }
 
+// saveFileIOBuf, unless the file already holds file_io_buf as it is
+int ScriptParser::updateFileIOBuf( const char *filename, WrittenFile &written )
+{
+    char *path = saveFilePath( filename );
+    if (written.path && !strcmp( written.path, path ) &&
+        written.len == file_io_buf_ptr &&
+        !memcmp( written.buf, file_io_buf, file_io_buf_ptr )){
+        delete[] path;
+        return 0;
+    }
+
+    written.reset();
+    int ret = saveFileIOBuf( filename );
+    if (ret == 0){
+        written.path = path;
+        written.len = file_io_buf_ptr;
+        written.buf = new unsigned char[written.len];
+        memcpy( written.buf, file_io_buf, written.len );
+    }
+    else
+        delete[] path;
+
+    return ret;
+}
+
 int ScriptParser::loadFileIOBuf( const char *filename )
 {
     FILE *fp;
@@ -873,8 +940,10 @@ int ScriptParser::loadFileIOBuf( const char *filename )
 
 void ScriptParser::writeChar(char c, bool output_flag)
 {
-    if (output_flag)
+    if (output_flag){
+        if (file_io_buf_ptr >= file_io_buf_len) growFileIOBuf( 1 );
         file_io_buf[file_io_buf_ptr] = (unsigned char)c;
+    }
     file_io_buf_ptr++;
 }
 
@@ -887,6 +956,7 @@ char ScriptParser::readChar()
 void ScriptParser::writeInt(int i, bool output_flag)
 {
     if (output_flag){
+        if (file_io_buf_ptr+4 > file_io_buf_len) growFileIOBuf( 4 );
         file_io_buf[file_io_buf_ptr++] = i & 0xff;
         file_io_buf[file_io_buf_ptr++] = (i >> 8) & 0xff;
         file_io_buf[file_io_buf_ptr++] = (i >> 16) & 0xff;
@@ -914,11 +984,12 @@ int ScriptParser::readInt()
 void ScriptParser::writeStr(char *s, bool output_flag)
 {
     if ( s && s[0] ){
-        if (output_flag)
-            memcpy( file_io_buf + file_io_buf_ptr,
-                    s,
-                    strlen(s) );
-        file_io_buf_ptr += strlen(s);
+        size_t len = strlen(s);
+        if (output_flag){
+            if (file_io_buf_ptr+len > file_io_buf_len) growFileIOBuf( len );
+            memcpy( file_io_buf + file_io_buf_ptr, s, len );
+        }
+        file_io_buf_ptr += len;
     }
     writeChar( 0, output_flag );
 }
@@ -970,6 +1041,7 @@ void ScriptParser::writeArrayVariable( bool output_flag )
         for ( i=0 ; i<dim ; i++ ){
             unsigned long ch = av->data[i];
             if (output_flag){
+                if (file_io_buf_ptr+4 > file_io_buf_len) growFileIOBuf( 4 );
                 file_io_buf[file_io_buf_ptr+3] = (unsigned char)((ch>>24) & 0xff);
                 file_io_buf[file_io_buf_ptr+2] = (unsigned char)((ch>>16) & 0xff);
                 file_io_buf[file_io_buf_ptr+1] = (unsigned char)((ch>>8)  & 0xff);
@@ -1006,28 +1078,32 @@ void ScriptParser::readArrayVariable()
 
 void ScriptParser::writeLog( ScriptHandler::LogInfo &info )
 {
-    file_io_buf_ptr = 0;
-    bool output_flag = false;
-    for (int n=0 ; n<2 ; n++){
-        int  i,j;
-        char buf[10];
-
-        sprintf( buf, "%d", info.num_logs );
-        for ( i=0 ; i<(int)strlen( buf ) ; i++ ) writeChar( buf[i], output_flag );
-        writeChar( 0x0a, output_flag );
-
-        ScriptHandler::LogLink *cur = info.root_log.next;
-        for ( i=0 ; i<info.num_logs ; i++ ){
-            writeChar( '"', output_flag );
-            for ( j=0 ; j<(int)strlen( cur->name ) ; j++ )
-                writeChar( cur->name[j] ^ 0x84, output_flag );
-            writeChar( '"', output_flag );
-            cur = cur->next;
-        }
+    if (info.num_written == info.num_logs) return;
+
+    // logs only grow: while the count keeps its width, the new names can
+    // go on the end of the file with the count rewritten in place;
+    // otherwise, or if that fails, saveFileIOBuf replaces the whole file
+    char buf[16];
+    sprintf( buf, "%d", info.num_logs );
+    if (info.num_written > 0){
+        char old_buf[16];
+        sprintf( old_buf, "%d", info.num_written );
+        if (strlen( old_buf ) == strlen( buf ) && appendLog( info, buf ) == 0)
+            return;
+    }
 
-        if (n==1) break;
-        allocFileIOBuf();
-        output_flag = true;
+    int i, j;
+    file_io_buf_ptr = 0;
+    for ( i=0 ; i<(int)strlen( buf ) ; i++ ) writeChar( buf[i], true );
+    writeChar( 0x0a, true );
+
+    ScriptHandler::LogLink *cur = info.root_log.next;
+    for ( i=0 ; i<info.num_logs ; i++ ){
+        writeChar( '"', true );
+        for ( j=0 ; j<(int)strlen( cur->name ) ; j++ )
+            writeChar( cur->name[j] ^ 0x84, true );
+        writeChar( '"', true );
+        cur = cur->next;
     }
 
     if (saveFileIOBuf( info.filename )){
@@ -1035,6 +1111,47 @@ void ScriptParser::writeLog( ScriptHandler::LogInfo &info )
                  "can't write to '%s'", info.filename);
         errorAndExit( script_h.errbuf, NULL, "I/O Error" );
     }
+    info.num_written = info.num_logs;
+    info.written_length = file_io_buf_ptr;
+}
+
+int ScriptParser::appendLog( ScriptHandler::LogInfo &info, const char *count )
+{
+    int i, j;
+    ScriptHandler::LogLink *cur = info.root_log.next;
+    for ( i=0 ; i<info.num_written ; i++ ) cur = cur->next;
+
+    file_io_buf_ptr = 0;
+    for ( ; i<info.num_logs ; i++ ){
+        writeChar( '"', true );
+        for ( j=0 ; j<(int)strlen( cur->name ) ; j++ )
+            writeChar( cur->name[j] ^ 0x84, true );
+        writeChar( '"', true );
+        cur = cur->next;
+    }
+
+    char *fullname = saveFilePath( info.filename );
+    FILE *fp = ::fopen( fullname, "r+b" );
+    delete[] fullname;
+    if (fp == NULL) return -1;
+
+    // the new names go first and the count last, so until the count is
+    // in, the file reads as it was; a file that isn't the length last
+    // written, or any failure, leaves it to writeLog to rewrite it whole
+    size_t count_len = strlen( count );
+    bool ok = ( fseek( fp, 0, SEEK_END ) == 0 &&
+                ftell( fp ) == (long)info.written_length &&
+                fwrite( file_io_buf, 1, file_io_buf_ptr, fp ) == file_io_buf_ptr &&
+                fflush( fp ) == 0 &&
+                fseek( fp, 0, SEEK_SET ) == 0 &&
+                fwrite( count, 1, count_len, fp ) == count_len );
+    if (fclose( fp ) != 0) ok = false;
+    if (!ok) return -1;
+
+    info.num_written = info.num_logs;
+    info.written_length += file_io_buf_ptr;
+
+    return 0;
 }
 
 void ScriptParser::readLog( ScriptHandler::LogInfo &info )
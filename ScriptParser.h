@@ -54,6 +54,7 @@
 #include "AnimationInfo.h"
 #include "FontInfo.h"
 #include "Layer.h"
+#include "StreamRing.h"
 #ifdef USE_LUA
 #include "LUAHandler.h"
 #endif
@@ -89,6 +90,7 @@ struct OVInfo{
     int mult1;
     int mult2;
     unsigned char *buf;
+    SDL_RWops *rw; // read through instead of buf when set, then closed
     long decoded_length;
 #if defined(USE_OGG_VORBIS)
     ogg_int64_t length;
@@ -114,8 +116,11 @@ public:
         int volume;
         bool is_mute;
         Mix_Chunk **voice_sample; //Mion: for bgmdownmode
+        StreamRing *ring; // decoded ahead, NULL if oggcallback decodes
+        bool swap_bytes; // ring holds little-endian samples on big-endian
         MusicStruct()
-        : ovi(NULL), volume(0), is_mute(false), voice_sample(NULL) {}
+        : ovi(NULL), volume(0), is_mute(false), voice_sample(NULL),
+          ring(NULL), swap_bytes(false) {}
     };
     csvinfo CSVInfo;
 
@@ -135,6 +140,8 @@ public:
     void setArchivePath(const char *path);
     void setSavePath(const char *path);
     void setNsaOffset(const char *off);
+    void disableFileSnapshot();
+    void refreshFileSnapshot();
 
 #ifdef MACOSX
     void checkBundled();
@@ -345,6 +352,7 @@ protected:
     DirPaths archive_path;
     DirPaths nsa_path;
     int nsa_offset;
+    bool file_snapshot_flag;
     bool globalon_flag;
     bool labellog_flag;
     bool filelog_flag;
@@ -486,6 +494,25 @@ protected:
     size_t file_io_buf_ptr;
     size_t file_io_buf_len;
     size_t save_data_len;
+
+    /* a file as updateFileIOBuf last wrote it, so it can be left alone
+     * while its contents stay the same */
+    struct WrittenFile{
+        char *path;
+        unsigned char *buf;
+        size_t len;
+        WrittenFile(){ path = NULL; buf = NULL; len = 0; }
+        ~WrittenFile(){ reset(); }
+        void reset(){
+            if (path) delete[] path;
+            if (buf) delete[] buf;
+            path = NULL;
+            buf = NULL;
+            len = 0;
+        }
+    };
+    WrittenFile written_envdata, written_gloval;
+    int updateFileIOBuf( const char *filename, WrittenFile &written );
     
     bool errorsave;
     
@@ -617,6 +644,8 @@ protected:
     void readColor( uchar3 *color, const char *buf );
     
     void allocFileIOBuf();
+    void growFileIOBuf( size_t len );
+    char *saveFilePath( const char *filename );
     int saveFileIOBuf( const char *filename, int offset=0, const char *savestr=NULL );
     int loadFileIOBuf( const char *filename );
 
@@ -631,6 +660,7 @@ protected:
     void writeArrayVariable( bool output_flag );
     void readArrayVariable();
     void writeLog( ScriptHandler::LogInfo &info );
+    int appendLog( ScriptHandler::LogInfo &info, const char *count );
     void readLog( ScriptHandler::LogInfo &info );
 
     /* ---------------------------------------- */
@@ -1628,14 +1628,14 @@ int ScriptParser::csvopenCommand() {
     }
 
     if (CSVInfo.mode == csvinfo::R) {
-        unsigned long len = script_h.cBR->getFileLength(filename);
-        if (len == 0){
+        BaseReader::FileRef ref;
+        if (!script_h.cBR->openFile(filename, ref)){
             errorAndExit("csvopen: could not open file for reading");
         }
+        unsigned long len = ref.length;
 
         CSVInfo.contents = new unsigned char[len+1];
-        int loc;
-        script_h.cBR->getFile(filename, CSVInfo.contents, &loc);
+        script_h.cBR->readFile(ref, CSVInfo.contents);
         CSVInfo.contents[len] = '\0';
         CSVInfo.contents_ptr = CSVInfo.contents;
     }
@@ -1717,6 +1717,7 @@ int ScriptParser::csvcloseCommand() {
     if (CSVInfo.fp != NULL) {
         std::fclose(CSVInfo.fp);
         CSVInfo.fp = NULL;
+        refreshFileSnapshot();
     }
     CSVInfo.mode = csvinfo::NONE;
     if (CSVInfo.contents != NULL) {
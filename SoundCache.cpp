@@ -0,0 +1,195 @@
+/* -*- C++ -*-
+ *
+ *  SoundCache.cpp - Decoded sound effects and voices kept for reuse
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "SoundCache.h"
+#include <string.h>
+
+SoundCache::SoundCache()
+{
+    for (int i=0 ; i<NUM_BUCKETS ; i++) bucket[i] = NULL;
+    lru_head = lru_tail = NULL;
+    orphans = NULL;
+    num_of_entries = 0;
+    budget = usage = 0;
+    hits = misses = 0;
+}
+
+SoundCache::~SoundCache()
+{
+    clear();
+    // nothing can give these back any more
+    while (orphans){
+        Entry *entry = orphans;
+        orphans = entry->next;
+        freeEntry( entry );
+    }
+}
+
+void SoundCache::setBudget( size_t bytes )
+{
+    budget = bytes;
+    while (lru_tail && usage > budget)
+        evict( lru_tail );
+}
+
+unsigned int SoundCache::hashKey( const char *key )
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    while (*key){
+        hash ^= (unsigned char)*key++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+SoundCache::Entry *SoundCache::find( const char *key, unsigned int hash )
+{
+    Entry *entry = bucket[hash % NUM_BUCKETS];
+    while (entry){
+        if (entry->hash == hash && !strcmp(entry->key, key))
+            return entry;
+        entry = entry->bucket_next;
+    }
+    return NULL;
+}
+
+void SoundCache::unlink( Entry *entry )
+{
+    if (entry->prev) entry->prev->next = entry->next;
+    else             lru_head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else             lru_tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+void SoundCache::pushFront( Entry *entry )
+{
+    entry->prev = NULL;
+    entry->next = lru_head;
+    if (lru_head) lru_head->prev = entry;
+    else          lru_tail = entry;
+    lru_head = entry;
+}
+
+void SoundCache::evict( Entry *entry )
+{
+    Entry **link = &bucket[entry->hash % NUM_BUCKETS];
+    while (*link != entry) link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+
+    unlink( entry );
+    usage -= entry->size;
+    num_of_entries--;
+
+    // a channel may still be playing it; free it on the last release
+    if (entry->refs > 0){
+        entry->next = orphans;
+        orphans = entry;
+        return;
+    }
+    freeEntry( entry );
+}
+
+void SoundCache::freeEntry( Entry *entry )
+{
+    Mix_FreeChunk( entry->chunk );
+    delete[] entry->key;
+    delete entry;
+}
+
+Mix_Chunk *SoundCache::get( const char *key, int *type )
+{
+    if (budget == 0) return NULL;
+
+    Entry *entry = find( key, hashKey(key) );
+    if (entry == NULL){
+        misses++;
+        return NULL;
+    }
+    hits++;
+
+    if (entry != lru_head){
+        unlink( entry );
+        pushFront( entry );
+    }
+
+    *type = entry->type;
+    entry->refs++;
+
+    return entry->chunk;
+}
+
+void SoundCache::add( const char *key, Mix_Chunk *chunk, int type )
+{
+    if (chunk == NULL) return;
+
+    size_t size = chunk->alen;
+    if (size > budget) return;
+
+    unsigned int hash = hashKey( key );
+    Entry *entry = find( key, hash );
+    if (entry) evict( entry );
+
+    while (lru_tail && usage + size > budget)
+        evict( lru_tail );
+
+    entry = new Entry;
+    entry->key = new char[ strlen(key) + 1 ];
+    strcpy( entry->key, key );
+    entry->hash = hash;
+    entry->chunk = chunk;
+    entry->size = size;
+    entry->type = type;
+    entry->refs = 1;
+
+    entry->bucket_next = bucket[hash % NUM_BUCKETS];
+    bucket[hash % NUM_BUCKETS] = entry;
+    pushFront( entry );
+    usage += size;
+    num_of_entries++;
+}
+
+bool SoundCache::release( Mix_Chunk *chunk )
+{
+    if (chunk == NULL) return false;
+
+    for (Entry *entry = lru_head ; entry ; entry = entry->next)
+        if (entry->chunk == chunk){
+            if (entry->refs > 0) entry->refs--;
+            return true;
+        }
+
+    for (Entry **link = &orphans ; *link ; link = &(*link)->next)
+        if ((*link)->chunk == chunk){
+            Entry *entry = *link;
+            if (--entry->refs > 0) return true;
+            *link = entry->next;
+            freeEntry( entry );
+            return true;
+        }
+
+    return false;
+}
+
+void SoundCache::clear()
+{
+    while (lru_tail) evict( lru_tail );
+}
@@ -0,0 +1,88 @@
+/* -*- C++ -*-
+ *
+ *  SoundCache.h - Decoded sound effects and voices kept for reuse
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __SOUND_CACHE_H__
+#define __SOUND_CACHE_H__
+
+#include <SDL_mixer.h>
+#include <stddef.h>
+
+// Holds decoded Mix_Chunks keyed by a string naming the file and the audio
+// format it was converted to.  Mix_Chunk has no refcount of its own, so the
+// cache counts the holders of each chunk itself: evicting an entry frees
+// the chunk only once nothing holds it, and holders give chunks back with
+// release() instead of Mix_FreeChunk.
+class SoundCache
+{
+public:
+    SoundCache();
+    ~SoundCache();
+
+    void setBudget( size_t bytes );
+    size_t getBudget() const { return budget; }
+
+    // returns a new reference to the cached chunk (or NULL on a miss);
+    // type is restored from the entry
+    Mix_Chunk *get( const char *key, int *type );
+    // starts tracking chunk; the caller's reference becomes a counted one
+    void add( const char *key, Mix_Chunk *chunk, int type );
+    // drops a reference; false if the chunk isn't tracked, in which case
+    // the caller still owns it
+    bool release( Mix_Chunk *chunk );
+    void clear();
+
+    unsigned int getHits() const { return hits; }
+    unsigned int getMisses() const { return misses; }
+    size_t getUsage() const { return usage; }
+    int getNumEntries() const { return num_of_entries; }
+
+private:
+    SoundCache( const SoundCache & );
+    SoundCache& operator =( const SoundCache & );
+
+    enum { NUM_BUCKETS = 64 };
+
+    struct Entry{
+        char *key;
+        unsigned int hash;
+        Mix_Chunk *chunk;
+        size_t size;
+        int type;
+        int refs;
+        Entry *prev, *next;   // LRU order, most recent first
+        Entry *bucket_next;
+    };
+
+    Entry *bucket[NUM_BUCKETS];
+    Entry *lru_head, *lru_tail;
+    Entry *orphans; // evicted but still held, chained through next
+    int num_of_entries;
+    size_t budget, usage;
+    unsigned int hits, misses;
+
+    static unsigned int hashKey( const char *key );
+    Entry *find( const char *key, unsigned int hash );
+    void unlink( Entry *entry );
+    void pushFront( Entry *entry );
+    void evict( Entry *entry );
+    static void freeEntry( Entry *entry );
+};
+
+#endif // __SOUND_CACHE_H__
@@ -0,0 +1,79 @@
+/* -*- C++ -*-
+ *
+ *  SpriteIndex.cpp - Ordered list of the sprite slots that may need drawing
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "SpriteIndex.h"
+#include <stddef.h>
+
+SpriteIndex::SpriteIndex()
+{
+    list = NULL;
+    listed = NULL;
+    num = size = 0;
+}
+
+SpriteIndex::~SpriteIndex()
+{
+    if (list) delete[] list;
+    if (listed) delete[] listed;
+}
+
+void SpriteIndex::setSize( int size )
+{
+    if (list) delete[] list;
+    if (listed) delete[] listed;
+
+    this->size = size;
+    list = new int[size];
+    listed = new bool[size];
+    for (int i=0 ; i<size ; i++) listed[i] = false;
+    num = 0;
+}
+
+void SpriteIndex::add( int no )
+{
+    if (no < 0 || no >= size || listed[no]) return;
+
+    // sprites mostly get loaded in rising order, so search from the top
+    int i = num;
+    while (i > 0 && list[i-1] > no){
+        list[i] = list[i-1];
+        i--;
+    }
+    list[i] = no;
+    num++;
+    listed[no] = true;
+}
+
+void SpriteIndex::remove( int no )
+{
+    if (!has(no)) return;
+
+    int i = 0;
+    while (list[i] != no) i++;
+    for ( ; i<num-1 ; i++) list[i] = list[i+1];
+    num--;
+    listed[no] = false;
+}
+
+void SpriteIndex::clear()
+{
+    for (int i=0 ; i<num ; i++) listed[ list[i] ] = false;
+    num = 0;
+}
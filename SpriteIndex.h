@@ -0,0 +1,50 @@
+/* -*- C++ -*-
+ *
+ *  SpriteIndex.h - Ordered list of the sprite slots that may need drawing
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __SPRITE_INDEX_H__
+#define __SPRITE_INDEX_H__
+
+// Sprite numbers kept in ascending (z) order, so a refresh only visits the
+// slots that have been given an image instead of all of them.  The list is
+// allowed to hold slots that have since been emptied; the owner drops those
+// with remove() when it comes across them.
+struct SpriteIndex
+{
+    SpriteIndex();
+    ~SpriteIndex();
+
+    void setSize( int size );
+    void add( int no );
+    void remove( int no );
+    void clear();
+    bool has( int no ) const { return (no >= 0) && (no < size) && listed[no]; }
+
+    int *list; // num entries, ascending
+    int num;
+
+private:
+    SpriteIndex( const SpriteIndex & );
+    SpriteIndex& operator =( const SpriteIndex & );
+
+    bool *listed;
+    int size;
+};
+
+#endif // __SPRITE_INDEX_H__
@@ -0,0 +1,218 @@
+/* -*- C++ -*-
+ *
+ *  StreamRing.cpp - Decoded audio passed from a decoder thread to the mixer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "StreamRing.h"
+#include <string.h>
+
+#if defined(USE_X86_GFX) && defined(__SSE2__)
+#include <emmintrin.h>
+#define STREAM_RING_SSE2
+#endif
+
+StreamRing::StreamRing()
+{
+    data = NULL;
+    size = 0;
+    mutex = NULL;
+    space_cond = NULL;
+    read_pos = write_pos = fill = 0;
+    finished = cancelled = false;
+    underruns = 0;
+}
+
+StreamRing::~StreamRing()
+{
+    close();
+}
+
+bool StreamRing::open( int size )
+{
+    close();
+    size &= ~1;
+    if (size <= 0) return false;
+
+    mutex = SDL_CreateMutex();
+    space_cond = SDL_CreateCond();
+    if (mutex == NULL || space_cond == NULL){
+        close();
+        return false;
+    }
+    data = new unsigned char[size];
+    this->size = size;
+    read_pos = write_pos = fill = 0;
+    finished = cancelled = false;
+
+    return true;
+}
+
+void StreamRing::close()
+{
+    if (space_cond) SDL_DestroyCond( space_cond );
+    if (mutex) SDL_DestroyMutex( mutex );
+    space_cond = NULL;
+    mutex = NULL;
+    if (data) delete[] data;
+    data = NULL;
+    size = 0;
+    read_pos = write_pos = fill = 0;
+}
+
+bool StreamRing::waitForSpace( int len )
+{
+    if (len > size) len = size;
+
+    SDL_LockMutex( mutex );
+    while (!cancelled && size - fill < len)
+        SDL_CondWait( space_cond, mutex );
+    bool ret = !cancelled;
+    SDL_UnlockMutex( mutex );
+
+    return ret;
+}
+
+int StreamRing::write( const void *src, int len )
+{
+    SDL_LockMutex( mutex );
+    int space = size - fill;
+    int pos = write_pos;
+    SDL_UnlockMutex( mutex );
+
+    if (len > space) len = space;
+    len &= ~1;
+
+    const unsigned char *s = (const unsigned char*)src;
+    for (int done=0 ; done<len ; ){
+        int n = size - pos;
+        if (n > len - done) n = len - done;
+        memcpy( data + pos, s + done, n );
+        done += n;
+        pos = 0;
+    }
+
+    SDL_LockMutex( mutex );
+    write_pos = (write_pos + len) % size;
+    fill += len;
+    SDL_UnlockMutex( mutex );
+
+    return len;
+}
+
+void StreamRing::setFinished()
+{
+    SDL_LockMutex( mutex );
+    finished = true;
+    SDL_UnlockMutex( mutex );
+}
+
+void StreamRing::cancel()
+{
+    SDL_LockMutex( mutex );
+    cancelled = true;
+    SDL_CondSignal( space_cond );
+    SDL_UnlockMutex( mutex );
+}
+
+int StreamRing::read( void *dst, int len, int volume, bool swap_bytes )
+{
+    SDL_LockMutex( mutex );
+    int avail = fill;
+    int pos = read_pos;
+    bool done_writing = finished;
+    SDL_UnlockMutex( mutex );
+
+    if (len > avail){
+        if (!done_writing) underruns++;
+        len = avail;
+    }
+    len &= ~1;
+
+    unsigned char *d = (unsigned char*)dst;
+    for (int done=0 ; done<len ; ){
+        int n = size - pos;
+        if (n > len - done) n = len - done;
+        if (swap_bytes){
+            // samples stay little-endian, as ov_read gave them
+            Uint16 *p = (Uint16*)(d + done);
+            memcpy( p, data + pos, n );
+            for (int i=0 ; i<n/2 ; i++){
+                Sint16 a = (Sint16)SDL_Swap16( p[i] );
+                a = a*volume/100;
+                p[i] = SDL_Swap16( (Uint16)a );
+            }
+        }
+        else
+            scaleSamples( (Sint16*)(d + done), (const Sint16*)(data + pos), n/2, volume );
+        done += n;
+        pos = 0;
+    }
+
+    SDL_LockMutex( mutex );
+    read_pos = (read_pos + len) % size;
+    fill -= len;
+    SDL_CondSignal( space_cond );
+    SDL_UnlockMutex( mutex );
+
+    return len;
+}
+
+bool StreamRing::isDrained()
+{
+    SDL_LockMutex( mutex );
+    bool ret = finished && fill == 0;
+    SDL_UnlockMutex( mutex );
+
+    return ret;
+}
+
+// dst = src*volume/100; the SIMD versions multiply by volume/100 in
+// 16-bit fixed point, so they may come out one lower than the division
+void StreamRing::scaleSamples( Sint16 *dst, const Sint16 *src, int count, int volume )
+{
+    if (volume >= 100){
+        memcpy( dst, src, count*2 );
+        return;
+    }
+    if (volume <= 0){
+        memset( dst, 0, count*2 );
+        return;
+    }
+
+    int i = 0;
+#if defined(STREAM_RING_SSE2)
+    // (a*f)>>16 for f >= 32768 is mulhi with f-65536, plus a
+    int f = (volume << 16) / 100;
+    __m128i factor = _mm_set1_epi16( (short)f );
+    if (f >= 32768){
+        for ( ; i+8<=count ; i+=8){
+            __m128i a = _mm_loadu_si128( (const __m128i*)(src+i) );
+            a = _mm_add_epi16( _mm_mulhi_epi16( a, factor ), a );
+            _mm_storeu_si128( (__m128i*)(dst+i), a );
+        }
+    }
+    else{
+        for ( ; i+8<=count ; i+=8){
+            __m128i a = _mm_loadu_si128( (const __m128i*)(src+i) );
+            _mm_storeu_si128( (__m128i*)(dst+i), _mm_mulhi_epi16( a, factor ) );
+        }
+    }
+#endif
+    for ( ; i<count ; i++)
+        dst[i] = src[i]*volume/100;
+}
@@ -0,0 +1,70 @@
+/* -*- C++ -*-
+ *
+ *  StreamRing.h - Decoded audio passed from a decoder thread to the mixer
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __STREAM_RING_H__
+#define __STREAM_RING_H__
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+// One thread write()s 16-bit samples, the audio callback read()s them.
+// The mutex only covers the two positions, never a copy, so read() does
+// not wait on the decoder; the writer sleeps in waitForSpace() until
+// read() has made room or cancel() is called.
+class StreamRing
+{
+public:
+    StreamRing();
+    ~StreamRing();
+
+    bool open( int size ); // size in bytes, rounded down to whole samples
+    void close();
+    int getSize() const { return size; }
+
+    // writer side
+    bool waitForSpace( int len ); // false once cancel() has been called
+    int write( const void *src, int len );
+    void setFinished();
+    void cancel();
+
+    // reader side: copies up to len bytes, scaled by volume/100
+    int read( void *dst, int len, int volume, bool swap_bytes=false );
+    bool isDrained(); // setFinished() was called and everything was read
+    unsigned int getUnderruns() const { return underruns; }
+
+    static void scaleSamples( Sint16 *dst, const Sint16 *src, int count, int volume );
+
+private:
+    StreamRing( const StreamRing & );
+    StreamRing& operator =( const StreamRing & );
+
+    unsigned char *data;
+    int size;
+    SDL_mutex *mutex;
+    SDL_cond *space_cond;
+
+    // guarded by mutex; the bytes between read_pos and write_pos are
+    // only touched by the reader, the rest only by the writer
+    int read_pos, write_pos, fill;
+    bool finished, cancelled;
+    unsigned int underruns;
+};
+
+#endif // __STREAM_RING_H__
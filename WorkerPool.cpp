@@ -0,0 +1,141 @@
+/* -*- C++ -*-
+ *
+ *  WorkerPool.cpp - A few SDL threads that share out numbered jobs
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "WorkerPool.h"
+#include <stddef.h>
+
+WorkerPool::WorkerPool()
+{
+    threads = NULL;
+    num_threads = 0;
+    mutex = NULL;
+    work_cond = done_cond = NULL;
+    func = NULL;
+    data = NULL;
+    num_jobs = next_job = jobs_left = 0;
+    quit = false;
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+int WorkerPool::start( int num_threads )
+{
+    stop();
+    if (num_threads <= 0) return 0;
+
+    mutex = SDL_CreateMutex();
+    work_cond = SDL_CreateCond();
+    done_cond = SDL_CreateCond();
+    if (mutex == NULL || work_cond == NULL || done_cond == NULL){
+        stop();
+        return 0;
+    }
+
+    quit = false;
+    threads = new SDL_Thread*[num_threads];
+    for (int i=0 ; i<num_threads ; i++){
+        threads[this->num_threads] = SDL_CreateThread( threadFunc, this );
+        if (threads[this->num_threads]) this->num_threads++;
+    }
+    if (this->num_threads == 0) stop();
+
+    return this->num_threads;
+}
+
+void WorkerPool::stop()
+{
+    if (num_threads > 0){
+        SDL_LockMutex( mutex );
+        quit = true;
+        SDL_CondBroadcast( work_cond );
+        SDL_UnlockMutex( mutex );
+        for (int i=0 ; i<num_threads ; i++)
+            SDL_WaitThread( threads[i], NULL );
+        num_threads = 0;
+    }
+    if (threads) delete[] threads;
+    threads = NULL;
+
+    if (done_cond) SDL_DestroyCond( done_cond );
+    if (work_cond) SDL_DestroyCond( work_cond );
+    if (mutex) SDL_DestroyMutex( mutex );
+    done_cond = work_cond = NULL;
+    mutex = NULL;
+}
+
+void WorkerPool::run( JobFunc func, void *data, int num_jobs )
+{
+    if (num_threads == 0 || num_jobs <= 1){
+        for (int i=0 ; i<num_jobs ; i++) func( data, i );
+        return;
+    }
+
+    SDL_LockMutex( mutex );
+    this->func = func;
+    this->data = data;
+    this->num_jobs = num_jobs;
+    next_job = 0;
+    jobs_left = num_jobs;
+    SDL_CondBroadcast( work_cond );
+
+    // the caller takes jobs too rather than sit idle
+    while (next_job < this->num_jobs){
+        int job = next_job++;
+        SDL_UnlockMutex( mutex );
+        func( data, job );
+        SDL_LockMutex( mutex );
+        jobs_left--;
+    }
+    while (jobs_left > 0)
+        SDL_CondWait( done_cond, mutex );
+
+    this->num_jobs = next_job = 0;
+    SDL_UnlockMutex( mutex );
+}
+
+int WorkerPool::threadFunc( void *data )
+{
+    ((WorkerPool*)data)->threadLoop();
+    return 0;
+}
+
+void WorkerPool::threadLoop()
+{
+    SDL_LockMutex( mutex );
+    while (1){
+        while (!quit && next_job >= num_jobs)
+            SDL_CondWait( work_cond, mutex );
+        if (quit) break;
+
+        int job = next_job++;
+        JobFunc job_func = func;
+        void *job_data = data;
+        SDL_UnlockMutex( mutex );
+        job_func( job_data, job );
+        SDL_LockMutex( mutex );
+
+        if (--jobs_left == 0)
+            SDL_CondSignal( done_cond );
+    }
+    SDL_UnlockMutex( mutex );
+}
@@ -0,0 +1,63 @@
+/* -*- C++ -*-
+ *
+ *  WorkerPool.h - A few SDL threads that share out numbered jobs
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __WORKER_POOL_H__
+#define __WORKER_POOL_H__
+
+#include <SDL.h>
+#include <SDL_thread.h>
+
+// run() hands jobs 0..num_jobs-1 to the workers and to the calling thread,
+// and returns once every job has finished.  Only one thread may call run()
+// at a time.  With no workers started, run() just does the jobs in order.
+class WorkerPool
+{
+public:
+    typedef void (*JobFunc)( void *data, int job );
+
+    WorkerPool();
+    ~WorkerPool();
+
+    int start( int num_threads ); // returns the number of workers running
+    void stop();
+    int getNumThreads() const { return num_threads; }
+
+    void run( JobFunc func, void *data, int num_jobs );
+
+private:
+    WorkerPool( const WorkerPool & );
+    WorkerPool& operator =( const WorkerPool & );
+
+    static int threadFunc( void *data );
+    void threadLoop();
+
+    SDL_Thread **threads;
+    int num_threads;
+    SDL_mutex *mutex;
+    SDL_cond *work_cond, *done_cond;
+
+    // guarded by mutex
+    JobFunc func;
+    void *data;
+    int num_jobs, next_job, jobs_left;
+    bool quit;
+};
+
+#endif // __WORKER_POOL_H__
@@ -0,0 +1,299 @@
+/* -*- C++ -*-
+ * 
+ *  graphics_avx2.cpp - graphics routines using X86 AVX2 cpu functionality
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Same arithmetic as the SSE2 routines, eight pixels at a time.  Each one
+// peels off the same leading pixels as its SSE2 counterpart and hands the
+// remainder back to it, so both produce identical output for any row.
+
+#ifdef USE_X86_AVX2_GFX
+
+#include <stdint.h>
+
+#include <immintrin.h>
+
+#include "graphics_sum.h"
+#include "graphics_blend.h"
+#include "graphics_sse2.h"
+
+namespace ons_gfx {
+
+int imageFilterMean_AVX2(unsigned char *src1, unsigned char *src2, unsigned char *dst, int length)
+{
+    int n = length;
+
+    // Compute first few values so we're on a 16-byte boundary in dst
+    while( (((uintptr_t)dst & 0xF) > 0) && (n > 0) ) {
+        MEAN_PIXEL();
+        --n; ++dst; ++src1; ++src2;
+    }
+
+    // Do bulk of processing using AVX2 (find the mean of 32 8-bit unsigned integers, with saturation)
+    __m256i mask = _mm256_set1_epi8(0x7F);
+    while(n >= 32) {
+        __m256i s1 = _mm256_loadu_si256((__m256i*)src1);
+        s1 = _mm256_srli_epi16(s1, 1); // shift right 1
+        s1 = _mm256_and_si256(s1, mask); // apply byte-mask
+        __m256i s2 = _mm256_loadu_si256((__m256i*)src2);
+        s2 = _mm256_srli_epi16(s2, 1); // shift right 1
+        s2 = _mm256_and_si256(s2, mask); // apply byte-mask
+        __m256i r = _mm256_adds_epu8(s1, s2);
+        _mm256_storeu_si256((__m256i*)dst, r);
+
+        n -= 32; src1 += 32; src2 += 32; dst += 32;
+    }
+
+    return length - n + imageFilterMean_SSE2(src1, src2, dst, n);
+}
+
+
+int imageFilterAddTo_AVX2(unsigned char *dst, unsigned char *src, int length)
+{
+    int n = length;
+
+    // Compute first few values so we're on a 16-byte boundary in dst
+    while( (((uintptr_t)dst & 0xF) > 0) && (n > 0) ) {
+        ADDTO_PIXEL();
+        --n; ++dst; ++src;
+    }
+
+    // Do bulk of processing using AVX2 (add 32 8-bit unsigned integers, with saturation)
+    while(n >= 32) {
+        __m256i s = _mm256_loadu_si256((__m256i*)src);
+        __m256i d = _mm256_loadu_si256((__m256i*)dst);
+        __m256i r = _mm256_adds_epu8(s, d);
+        _mm256_storeu_si256((__m256i*)dst, r);
+
+        n -= 32; src += 32; dst += 32;
+    }
+
+    return length - n + imageFilterAddTo_SSE2(dst, src, n);
+}
+
+
+int imageFilterSubFrom_AVX2(unsigned char *dst, unsigned char *src, int length)
+{
+    int n = length;
+
+    // Compute first few values so we're on a 16-byte boundary in dst
+    while( (((uintptr_t)dst & 0xF) > 0) && (n > 0) ) {
+        SUBFROM_PIXEL();
+        --n; ++dst; ++src;
+    }
+
+    // Do bulk of processing using AVX2 (sub 32 8-bit unsigned integers, with saturation)
+    while(n >= 32) {
+        __m256i s = _mm256_loadu_si256((__m256i*)src);
+        __m256i d = _mm256_loadu_si256((__m256i*)dst);
+        __m256i r = _mm256_subs_epu8(d, s);
+        _mm256_storeu_si256((__m256i*)dst, r);
+
+        n -= 32; src += 32; dst += 32;
+    }
+
+    imageFilterSubFrom_SSE2(dst, src, n);
+
+    return length;
+}
+
+static inline __m256i alphaBlendCore_AVX2(__m256i src1, __m256i src2, __m256i d_a)
+{
+    // basic bitmasks 0x00FF00FF, 0x000000FF
+    const __m256i rbmask = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i bmask = _mm256_set1_epi32(0x000000FF);
+
+    // rb = (src2_argb & rbmask) * alpha1
+    __m256i rb = _mm256_and_si256(src2, rbmask);
+    rb = _mm256_mullo_epi16(d_a, rb);
+    // g = ((src2_argb >> 8) & bmask) * alpha1
+    src2 = _mm256_srli_epi32(src2, 8);
+    __m256i g = _mm256_and_si256(src2, bmask);
+    g = _mm256_mullo_epi16(d_a, g);
+    // alpha2 = alpha1 ^ rbmask
+    d_a = _mm256_xor_si256(d_a, rbmask);
+    // rb += (src1_argb & rbmask) * alpha2
+    __m256i tmp = _mm256_and_si256(src1, rbmask);
+    tmp = _mm256_mullo_epi16(d_a, tmp);
+    rb = _mm256_add_epi32(rb, tmp);
+    // rb = (rb >> 8) & rbmask
+    rb = _mm256_srli_epi32(rb, 8);
+    rb = _mm256_and_si256(rb, rbmask);
+    // g += ((src1_argb >> 8) & bmask) * alpha2
+    src1 = _mm256_srli_epi32(src1, 8);
+    tmp = _mm256_and_si256(src1, bmask);
+    tmp = _mm256_mullo_epi16(d_a, tmp);
+    g = _mm256_add_epi32(g, tmp);
+    // g = g & (bmask << 8)
+    tmp = _mm256_slli_epi32(bmask, 8);
+    g = _mm256_and_si256(g, tmp);
+    // dst_argb = rb | g
+    return _mm256_or_si256(rb, g);
+}
+
+int imageFilterBlend_AVX2(Uint32 *dst_buffer, Uint32 *src_buffer, Uint8 *alphap, int alpha, int length)
+{
+    int n = length;
+
+    // Compute first few values so we're on a 16-byte boundary in dst_buffer
+    while( (((uintptr_t)dst_buffer & 0xF) > 0) && (n > 0) ) {
+        BLEND_PIXEL();
+        --n; ++dst_buffer; ++src_buffer;
+    }
+
+    // Do bulk of processing using AVX2 (process 8 32bit (BGRA) pixels)
+    __m256i alpha0 = _mm256_set1_epi32(alpha);
+    while(n >= 8) {
+        // alpha1 = ((src_argb >> 24) * alpha) >> 8
+        __m256i buf = _mm256_loadu_si256((__m256i*)src_buffer);
+        __m256i tmp = _mm256_srli_epi32(buf, 24);
+        __m256i a = _mm256_mullo_epi16(alpha0, tmp);
+        a = _mm256_srli_epi32(a, 8);
+        // double-up alpha1 (0x000000vv -> 0x00vv00vv)
+        tmp = _mm256_slli_epi32(a, 16);
+        a = _mm256_or_si256(a, tmp);
+
+        tmp = _mm256_loadu_si256((__m256i*)dst_buffer);
+        __m256i dst = alphaBlendCore_AVX2(tmp, buf, a);
+        _mm256_storeu_si256((__m256i*)dst_buffer, dst);
+
+        n -= 8; src_buffer += 8; dst_buffer += 8; alphap += 32;
+    }
+
+    return length - n + imageFilterBlend_SSE2(dst_buffer, src_buffer, alphap, alpha, n);
+}
+
+int imageFilterEffectBlend_AVX2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 mask2, int length)
+{
+    int n = length;
+
+    // Compute first few values so we're on a 16-byte boundary in dst_buffer
+    while( (((uintptr_t)dst_buffer & 0xF) > 0) && (n > 0) ) {
+        BLEND_EFFECT_PIXEL();
+        --n; ++dst_buffer; ++src1_buffer; ++src2_buffer;
+    }
+
+    // Do bulk of processing using AVX2 (process 8 32bit (BGRA) pixels)
+    // load alpha1, double-up (0x000000vv -> 0x00vv00vv)
+    __m256i a = _mm256_set1_epi32(mask2);
+    __m256i tmp = _mm256_slli_epi32(a, 16);
+    a = _mm256_or_si256(a, tmp);
+    while(n >= 8) {
+
+        tmp = _mm256_loadu_si256((__m256i*)src1_buffer);
+        __m256i buf = _mm256_loadu_si256((__m256i*)src2_buffer);
+        __m256i dst = alphaBlendCore_AVX2(tmp, buf, a);
+        _mm256_storeu_si256((__m256i*)dst_buffer, dst);
+
+        n -= 8; dst_buffer += 8; src1_buffer += 8; src2_buffer += 8;
+    }
+
+    return length - n + imageFilterEffectBlend_SSE2(dst_buffer, src1_buffer, src2_buffer, mask2, n);
+}
+
+int imageFilterEffectMaskBlend_AVX2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 *mask_buffer, Uint32 overflow_mask, Uint32 mask_value, int length)
+{
+    int n = length;
+
+    // Compute first few values so we're on a 16-byte boundary in dst_buffer
+    while( (((uintptr_t)dst_buffer & 0xF) > 0) && (n > 0) ) {
+        BLEND_EFFECT_MASK_PIXEL();
+        --n; ++dst_buffer; ++src1_buffer; ++src2_buffer; ++mask_buffer;
+    }
+
+    // Do bulk of processing using AVX2 (process 8 32bit (BGRA) pixels)
+    const __m256i bmask = _mm256_set1_epi32(0x000000FF);
+    __m256i over = bmask;
+    if (overflow_mask == 0xFFFFFFFF)
+        over = _mm256_setzero_si256();
+    __m256i value = _mm256_set1_epi32(mask_value);
+    while(n >= 8) {
+        //if (mask_value > (mask & BMASK))
+        //    alpha1 = subs(mask_value,(mask & BMASK)
+        //    if (alpha1 > over) alpha1 = BMASK
+        //else alpha1 = 0
+        __m256i buf = _mm256_loadu_si256((__m256i*)mask_buffer);
+        buf = _mm256_and_si256(buf, bmask);
+        __m256i tmp = _mm256_cmpgt_epi32(value, buf);
+        tmp = _mm256_and_si256(tmp, bmask);
+        __m256i a = _mm256_subs_epu16(value, buf);
+        buf = _mm256_cmpgt_epi32(a, over);
+        a = _mm256_or_si256(a, buf);
+        a = _mm256_and_si256(a, tmp);
+
+        // double-up alpha1 (0x000000vv -> 0x00vv00vv)
+        tmp = _mm256_slli_epi32(a, 16);
+        a = _mm256_or_si256(a, tmp);
+
+        tmp = _mm256_loadu_si256((__m256i*)src1_buffer);
+        buf = _mm256_loadu_si256((__m256i*)src2_buffer);
+        __m256i dst = alphaBlendCore_AVX2(tmp, buf, a);
+        _mm256_storeu_si256((__m256i*)dst_buffer, dst);
+
+        n -= 8; dst_buffer += 8; src1_buffer += 8; src2_buffer += 8; mask_buffer += 8;
+    }
+
+    return length - n + imageFilterEffectMaskBlend_SSE2(dst_buffer, src1_buffer, src2_buffer,
+                                                         mask_buffer, overflow_mask, mask_value, n);
+}
+
+int imageFilterEffectMaskBlend8_AVX2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint8 *mask_buffer, Uint32 overflow_mask, Uint32 mask_value, int length)
+{
+    int n = length;
+
+    // Compute first few values so we're on a 16-byte boundary in dst_buffer
+    while( (((uintptr_t)dst_buffer & 0xF) > 0) && (n > 0) ) {
+        BLEND_EFFECT_MASK_PIXEL();
+        --n; ++dst_buffer; ++src1_buffer; ++src2_buffer; ++mask_buffer;
+    }
+
+    // Do bulk of processing using AVX2 (process 8 32bit (BGRA) pixels)
+    const __m256i bmask = _mm256_set1_epi32(0x000000FF);
+    __m256i over = bmask;
+    if (overflow_mask == 0xFFFFFFFF)
+        over = _mm256_setzero_si256();
+    __m256i value = _mm256_set1_epi32(mask_value);
+    while(n >= 8) {
+        // widen 8 mask bytes to 32bit lanes
+        __m256i buf = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i*)mask_buffer));
+        __m256i tmp = _mm256_cmpgt_epi32(value, buf);
+        tmp = _mm256_and_si256(tmp, bmask);
+        __m256i a = _mm256_subs_epu16(value, buf);
+        buf = _mm256_cmpgt_epi32(a, over);
+        a = _mm256_or_si256(a, buf);
+        a = _mm256_and_si256(a, tmp);
+
+        // double-up alpha1 (0x000000vv -> 0x00vv00vv)
+        tmp = _mm256_slli_epi32(a, 16);
+        a = _mm256_or_si256(a, tmp);
+
+        tmp = _mm256_loadu_si256((__m256i*)src1_buffer);
+        buf = _mm256_loadu_si256((__m256i*)src2_buffer);
+        __m256i dst = alphaBlendCore_AVX2(tmp, buf, a);
+        _mm256_storeu_si256((__m256i*)dst_buffer, dst);
+
+        n -= 8; dst_buffer += 8; src1_buffer += 8; src2_buffer += 8; mask_buffer += 8;
+    }
+
+    return length - n + imageFilterEffectMaskBlend8_SSE2(dst_buffer, src1_buffer, src2_buffer,
+                                                          mask_buffer, overflow_mask, mask_value, n);
+}
+
+}//namespace ons_gfx
+
+#endif //USE_X86_AVX2_GFX
@@ -0,0 +1,38 @@
+/* -*- C++ -*-
+ * 
+ *  graphics_avx2.h - graphics routines using X86 AVX2 cpu functionality
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, see <http://www.gnu.org/licenses/>
+ *  or write to the Free Software Foundation, Inc.,
+ *  59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef __GRAPHICS_AVX2_H__
+#define __GRAPHICS_AVX2_H__
+
+#ifdef USE_X86_AVX2_GFX
+namespace ons_gfx {
+
+int imageFilterMean_AVX2(unsigned char *src1, unsigned char *src2, unsigned char *dst, int length);
+int imageFilterAddTo_AVX2(unsigned char *dst, unsigned char *src, int length);
+int imageFilterSubFrom_AVX2(unsigned char *dst, unsigned char *src, int length);
+int imageFilterBlend_AVX2(Uint32 *dst_buffer, Uint32 *src_buffer, Uint8 *alphap, int alpha, int length);
+int imageFilterEffectBlend_AVX2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 mask2, int length);
+int imageFilterEffectMaskBlend_AVX2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 *mask_buffer, Uint32 overflow_mask, Uint32 mask_value, int length);
+int imageFilterEffectMaskBlend8_AVX2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint8 *mask_buffer, Uint32 overflow_mask, Uint32 mask_value, int length);
+
+}
+#endif //USE_X86_AVX2_GFX
+
+#endif // __GRAPHICS_AVX2_H__
@@ -269,6 +269,7 @@ namespace ons_gfx {
     void imageFilterBlend(Uint32 *dst_buffer, Uint32 *src_buffer, Uint8 *alphap, int alpha, int length);
     void imageFilterEffectBlend(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 mask2, int length);
     void imageFilterEffectMaskBlend(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 *mask_buffer, Uint32 overflow_mask, Uint32 mask_value, int length);
+    void imageFilterEffectMaskBlend8(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint8 *mask_buffer, Uint32 overflow_mask, Uint32 mask_value, int length);
 #endif //!BPP16
 
 }
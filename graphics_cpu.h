@@ -38,12 +38,35 @@ namespace ons_gfx {
         CPUF_X86_MMX        =  1,
         CPUF_X86_SSE        =  2,
         CPUF_X86_SSE2       =  4,
-        CPUF_PPC_ALTIVEC    =  8
+        CPUF_PPC_ALTIVEC    =  8,
+        CPUF_X86_AVX2       = 16
     };
 
     void setCpufuncs(unsigned int func);
     unsigned int getCpufuncs();
 
+#if defined (USE_X86_GFX) && !defined(MACOSX)
+    // AVX2 needs both the cpu flag and OS support for saving the ymm registers
+    inline bool hasX86AVX2()
+    {
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0)
+            return false;
+        // OSXSAVE (bit 27) and AVX (bit 28)
+        if ((ecx & (3 << 27)) != (3 << 27))
+            return false;
+        unsigned int xcr0_lo, xcr0_hi;
+        __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" // xgetbv
+                              : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+        if ((xcr0_lo & 6) != 6) // xmm and ymm state
+            return false;
+        if (__get_cpuid_max(0, 0) < 7)
+            return false;
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        return (ebx & (1 << 5)) != 0; // AVX2
+    }
+#endif
+
 }
 
 #endif // __GRAPHICS_CPU_H__
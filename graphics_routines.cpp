@@ -32,6 +32,9 @@
 #include "graphics_mmx.h"
 #include "graphics_sse2.h"
 #endif
+#if defined(USE_X86_AVX2_GFX)
+#include "graphics_avx2.h"
+#endif
 
 #if defined(USE_PPC_GFX)
 #include "graphics_altivec.h"
@@ -67,6 +70,13 @@ void imageFilterMean(unsigned char *src1, unsigned char *src2, unsigned char *ds
 #elif defined(USE_X86_GFX)
 
 #ifndef MACOSX
+#ifdef USE_X86_AVX2_GFX
+    if (cpufuncs & CPUF_X86_AVX2) {
+
+        imageFilterMean_AVX2(src1, src2, dst, length);
+
+    } else
+#endif // USE_X86_AVX2_GFX
     if (cpufuncs & CPUF_X86_SSE2) {
 #endif // !MACOSX
 
@@ -101,6 +111,13 @@ void imageFilterAddTo(unsigned char *dst, unsigned char *src, int length)
 #elif defined(USE_X86_GFX)
 
 #ifndef MACOSX
+#ifdef USE_X86_AVX2_GFX
+    if (cpufuncs & CPUF_X86_AVX2) {
+
+        imageFilterAddTo_AVX2(dst, src, length);
+
+    } else
+#endif // USE_X86_AVX2_GFX
     if (cpufuncs & CPUF_X86_SSE2) {
 #endif // !MACOSX
 
@@ -135,6 +152,13 @@ void imageFilterSubFrom(unsigned char *dst, unsigned char *src, int length)
 #elif defined(USE_X86_GFX)
 
 #ifndef MACOSX
+#ifdef USE_X86_AVX2_GFX
+    if (cpufuncs & CPUF_X86_AVX2) {
+
+        imageFilterSubFrom_AVX2(dst, src, length);
+
+    } else
+#endif // USE_X86_AVX2_GFX
     if (cpufuncs & CPUF_X86_SSE2) {
 #endif // !MACOSX
 
@@ -162,6 +186,13 @@ void imageFilterBlend(Uint32 *dst_buffer, Uint32 *src_buffer,
 {
 #if defined(USE_X86_GFX)
 #ifndef MACOSX
+#ifdef USE_X86_AVX2_GFX
+    if (cpufuncs & CPUF_X86_AVX2) {
+
+        imageFilterBlend_AVX2(dst_buffer, src_buffer, alphap, alpha, length);
+
+    } else
+#endif // USE_X86_AVX2_GFX
     if (cpufuncs & CPUF_X86_SSE2) {
 #endif // !MACOSX
 
@@ -185,6 +216,13 @@ void imageFilterEffectBlend(Uint32 *dst_buffer, Uint32 *src1_buffer,
 {
 #if defined(USE_X86_GFX)
 #ifndef MACOSX
+#ifdef USE_X86_AVX2_GFX
+    if (cpufuncs & CPUF_X86_AVX2) {
+
+        imageFilterEffectBlend_AVX2(dst_buffer, src1_buffer, src2_buffer, mask2, length);
+
+    } else
+#endif // USE_X86_AVX2_GFX
     if (cpufuncs & CPUF_X86_SSE2) {
 #endif // !MACOSX
 
@@ -216,6 +254,14 @@ void imageFilterEffectMaskBlend(Uint32 *dst_buffer, Uint32 *src1_buffer,
 {
 #if defined(USE_X86_GFX)
 #ifndef MACOSX
+#ifdef USE_X86_AVX2_GFX
+    if (cpufuncs & CPUF_X86_AVX2) {
+
+        imageFilterEffectMaskBlend_AVX2(dst_buffer, src1_buffer, src2_buffer,
+                                        mask_buffer, overflow_mask, mask_value, length);
+
+    } else
+#endif // USE_X86_AVX2_GFX
     if (cpufuncs & CPUF_X86_SSE2) {
 #endif // !MACOSX
 
@@ -241,6 +287,46 @@ void imageFilterEffectMaskBlend(Uint32 *dst_buffer, Uint32 *src1_buffer,
 #endif
 }
 
+void imageFilterEffectMaskBlend8(Uint32 *dst_buffer, Uint32 *src1_buffer,
+                                 Uint32 *src2_buffer, Uint8 *mask_buffer,
+                                 Uint32 overflow_mask, Uint32 mask_value,
+                                 int length)
+{
+#if defined(USE_X86_GFX)
+#ifndef MACOSX
+#ifdef USE_X86_AVX2_GFX
+    if (cpufuncs & CPUF_X86_AVX2) {
+
+        imageFilterEffectMaskBlend8_AVX2(dst_buffer, src1_buffer, src2_buffer,
+                                         mask_buffer, overflow_mask, mask_value, length);
+
+    } else
+#endif // USE_X86_AVX2_GFX
+    if (cpufuncs & CPUF_X86_SSE2) {
+#endif // !MACOSX
+
+        imageFilterEffectMaskBlend8_SSE2(dst_buffer, src1_buffer, src2_buffer,
+                                         mask_buffer, overflow_mask, mask_value, length);
+
+#ifndef MACOSX
+    } else {
+        int n = length + 1;
+        while(--n > 0) {
+            BLEND_EFFECT_MASK_PIXEL();
+            ++dst_buffer, ++src1_buffer, ++src2_buffer, ++mask_buffer;
+        }
+    }
+#endif // !MACOSX
+
+#else // no special gfx handling
+    int n = length + 1;
+    while(--n > 0) {
+        BLEND_EFFECT_MASK_PIXEL();
+        ++dst_buffer, ++src1_buffer, ++src2_buffer, ++mask_buffer;
+    }
+#endif
+}
+
 #endif //!BPP16
 
 
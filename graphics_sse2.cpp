@@ -27,6 +27,7 @@
 #ifdef USE_X86_GFX
 
 #include <stdint.h>
+#include <string.h>
 
 #include <emmintrin.h>
 #include <math.h>
@@ -281,6 +282,61 @@ int imageFilterEffectMaskBlend_SSE2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uin
     return length - n;
 }
 
+// same as imageFilterEffectMaskBlend_SSE2, reading the threshold from a
+// plane of bytes instead of the blue channel of a 32-bit image
+int imageFilterEffectMaskBlend8_SSE2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint8 *mask_buffer, Uint32 overflow_mask, Uint32 mask_value, int length)
+{
+    int n = length;
+
+    // Compute first few values so we're on a 16-byte boundary in dst_buffer
+    while( (((uintptr_t)dst_buffer & 0xF) > 0) && (n > 0) ) {
+        BLEND_EFFECT_MASK_PIXEL();
+        --n; ++dst_buffer; ++src1_buffer; ++src2_buffer; ++mask_buffer;
+    }
+
+    // Do bulk of processing using SSE2 (process 4 32bit (BGRA) pixels)
+    __m128i over = bmask;
+    if (overflow_mask == 0xFFFFFFFF)
+        over = _mm_xor_si128(bmask, bmask);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i value = _mm_set1_epi32(mask_value);
+    while(n >= 4) {
+        // widen 4 mask bytes to 32bit lanes
+        int m;
+        memcpy(&m, mask_buffer, 4);
+        __m128i buf = _mm_cvtsi32_si128(m);
+        buf = _mm_unpacklo_epi8(buf, zero);
+        buf = _mm_unpacklo_epi16(buf, zero);
+
+        __m128i tmp = _mm_cmpgt_epi32(value, buf);
+        tmp = _mm_and_si128(tmp, bmask);
+        __m128i a = _mm_subs_epu16(value, buf);
+        buf = _mm_cmpgt_epi32(a, over);
+        a = _mm_or_si128(a, buf);
+        a = _mm_and_si128(a, tmp);
+
+        // double-up alpha1 (0x000000vv -> 0x00vv00vv)
+        tmp = _mm_slli_epi32(a, 16);
+        a = _mm_or_si128(a, tmp);
+
+        tmp = _mm_loadu_si128((__m128i*)src1_buffer);
+        buf = _mm_loadu_si128((__m128i*)src2_buffer);
+        __m128i dst = alphaBlendCore_SSE2(tmp, buf, a);
+        _mm_store_si128((__m128i*)dst_buffer, dst);
+
+        n -= 4; dst_buffer += 4; src1_buffer += 4; src2_buffer += 4; mask_buffer += 4;
+    }
+
+    // If any pixels are left over, deal with them individually
+    ++n;
+    while(--n > 0) {
+        BLEND_EFFECT_MASK_PIXEL();
+        ++dst_buffer, ++src1_buffer, ++src2_buffer; ++mask_buffer;
+    }
+
+    return length - n;
+}
+
 }//namespace ons_gfx
 
 #endif //USE_X86_GFX
@@ -34,6 +34,7 @@ int imageFilterSubFrom_SSE2(unsigned char *dst, unsigned char *src, int length);
 int imageFilterBlend_SSE2(Uint32 *dst_buffer, Uint32 *src_buffer, Uint8 *alphap, int alpha, int length);
 int imageFilterEffectBlend_SSE2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 mask2, int length);
 int imageFilterEffectMaskBlend_SSE2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 *mask_buffer, Uint32 is_crossfade, Uint32 mask_value, int length);
+int imageFilterEffectMaskBlend8_SSE2(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint8 *mask_buffer, Uint32 overflow_mask, Uint32 mask_value, int length);
 
 }
 #endif //USE_X86_GFX
@@ -90,7 +90,7 @@ static void optionHelp()
     printf( "      --detect-png-nscmask\tdetect PNG alpha images that actually use masks\n");
     printf( "      --force-button-shortcut\tignore useescspc and getenter command\n");
 #ifdef USE_X86_GFX
-    printf( "      --disable-cpu-gfx\tdo not use MMX/SSE2 graphics acceleration routines\n");
+    printf( "      --disable-cpu-gfx\tdo not use MMX/SSE2/AVX2 graphics acceleration routines\n");
 #elif  USE_PPC_GFX
     printf( "      --disable-cpu-gfx\tdo not use Altivec graphics acceleration routines\n");
 #endif
@@ -101,6 +101,14 @@ static void optionHelp()
     printf( "      --fileversion\tset the ONS file version for loading unversioned files\n");
     printf( "      --key-exe file\tset a file (*.EXE) that includes a key table\n");
     printf( "      --nsa-offset offset\tuse byte offset x when reading arc*.nsa files\n");
+    printf( "      --image-cache-size MB\tkeep up to MB megabytes of decoded images for reuse (0 disables)\n");
+    printf( "      --sound-cache-size MB\tkeep up to MB megabytes of decoded sound effects and voices for reuse (0 disables)\n");
+    printf( "      --no-prefetch\tdon't decode upcoming images in the background\n");
+    printf( "      --compositor-threads num\tcomposite screen updates in bands on num extra threads (default: 0)\n");
+    printf( "      --restore-threads num\tdecode a saved game's images on num extra threads while loading it (default: 2)\n");
+    printf( "      --bilinear-sprites\tuse bilinear filtering for rotated and zoomed sprites\n");
+    printf( "      --effect-prerender\trender transition effect frames ahead of time on a separate thread\n");
+    printf( "      --no-file-snapshot\tlook for loose game files on disk every time instead of listing them once at startup\n");
     printf( "      --allow-color-type-only\tsyntax option for only recognizing color type for color arguments\n");
     printf( "      --set-tag-page-origin-to-1\tsyntax option for setting 'gettaglog' origin to 1 instead of 0\n");
     printf( "      --answer-dialog-with-yes-ok\thave 'yesnobox' and 'okcancelbox' give 'yes/ok' result\n");
@@ -248,6 +256,38 @@ static void parseOptions(int argc, char **argv, ONScripterLabel &ons, bool &hasA
                 argv++;
                 ons.setNsaOffset(argv[0]);
             }
+            else if ( !strcmp( argv[0]+1, "-image-cache-size" ) ){
+                argc--;
+                argv++;
+                ons.setImageCacheSize(atoi(argv[0]));
+            }
+            else if ( !strcmp( argv[0]+1, "-sound-cache-size" ) ){
+                argc--;
+                argv++;
+                ons.setSoundCacheSize(atoi(argv[0]));
+            }
+            else if ( !strcmp( argv[0]+1, "-no-prefetch" ) ){
+                ons.disablePrefetch();
+            }
+            else if ( !strcmp( argv[0]+1, "-compositor-threads" ) ){
+                argc--;
+                argv++;
+                ons.setCompositorThreads(atoi(argv[0]));
+            }
+            else if ( !strcmp( argv[0]+1, "-restore-threads" ) ){
+                argc--;
+                argv++;
+                ons.setRestoreThreads(atoi(argv[0]));
+            }
+            else if ( !strcmp( argv[0]+1, "-bilinear-sprites" ) ){
+                ons.enableBilinearSprites();
+            }
+            else if ( !strcmp( argv[0]+1, "-effect-prerender" ) ){
+                ons.enableEffectPrerender();
+            }
+            else if ( !strcmp( argv[0]+1, "-no-file-snapshot" ) ){
+                ons.disableFileSnapshot();
+            }
             else if ( !strcmp( argv[0]+1, "-force-button-shortcut" ) ){
                 ons.enableButtonShortCut();
             }
@@ -0,0 +1,75 @@
+// The per-pixel affine blit that AnimationInfo::blendOnSurface2 used
+// before it rasterized spans; shared by the test and the benchmark.
+
+#ifndef __AFFINE_BLEND_REFERENCE_H__
+#define __AFFINE_BLEND_REFERENCE_H__
+
+#include "AnimationInfo.h"
+#include "graphics_blend.h"
+
+// blendOnSurface2 as it was before the span rasterizer, one inverse
+// projection per pixel; the reference for nearest-neighbour output
+inline void referenceBlendOnSurface2( AnimationInfo &ai, SDL_Surface *dst_surface, int dst_x, int dst_y,
+                               SDL_Rect &clip, int alpha )
+{
+  typedef AnimationInfo::ONSBuf ONSBuf;
+  int min_xy[2]={ai.bounding_rect.x, ai.bounding_rect.y};
+  int max_xy[2]={ai.bounding_rect.x+ai.bounding_rect.w-1, ai.bounding_rect.y+ai.bounding_rect.h-1};
+  if (max_xy[0] < clip.x) return;
+  if (max_xy[0] >= (clip.x + clip.w)) max_xy[0] = clip.x + clip.w - 1;
+  if (min_xy[0] >= (clip.x + clip.w)) return;
+  if (min_xy[0] < clip.x) min_xy[0] = clip.x;
+  if (max_xy[1] < clip.y) return;
+  if (max_xy[1] >= (clip.y + clip.h)) max_xy[1] = clip.y + clip.h - 1;
+  if (min_xy[1] >= (clip.y + clip.h)) return;
+  if (min_xy[1] < clip.y) min_xy[1] = clip.y;
+  if (min_xy[1] < 0)               min_xy[1] = 0;
+  if (max_xy[1] >= dst_surface->h) max_xy[1] = dst_surface->h - 1;
+
+  int total_width = ai.image_surface->pitch / 4;
+  for (int y=min_xy[1] ; y<= max_xy[1] ; y++){
+    int raster_min = min_xy[0], raster_max = max_xy[0];
+    for (int i=0 ; i<4 ; i++){
+      int i2 = (i+1)&3;
+      if (ai.corner_xy[i][1] == ai.corner_xy[i2][1]) continue;
+      int x = (ai.corner_xy[i2][0] - ai.corner_xy[i][0])*(y-ai.corner_xy[i][1])/(ai.corner_xy[i2][1] - ai.corner_xy[i][1]) + ai.corner_xy[i][0];
+      if (ai.corner_xy[i2][1] - ai.corner_xy[i][1] > 0){
+        if (raster_min < x) raster_min = x;
+      }
+      else{
+        if (raster_max > x) raster_max = x;
+      }
+    }
+    if (raster_min < 0)               raster_min = 0;
+    if (raster_max >= dst_surface->w) raster_max = dst_surface->w - 1;
+
+    ONSBuf *dst_buffer = (ONSBuf *)dst_surface->pixels + dst_surface->w * y + raster_min;
+    int x_offset2 = (ai.inv_mat[0][1] * (y-dst_y) >> 9) + ai.pos.w;
+    int y_offset2 = (ai.inv_mat[1][1] * (y-dst_y) >> 9) + ai.pos.h;
+    for (int x=raster_min-dst_x ; x<=raster_max-dst_x ; x++, dst_buffer++){
+      int x2 = ((ai.inv_mat[0][0] * x >> 9) + x_offset2) / 2;
+      int y2 = ((ai.inv_mat[1][0] * x >> 9) + y_offset2) / 2;
+      if (x2 < 0 || x2 >= ai.pos.w || y2 < 0 || y2 >= ai.pos.h) continue;
+
+      ONSBuf *src_buffer = (ONSBuf *)ai.image_surface->pixels + total_width * y2 + x2 + ai.pos.w*ai.current_cell;
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+      unsigned char *alphap = (unsigned char *)src_buffer + 3;
+#else
+      unsigned char *alphap = (unsigned char *)src_buffer;
+#endif
+      if (ai.blending_mode == AnimationInfo::BLEND_NORMAL) {
+        if ((ai.trans_mode == AnimationInfo::TRANS_COPY) && (alpha == 256)) {
+          *dst_buffer = *src_buffer;
+        } else {
+          BLEND_PIXEL();
+        }
+      } else if (ai.blending_mode == AnimationInfo::BLEND_ADD) {
+        ADDBLEND_PIXEL();
+      } else if (ai.blending_mode == AnimationInfo::BLEND_SUB) {
+        SUBBLEND_PIXEL();
+      }
+    }
+  }
+}
+
+#endif // __AFFINE_BLEND_REFERENCE_H__
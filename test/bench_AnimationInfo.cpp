@@ -0,0 +1,83 @@
+// Rotated/zoomed sprite blits (lsp2, drawsp2): the old per-pixel projection
+// against the span rasterizer, nearest-neighbour and bilinear.
+// Build and run with "make bench"; not part of the test target.
+
+#include "AnimationInfo.h"
+#include "AffineBlendReference.h"
+#include "graphics_cpu.h"
+
+#include <stdio.h>
+#include <time.h>
+
+namespace {
+
+const int SCREEN_W = 1280, SCREEN_H = 720;
+const int FRAMES = 60;
+
+void detectCpu()
+{
+    unsigned int func = ons_gfx::CPUF_NONE;
+#if defined(USE_X86_GFX)
+    func |= ons_gfx::CPUF_X86_SSE2;
+#endif
+#if defined(USE_X86_AVX2_GFX)
+    if (ons_gfx::hasX86AVX2()) func |= ons_gfx::CPUF_X86_AVX2;
+#endif
+    ons_gfx::setCpufuncs(func);
+}
+
+double run(AnimationInfo &ai, SDL_Surface *dst, int method)
+{
+    SDL_Rect clip = {0, 0, SCREEN_W, SCREEN_H};
+    long pixels = 0;
+    clock_t start = clock();
+    for (int frame=0; frame<FRAMES; frame++){
+        ai.rot = frame * 6;
+        ai.calcAffineMatrix();
+        pixels += (long)ai.bounding_rect.w * ai.bounding_rect.h;
+        if (method == 0)
+            referenceBlendOnSurface2(ai, dst, ai.pos.x, ai.pos.y, clip, 200);
+        else
+            ai.blendOnSurface2(dst, ai.pos.x, ai.pos.y, clip, 200, method == 2);
+    }
+    double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (secs <= 0) secs = 1.0 / CLOCKS_PER_SEC;
+    printf(" %8.1f fps %8.1f MPixels/s", FRAMES / secs, pixels / secs / 1000000.0);
+    return secs;
+}
+
+}
+
+int main()
+{
+    detectCpu();
+    SDL_Surface *dst = AnimationInfo::allocSurface(SCREEN_W, SCREEN_H);
+
+    AnimationInfo ai;
+    ai.num_of_cells = 1;
+    ai.trans_mode = AnimationInfo::TRANS_ALPHA;
+    ai.allocImage(SCREEN_W, SCREEN_H);
+    unsigned int seed = 1;
+    Uint32 *p = (Uint32*)ai.image_surface->pixels;
+    for (int i=0; i<SCREEN_W * SCREEN_H; i++){
+        seed = seed * 1103515245 + 12345;
+        p[i] = seed;
+    }
+    ai.pos.x = SCREEN_W / 2;
+    ai.pos.y = SCREEN_H / 2;
+
+    const int scales[] = { 100, 150, 60 };
+    const char *methods[] = { "per-pixel", "nearest", "bilinear" };
+    printf("full-screen %dx%d sprite, rotating over %d frames\n", SCREEN_W, SCREEN_H, FRAMES);
+    for (int s=0; s<3; s++){
+        ai.scale_x = ai.scale_y = scales[s];
+        for (int m=0; m<3; m++){
+            printf("zoom %3d%% %-10s", scales[s], methods[m]);
+            run(ai, dst, m);
+            printf("\n");
+        }
+    }
+
+    SDL_FreeSurface(dst);
+    return 0;
+}
@@ -0,0 +1,165 @@
+// Throughput of the cpu graphics routines against the scalar macros.
+// Build and run with "make bench"; not part of the test target.
+
+#include "graphics_sum.h"
+#include "graphics_blend.h"
+#include "graphics_cpu.h"
+#if defined(USE_X86_GFX)
+#include "graphics_sse2.h"
+#endif
+#if defined(USE_X86_AVX2_GFX)
+#include "graphics_avx2.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+using namespace ons_gfx;
+
+namespace {
+
+// one 1080p row, repeated often enough for clock() to resolve
+const int WIDTH = 1920;
+const int ROWS = 20000;
+
+unsigned char src1[WIDTH * 4], src2[WIDTH * 4], dst[WIDTH * 4];
+Uint32 p1[WIDTH], p2[WIDTH], mask[WIDTH], pdst[WIDTH];
+
+int meanScalar(unsigned char *src1, unsigned char *src2, unsigned char *dst, int length) {
+  int n = length + 1;
+  BASIC_MEAN();
+  return length;
+}
+int addToScalar(unsigned char *dst, unsigned char *src, int length) {
+  int n = length + 1;
+  BASIC_ADDTO();
+  return length;
+}
+int subFromScalar(unsigned char *dst, unsigned char *src, int length) {
+  int n = length + 1;
+  BASIC_SUBFROM();
+  return length;
+}
+int blendScalar(Uint32 *dst_buffer, Uint32 *src_buffer, Uint8 *alphap, int alpha, int length) {
+  int n = length + 1;
+  BASIC_BLEND();
+  return length;
+}
+int effectBlendScalar(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 mask2, int length) {
+  int n = length + 1;
+  while (--n > 0) {
+    BLEND_EFFECT_PIXEL();
+    ++dst_buffer, ++src1_buffer, ++src2_buffer;
+  }
+  return length;
+}
+int effectMaskBlendScalar(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 *mask_buffer,
+                          Uint32 overflow_mask, Uint32 mask_value, int length) {
+  int n = length + 1;
+  while (--n > 0) {
+    BLEND_EFFECT_MASK_PIXEL();
+    ++dst_buffer, ++src1_buffer, ++src2_buffer, ++mask_buffer;
+  }
+  return length;
+}
+int effectMaskBlend8Scalar(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint8 *mask_buffer,
+                           Uint32 overflow_mask, Uint32 mask_value, int length) {
+  int n = length + 1;
+  while (--n > 0) {
+    BLEND_EFFECT_MASK_PIXEL();
+    ++dst_buffer, ++src1_buffer, ++src2_buffer, ++mask_buffer;
+  }
+  return length;
+}
+
+struct Kernels {
+  const char *name;
+  int (*mean)(unsigned char*, unsigned char*, unsigned char*, int);
+  int (*addTo)(unsigned char*, unsigned char*, int);
+  int (*subFrom)(unsigned char*, unsigned char*, int);
+  int (*blend)(Uint32*, Uint32*, Uint8*, int, int);
+  int (*effectBlend)(Uint32*, Uint32*, Uint32*, Uint32, int);
+  int (*effectMaskBlend)(Uint32*, Uint32*, Uint32*, Uint32*, Uint32, Uint32, int);
+  int (*effectMaskBlend8)(Uint32*, Uint32*, Uint32*, Uint8*, Uint32, Uint32, int);
+  bool (*available)();
+};
+
+bool always() { return true; }
+
+const Kernels kernels[] = {
+  { "scalar", meanScalar, addToScalar, subFromScalar,
+    blendScalar, effectBlendScalar, effectMaskBlendScalar, effectMaskBlend8Scalar, always },
+#if defined(USE_X86_GFX)
+  { "SSE2", imageFilterMean_SSE2, imageFilterAddTo_SSE2, imageFilterSubFrom_SSE2,
+    imageFilterBlend_SSE2, imageFilterEffectBlend_SSE2, imageFilterEffectMaskBlend_SSE2,
+    imageFilterEffectMaskBlend8_SSE2, always },
+#endif
+#if defined(USE_X86_AVX2_GFX)
+  { "AVX2", imageFilterMean_AVX2, imageFilterAddTo_AVX2, imageFilterSubFrom_AVX2,
+    imageFilterBlend_AVX2, imageFilterEffectBlend_AVX2, imageFilterEffectMaskBlend_AVX2,
+    imageFilterEffectMaskBlend8_AVX2, hasX86AVX2 },
+#endif
+  { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL }
+};
+
+clock_t start_time;
+
+void startTimer() {
+  start_time = clock();
+}
+
+// pixels are 32bit, so the byte routines cover WIDTH*4 bytes per row
+void report(const char *routine) {
+  double secs = (double)(clock() - start_time) / CLOCKS_PER_SEC;
+  if (secs <= 0) secs = 1.0 / CLOCKS_PER_SEC;
+  printf(" %16s %10.1f", routine, (double)WIDTH * ROWS / secs / 1000000.0);
+}
+
+}
+
+int main()
+{
+  unsigned int seed = 1;
+  for (int i=0; i<WIDTH * 4; i++) {
+    seed = seed * 1103515245 + 12345;
+    src1[i] = seed >> 8;
+    src2[i] = seed >> 16;
+  }
+  memcpy(p1, src1, sizeof(p1));
+  memcpy(p2, src2, sizeof(p2));
+  memcpy(mask, src1 + 1, sizeof(mask) - 1);
+
+  printf("MPixels/s over %d rows of %d pixels\n", ROWS, WIDTH);
+  for (const Kernels *k = kernels; k->name; k++) {
+    if (!k->available()) continue;
+    printf("%-7s", k->name);
+
+    startTimer();
+    for (int i=0; i<ROWS; i++) k->mean(src1, src2, dst, WIDTH * 4);
+    report("mean");
+    startTimer();
+    for (int i=0; i<ROWS; i++) k->addTo(dst, src2, WIDTH * 4);
+    report("addTo");
+    startTimer();
+    for (int i=0; i<ROWS; i++) k->subFrom(dst, src1, WIDTH * 4);
+    report("subFrom");
+    printf("\n%-7s", "");
+
+    startTimer();
+    for (int i=0; i<ROWS; i++) k->blend(pdst, p2, (Uint8*)p2 + 3, 200, WIDTH);
+    report("blend");
+    startTimer();
+    for (int i=0; i<ROWS; i++) k->effectBlend(pdst, p1, p2, i & 0xff, WIDTH);
+    report("effectBlend");
+    startTimer();
+    for (int i=0; i<ROWS; i++) k->effectMaskBlend(pdst, p1, p2, mask, ~0xffu, i & 0x1ff, WIDTH);
+    report("effectMaskBlend");
+    startTimer();
+    for (int i=0; i<ROWS; i++) k->effectMaskBlend8(pdst, p1, p2, src1, ~0xffu, i & 0x1ff, WIDTH);
+    report("effectMaskBlend8");
+    printf("\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include "AnimationInfo.h"
+#include "AffineBlendReference.h"
+
+#include "gtest/gtest.h"
+
+#include <string.h>
+
+namespace {
+
+class AnimationInfoAffineTest : public ::testing::Test {
+protected:
+  AnimationInfo ai;
+  SDL_Surface *dst, *ref;
+
+  void SetUp() {
+    ai.num_of_cells = 2;
+    ai.trans_mode = AnimationInfo::TRANS_ALPHA;
+    alloc(97, 61);
+    dst = AnimationInfo::allocSurface(320, 240);
+    ref = AnimationInfo::allocSurface(320, 240);
+  }
+  void TearDown() {
+    SDL_FreeSurface(dst);
+    SDL_FreeSurface(ref);
+  }
+
+  // two cells of w x h random pixels, drawing the second
+  void alloc(int w, int h) {
+    ai.allocImage(2 * w, h);
+    unsigned int seed = 7;
+    Uint32 *p = (Uint32*)ai.image_surface->pixels;
+    for (int i=0; i<ai.image_surface->w * ai.image_surface->h; i++) {
+      seed = seed * 1103515245 + 12345;
+      p[i] = seed ^ (seed >> 13);
+    }
+    ai.setCell(1);
+  }
+  void place(int x, int y, int scale_x, int scale_y, int rot) {
+    ai.pos.x = x;
+    ai.pos.y = y;
+    ai.scale_x = scale_x;
+    ai.scale_y = scale_y;
+    ai.rot = rot;
+    ai.calcAffineMatrix();
+  }
+  void clear() {
+    for (int i=0; i<320*240; i++)
+      ((Uint32*)dst->pixels)[i] = ((Uint32*)ref->pixels)[i] = 0x80402010 + i;
+  }
+  bool same() {
+    return memcmp(dst->pixels, ref->pixels, 320*240*4) == 0;
+  }
+};
+
+TEST_F (AnimationInfoAffineTest, NearestMatchesPerPixelProjection) {
+  const int rots[] = { 0, 15, 90, 137, 180, 271, 359 };
+  const int scales[][2] = { {100, 100}, {250, 40}, {-100, 100}, {33, -180}, {400, 400} };
+  SDL_Rect clip = {0, 0, 320, 240};
+  SDL_Rect part = {40, 30, 150, 100};
+  for (int mode=0; mode<3; mode++)
+    for (int r=0; r<7; r++)
+      for (int s=0; s<5; s++) {
+        ai.blending_mode = mode;
+        place(150 + r, 110 - s, scales[s][0], scales[s][1], rots[r]);
+        clear();
+        ai.blendOnSurface2(dst, ai.pos.x, ai.pos.y, clip, 200);
+        referenceBlendOnSurface2(ai, ref, ai.pos.x, ai.pos.y, clip, 200);
+        ASSERT_TRUE(same()) << "mode " << mode << " rot " << rots[r] << " scale " << s;
+        ai.blendOnSurface2(dst, ai.pos.x, ai.pos.y, part, 256);
+        referenceBlendOnSurface2(ai, ref, ai.pos.x, ai.pos.y, part, 256);
+        ASSERT_TRUE(same()) << "clipped: mode " << mode << " rot " << rots[r] << " scale " << s;
+      }
+}
+
+TEST_F (AnimationInfoAffineTest, NearestCopiesOpaqueSpritesLongerThanOneSpan) {
+  ai.trans_mode = AnimationInfo::TRANS_COPY;
+  place(160, 120, 400, 100, 3);
+  clear();
+  SDL_Rect clip = {0, 0, 320, 240};
+  ai.blendOnSurface2(dst, ai.pos.x, ai.pos.y, clip, 256);
+  referenceBlendOnSurface2(ai, ref, ai.pos.x, ai.pos.y, clip, 256);
+  EXPECT_TRUE(same());
+}
+
+TEST_F (AnimationInfoAffineTest, BilinearIsExactWithoutTransform) {
+  const int scales[][2] = { {100, 100}, {-100, 100}, {100, -100}, {-100, -100} };
+  SDL_Rect clip = {0, 0, 320, 240};
+  for (int width=96; width<=97; width++)
+    for (int s=0; s<4; s++) {
+      alloc(width, 61 + width - 96);
+      place(160, 120, scales[s][0], scales[s][1], 0);
+      clear();
+      ai.blendOnSurface2(dst, ai.pos.x, ai.pos.y, clip, 256, true);
+      referenceBlendOnSurface2(ai, ref, ai.pos.x, ai.pos.y, clip, 256);
+      ASSERT_TRUE(same()) << "width " << width << " scale " << s;
+    }
+}
+
+TEST_F (AnimationInfoAffineTest, BilinearInterpolatesNeighbours) {
+  // a horizontal ramp zoomed 2x: each output pixel lies between two texels
+  Uint32 *p = (Uint32*)ai.image_surface->pixels;
+  for (int y=0; y<ai.image_surface->h; y++)
+    for (int x=0; x<ai.image_surface->w; x++)
+      p[y * ai.image_surface->w + x] = 0xff000000 | ((x % 97) * 2);
+  ai.trans_mode = AnimationInfo::TRANS_COPY;
+  place(160, 120, 200, 200, 0);
+  clear();
+  SDL_Rect clip = {0, 0, 320, 240};
+  ai.blendOnSurface2(dst, ai.pos.x, ai.pos.y, clip, 256, true);
+
+  Uint32 *row = (Uint32*)dst->pixels + 320 * 120;
+  int steps = 0;
+  for (int x=100; x<220; x++) {
+    int d = (int)(row[x+1] & 0xff) - (int)(row[x] & 0xff);
+    EXPECT_GE(d, 0) << x;
+    EXPECT_LE(d, 1) << x;
+    steps += d;
+  }
+  // nearest would repeat each texel twice, stepping by 2
+  EXPECT_GT(steps, 100);
+}
+
+}
@@ -0,0 +1,91 @@
+#include "ArchiveStream.h"
+
+#include "gtest/gtest.h"
+#include <stdio.h>
+
+namespace {
+
+// a StreamSource over a temporary file holding junk, then data
+BaseReader::StreamSource makeSource(const unsigned char *data, size_t length,
+                                    size_t original_length, int compression_type) {
+  BaseReader::StreamSource src;
+  src.fp = tmpfile();
+  fwrite("junk", 1, 4, src.fp);
+  fwrite(data, 1, length, src.fp);
+  fflush(src.fp);
+  src.offset = 4;
+  src.length = length;
+  src.original_length = original_length;
+  src.compression_type = compression_type;
+  return src;
+}
+
+TEST (ArchiveStreamTest, ReadsAndSeeksStoredBytes) {
+  unsigned char data[1000];
+  for (int i=0; i<1000; i++) data[i] = (unsigned char)(i*7);
+  SDL_RWops *rw = ArchiveStream::createRWops(makeSource(data, 1000, 1000, BaseReader::NO_COMPRESSION));
+  ASSERT_TRUE(rw != NULL);
+
+  unsigned char buf[1000];
+  EXPECT_EQ(1, SDL_RWread(rw, buf, 10, 1));
+  EXPECT_EQ(0, memcmp(buf, data, 10));
+  EXPECT_EQ(1000, SDL_RWseek(rw, 0, RW_SEEK_END));
+  EXPECT_EQ(0, SDL_RWread(rw, buf, 1, 1));
+  EXPECT_EQ(500, SDL_RWseek(rw, -500, RW_SEEK_END));
+  EXPECT_EQ(500, SDL_RWread(rw, buf, 1, 1000));
+  EXPECT_EQ(0, memcmp(buf, data+500, 500));
+  EXPECT_EQ(-1, SDL_RWseek(rw, 1, RW_SEEK_END));
+  EXPECT_EQ(-1, SDL_RWwrite(rw, buf, 1, 1));
+  SDL_RWclose(rw);
+}
+
+TEST (ArchiveStreamTest, AppliesKeyTable) {
+  unsigned char data[256];
+  for (int i=0; i<256; i++) data[i] = (unsigned char)i;
+  BaseReader::StreamSource src = makeSource(data, 256, 256, BaseReader::NO_COMPRESSION);
+  src.key_table_flag = true;
+  for (int i=0; i<256; i++) src.key_table[i] = (unsigned char)(i ^ 0x84);
+
+  ArchiveStream stream(src);
+  unsigned char buf[256];
+  ASSERT_EQ(256u, stream.read(buf, 256));
+  for (int i=0; i<256; i++)
+    ASSERT_EQ(i ^ 0x84, buf[i]);
+}
+
+TEST (ArchiveStreamTest, DecodesNBZ) {
+  const unsigned int length = 100000;
+  unsigned char *data = new unsigned char[length];
+  for (unsigned int i=0; i<length; i++) data[i] = (unsigned char)((i*i) >> 5);
+  unsigned int packed_length = length + length/100 + 600;
+  char *packed = new char[packed_length];
+  ASSERT_EQ(BZ_OK, BZ2_bzBuffToBuffCompress(packed, &packed_length, (char*)data, length, 9, 0, 0));
+
+  ArchiveStream stream(makeSource((unsigned char*)packed, packed_length, length, BaseReader::NBZ_COMPRESSION));
+  EXPECT_EQ(length, stream.getLength());
+  unsigned char *buf = new unsigned char[length];
+  size_t got = 0;
+  while (got < length) {
+    size_t n = stream.read(buf+got, 777);
+    ASSERT_NE(0u, n);
+    got += n;
+  }
+  EXPECT_EQ(0, memcmp(buf, data, length));
+  EXPECT_EQ(0u, stream.read(buf, 1));
+
+  // seeking back starts the decoder over
+  ASSERT_TRUE(stream.seek(12345));
+  EXPECT_EQ(12345u, stream.tell());
+  ASSERT_EQ(100u, stream.read(buf, 100));
+  EXPECT_EQ(0, memcmp(buf, data+12345, 100));
+  ASSERT_TRUE(stream.seek(90000));
+  ASSERT_EQ(100u, stream.read(buf, 100));
+  EXPECT_EQ(0, memcmp(buf, data+90000, 100));
+  EXPECT_FALSE(stream.seek(length+1));
+
+  delete[] buf;
+  delete[] packed;
+  delete[] data;
+}
+
+} // namespace
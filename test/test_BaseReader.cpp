@@ -19,6 +19,8 @@ TEST (BaseReaderTest, ArchiveInfoConstructor) {
   EXPECT_EQ(NULL, ai.fi_list);
   EXPECT_EQ(0u, ai.num_of_files);
   EXPECT_EQ(0u, ai.base_offset);
+  EXPECT_EQ(NULL, ai.mapped_data);
+  EXPECT_EQ(0u, ai.mapped_length);
 }
 
 } // namespace
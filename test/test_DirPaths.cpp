@@ -52,4 +52,51 @@ TEST (DirPathsTest, max_path_len) {
   EXPECT_EQ(2, dp.max_path_len());
 }
 
+TEST (DirPathsTest, has_fileWithoutSnapshot) {
+  std::string path = ".";
+  DirPaths dp(path.c_str());
+  EXPECT_FALSE(dp.has_snapshot());
+  EXPECT_EQ(-1, dp.has_file("arc.nsa"));
+}
+
+#if !defined(WIN32) && !defined(MACOSX)
+TEST (DirPathsTest, has_fileWithSnapshot) {
+  std::string path = ".";
+  DirPaths dp(path.c_str());
+  ASSERT_TRUE(dp.snapshot());
+  EXPECT_EQ(1, dp.has_file("arc.nsa"));
+  EXPECT_EQ(1, dp.has_file("ARC.NSA"));
+  EXPECT_EQ(1, dp.has_file("/arc.nsa"));
+  EXPECT_EQ(0, dp.has_file("missing.nsa"));
+  EXPECT_EQ(-1, dp.has_file("../arc.nsa"));
+
+  DirPaths d2 = dp;
+  EXPECT_TRUE(d2.has_snapshot());
+  EXPECT_EQ(1, d2.has_file("arc.nsa"));
+  EXPECT_EQ(0, d2.has_file("missing.nsa"));
+
+  dp.clear_snapshot();
+  EXPECT_EQ(-1, dp.has_file("arc.nsa"));
+}
+
+TEST (DirPathsTest, OperatorEqualsOverSnapshot) {
+  DirPaths dp(".");
+  ASSERT_TRUE(dp.snapshot());
+  DirPaths d2("..");
+  ASSERT_TRUE(d2.snapshot());
+
+  // the old listing goes, the source's comes along
+  d2 = dp;
+  EXPECT_STREQ(dp.get_path(0), d2.get_path(0));
+  EXPECT_TRUE(d2.has_snapshot());
+  EXPECT_EQ(1, d2.has_file("arc.nsa"));
+
+  // an unlisted source leaves nothing behind
+  DirPaths d3("..");
+  dp = d3;
+  EXPECT_FALSE(dp.has_snapshot());
+  EXPECT_EQ(-1, dp.has_file("arc.nsa"));
+}
+#endif
+
 } // namespace
@@ -0,0 +1,108 @@
+#include "DirtyRect.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+SDL_Rect makeRect(int x, int y, int w, int h) {
+  SDL_Rect r;
+  r.x = x; r.y = y; r.w = w; r.h = h;
+  return r;
+}
+
+bool contains(const SDL_Rect &outer, const SDL_Rect &inner) {
+  return inner.x >= outer.x && inner.y >= outer.y &&
+         inner.x + inner.w <= outer.x + outer.w &&
+         inner.y + inner.h <= outer.y + outer.h;
+}
+
+bool overlaps(const SDL_Rect &r1, const SDL_Rect &r2) {
+  return r1.x < r2.x + r2.w && r2.x < r1.x + r1.w &&
+         r1.y < r2.y + r2.h && r2.y < r1.y + r1.h;
+}
+
+TEST (DirtyRectTest, Fill) {
+  DirtyRect dr;
+  dr.setDimension(640, 480);
+  dr.fill(640, 480);
+  ASSERT_EQ(1, dr.num_rects);
+  EXPECT_EQ(640, dr.rects[0].w);
+  EXPECT_EQ(480, dr.rects[0].h);
+  dr.clear();
+  EXPECT_EQ(0, dr.num_rects);
+  EXPECT_EQ(0, dr.bounding_box.w);
+}
+
+TEST (DirtyRectTest, FarApartStaySeparate) {
+  DirtyRect dr;
+  dr.setDimension(640, 480);
+  dr.add(makeRect(0, 0, 32, 32));
+  dr.add(makeRect(600, 440, 32, 32));
+  EXPECT_EQ(2, dr.num_rects);
+  EXPECT_EQ(0, dr.bounding_box.x);
+  EXPECT_EQ(632, dr.bounding_box.w);
+  EXPECT_EQ(472, dr.bounding_box.h);
+}
+
+TEST (DirtyRectTest, OverlappingMerge) {
+  DirtyRect dr;
+  dr.setDimension(640, 480);
+  dr.add(makeRect(100, 100, 200, 200));
+  dr.add(makeRect(250, 250, 200, 200));
+  ASSERT_EQ(1, dr.num_rects);
+  EXPECT_EQ(100, dr.rects[0].x);
+  EXPECT_EQ(350, dr.rects[0].w);
+}
+
+TEST (DirtyRectTest, NeighboursMerge) {
+  DirtyRect dr;
+  dr.setDimension(640, 480);
+  dr.add(makeRect(10, 10, 100, 20));
+  dr.add(makeRect(10, 30, 100, 20));
+  ASSERT_EQ(1, dr.num_rects);
+  EXPECT_EQ(40, dr.rects[0].h);
+}
+
+TEST (DirtyRectTest, Clipping) {
+  DirtyRect dr;
+  dr.setDimension(640, 480);
+  dr.add(makeRect(-10, -10, 20, 20));
+  dr.add(makeRect(700, 0, 20, 20));
+  ASSERT_EQ(1, dr.num_rects);
+  EXPECT_EQ(0, dr.rects[0].x);
+  EXPECT_EQ(10, dr.rects[0].w);
+}
+
+TEST (DirtyRectTest, BoundedAndDisjoint) {
+  DirtyRect dr;
+  dr.setDimension(1024, 1024);
+  SDL_Rect added[20];
+  for (int i = 0; i < 20; i++) {
+    added[i] = makeRect((i * 97) % 960, (i * 211) % 960, 16 + i, 16);
+    dr.add(added[i]);
+  }
+  ASSERT_LE(dr.num_rects, (int)DirtyRect::MAX_RECTS);
+  for (int i = 0; i < dr.num_rects; i++)
+    for (int j = i + 1; j < dr.num_rects; j++)
+      EXPECT_FALSE(overlaps(dr.rects[i], dr.rects[j]));
+  for (int i = 0; i < 20; i++) {
+    bool covered = false;
+    for (int j = 0; j < dr.num_rects; j++)
+      if (contains(dr.rects[j], added[i])) covered = true;
+    EXPECT_TRUE(covered);
+  }
+}
+
+TEST (DirtyRectTest, Copy) {
+  DirtyRect dr;
+  dr.setDimension(640, 480);
+  dr.add(makeRect(0, 0, 32, 32));
+  dr.add(makeRect(600, 440, 32, 32));
+  DirtyRect d2 = dr;
+  EXPECT_EQ(2, d2.num_rects);
+  DirtyRect d3;
+  d3 = dr;
+  EXPECT_EQ(2, d3.num_rects);
+}
+
+} // namespace
@@ -0,0 +1,116 @@
+#include "EffectFrameRing.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST (EffectFrameRingTest, AcquiresTheNewestDueFrame) {
+  EffectFrameRing ring;
+  ASSERT_TRUE(ring.open(3));
+  for (int i=0; i<3; i++) {
+    ASSERT_EQ(i, ring.beginFrame());
+    ring.endFrame(i, i*16, false);
+  }
+  EXPECT_EQ(1, ring.acquire(20)); // frame 2 isn't due until 32
+  EXPECT_EQ(16, ring.getCounter(1));
+  ring.release(1);
+  EXPECT_EQ(2, ring.acquire(0)); // nothing due yet, so the oldest one
+  ring.release(2);
+}
+
+TEST (EffectFrameRingTest, ReleasedSlotsGoBackToTheRenderer) {
+  EffectFrameRing ring;
+  ASSERT_TRUE(ring.open(2));
+  ring.endFrame(ring.beginFrame(), 0, false);
+  ring.endFrame(ring.beginFrame(), 16, false);
+  // both slots are held until the presenter releases one
+  EXPECT_EQ(0, ring.acquire(0));
+  ring.release(0);
+  EXPECT_EQ(2, ring.beginFrame());
+  EXPECT_EQ(0, ring.getSlot(2));
+}
+
+TEST (EffectFrameRingTest, LastFrameEndsPresentation) {
+  EffectFrameRing ring;
+  ASSERT_TRUE(ring.open(3));
+  ring.endFrame(ring.beginFrame(), 0, true);
+  EXPECT_EQ(0, ring.acquire(100));
+  ring.release(0);
+  EXPECT_EQ(-1, ring.acquire(100));
+}
+
+TEST (EffectFrameRingTest, CancelWakesBothSides) {
+  EffectFrameRing ring;
+  ASSERT_TRUE(ring.open(1));
+  ring.endFrame(ring.beginFrame(), 0, false);
+  ring.cancel();
+  EXPECT_EQ(-1, ring.beginFrame());
+  EXPECT_EQ(-1, ring.acquire(0));
+  ring.reset();
+  EXPECT_EQ(0, ring.beginFrame());
+}
+
+// each slot holds a frame number; the renderer fills a slot and re-reads
+// the frame before it, the presenter checks what it acquired is intact
+enum { SLOTS = 3, PIXELS = 4096, FRAMES = 300 };
+
+struct Renderer {
+  EffectFrameRing *ring;
+  int pixels[SLOTS][PIXELS];
+  bool prev_ok;
+};
+
+int render(void *data) {
+  Renderer *r = (Renderer*)data;
+  int frame;
+  while ((frame = r->ring->beginFrame()) >= 0) {
+    int *dst = r->pixels[r->ring->getSlot(frame)];
+    if (frame > 0) {
+      const int *prev = r->pixels[r->ring->getSlot(frame - 1)];
+      for (int i=0; i<PIXELS; i++)
+        if (prev[i] != frame - 1) r->prev_ok = false;
+    }
+    for (int i=0; i<PIXELS; i++)
+      dst[i] = frame;
+    bool last = (frame == FRAMES - 1);
+    r->ring->endFrame(frame, frame, last);
+    if (last) break;
+  }
+  return 0;
+}
+
+TEST (EffectFrameRingTest, ThreadedFramesArriveIntactAndInOrder) {
+  EffectFrameRing ring;
+  ASSERT_TRUE(ring.open(SLOTS));
+  static Renderer r;
+  r.ring = &ring;
+  r.prev_ok = true;
+  SDL_Thread *thread = SDL_CreateThread(render, &r);
+  ASSERT_TRUE(thread != NULL);
+
+  int last = -1, presented = 0, elapsed = 0;
+  bool in_order = true, intact = true;
+  int frame;
+  while (in_order && intact && (frame = ring.acquire(elapsed)) >= 0) {
+    in_order = (frame > last);
+    const int *pixels = r.pixels[ring.getSlot(frame)];
+    for (int pass=0; pass<2; pass++) {
+      for (int i=0; i<PIXELS; i++)
+        if (pixels[i] != frame) intact = false;
+      if (pass == 0) SDL_Delay(frame % 7 == 0 ? 1 : 0);
+    }
+    ring.release(frame);
+    last = frame;
+    presented++;
+    elapsed += 2; // fall behind now and then so frames get skipped
+  }
+  ring.cancel();
+  SDL_WaitThread(thread, NULL);
+  EXPECT_TRUE(in_order);
+  EXPECT_TRUE(intact);
+  EXPECT_EQ(FRAMES - 1, last);
+  EXPECT_GT(presented, 0);
+  EXPECT_TRUE(r.prev_ok);
+}
+
+} // namespace
@@ -0,0 +1,92 @@
+#include "EffectTileMap.h"
+
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+const int W = 100, H = 70; // 4x3 tiles, the last ones partial
+
+struct Images {
+  Uint32 a[W*H], b[W*H];
+  Images() {
+    for (int i=0; i<W*H; i++) a[i] = b[i] = i * 2654435761u;
+  }
+  void compare(EffectTileMap &map, int x, int y, int w, int h) {
+    SDL_Rect clip = { (Sint16)x, (Sint16)y, (Uint16)w, (Uint16)h };
+    map.compare((unsigned char*)a, (unsigned char*)b, W*4, 4, W, H, clip);
+  }
+};
+
+TEST (EffectTileMapTest, InvalidUntilCompared) {
+  EffectTileMap map;
+  SDL_Rect rect = { 0, 0, 1, 1 };
+  EXPECT_FALSE(map.isValid());
+  EXPECT_FALSE(map.covers(rect));
+}
+
+TEST (EffectTileMapTest, MarksOnlyTilesThatDiffer) {
+  EffectTileMap map;
+  Images img;
+  img.b[5*W + 40] ^= 1;  // tile (1,0)
+  img.b[69*W + 99] ^= 1; // tile (3,2), the partial corner
+  img.compare(map, 0, 0, W, H);
+
+  ASSERT_TRUE(map.isValid());
+  EXPECT_EQ(4, map.getTilesW());
+  EXPECT_EQ(3, map.getTilesH());
+  EXPECT_EQ(2, map.getNumChanged());
+  for (int ty=0; ty<3; ty++)
+    for (int tx=0; tx<4; tx++)
+      EXPECT_EQ((tx==1 && ty==0) || (tx==3 && ty==2), map.isChanged(tx, ty));
+}
+
+TEST (EffectTileMapTest, RunsGroupNeighbouringTiles) {
+  EffectTileMap map;
+  Images img;
+  img.b[10*W + 33] ^= 1;
+  img.b[10*W + 65] ^= 1;
+  img.compare(map, 0, 0, W, H);
+
+  EXPECT_EQ(1, map.getRunEnd(0, 0));
+  EXPECT_EQ(3, map.getRunEnd(1, 0));
+  EXPECT_EQ(4, map.getRunEnd(3, 0));
+  EXPECT_EQ(4, map.getRunEnd(0, 1));
+}
+
+TEST (EffectTileMapTest, LooksOnlyInsideTheClip) {
+  EffectTileMap map;
+  Images img;
+  img.b[2*W + 2] ^= 1;   // outside
+  img.b[40*W + 50] ^= 1; // inside
+  img.compare(map, 40, 32, 40, 20);
+
+  EXPECT_EQ(1, map.getNumChanged());
+  EXPECT_FALSE(map.isChanged(0, 0));
+  EXPECT_TRUE(map.isChanged(1, 1));
+
+  SDL_Rect inside = { 40, 32, 40, 20 };
+  SDL_Rect outside = { 0, 0, 40, 20 };
+  EXPECT_TRUE(map.covers(inside));
+  EXPECT_FALSE(map.covers(outside));
+  map.invalidate();
+  EXPECT_FALSE(map.covers(inside));
+}
+
+TEST (EffectTileMapTest, CompareStartsAfresh) {
+  EffectTileMap map;
+  Images img;
+  img.b[0] ^= 1;
+  img.compare(map, 0, 0, W, H);
+  map.copied = true;
+  EXPECT_EQ(1, map.getNumChanged());
+
+  img.b[0] ^= 1;
+  img.compare(map, 0, 0, W, H);
+  EXPECT_EQ(0, map.getNumChanged());
+  EXPECT_FALSE(map.isChanged(0, 0));
+  EXPECT_FALSE(map.copied);
+}
+
+} // namespace
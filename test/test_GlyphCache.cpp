@@ -0,0 +1,99 @@
+#include "GlyphCache.h"
+
+#include "gtest/gtest.h"
+#include <string.h>
+
+namespace {
+
+SDL_Surface *makeGlyph(int w, int h, unsigned char value) {
+  SDL_Surface *s = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 8, 0, 0, 0, 0);
+  for (int y = 0; y < h; y++)
+    memset((unsigned char *)s->pixels + y * s->pitch, value, w);
+  return s;
+}
+
+const size_t PAGE_BYTES = GlyphCache::PAGE_SIZE * GlyphCache::PAGE_SIZE;
+int font_a, font_b;
+
+TEST (GlyphCacheTest, MissThenHit) {
+  GlyphCache gc;
+  gc.setBudget(4 * PAGE_BYTES);
+  EXPECT_TRUE(gc.get(&font_a, 0, 'x') == NULL);
+  SDL_Surface *s = gc.add(&font_a, 0, 'x', makeGlyph(10, 12, 0x80));
+  ASSERT_TRUE(s != NULL);
+  EXPECT_EQ(10, s->w);
+  EXPECT_EQ(12, s->h);
+  EXPECT_EQ(0x80, ((unsigned char *)s->pixels)[11 * s->pitch + 9]);
+  EXPECT_EQ(s, gc.get(&font_a, 0, 'x'));
+  EXPECT_EQ(1u, gc.getHits());
+  EXPECT_EQ(1u, gc.getMisses());
+}
+
+TEST (GlyphCacheTest, KeyIncludesFontAndStyle) {
+  GlyphCache gc;
+  gc.setBudget(4 * PAGE_BYTES);
+  gc.add(&font_a, 0, 'x', makeGlyph(8, 8, 1));
+  EXPECT_TRUE(gc.get(&font_b, 0, 'x') == NULL);
+  EXPECT_TRUE(gc.get(&font_a, 1, 'x') == NULL);
+  EXPECT_TRUE(gc.get(&font_a, 0, 'y') == NULL);
+}
+
+TEST (GlyphCacheTest, PacksIntoOnePage) {
+  GlyphCache gc;
+  gc.setBudget(4 * PAGE_BYTES);
+  for (Uint16 c = 0; c < 100; c++)
+    gc.add(&font_a, 0, c, makeGlyph(20, 20, (unsigned char)c));
+  EXPECT_EQ(1, gc.getNumPages());
+  EXPECT_EQ(100, gc.getNumEntries());
+  // glyphs must not overwrite each other
+  for (Uint16 c = 0; c < 100; c++) {
+    SDL_Surface *s = gc.get(&font_a, 0, c);
+    ASSERT_TRUE(s != NULL);
+    EXPECT_EQ(c, ((unsigned char *)s->pixels)[0]);
+    EXPECT_EQ(c, ((unsigned char *)s->pixels)[19 * s->pitch + 19]);
+  }
+}
+
+TEST (GlyphCacheTest, EvictsLeastRecentlyUsedPage) {
+  GlyphCache gc;
+  gc.setBudget(2 * PAGE_BYTES);
+  // 128x128 glyphs fill a page with four
+  for (Uint16 c = 0; c < 8; c++)
+    gc.add(&font_a, 0, c, makeGlyph(128, 128, 1));
+  EXPECT_EQ(2, gc.getNumPages());
+  gc.get(&font_a, 0, 0); // keep the first page warm
+  gc.add(&font_a, 0, 8, makeGlyph(128, 128, 1));
+  EXPECT_EQ(2, gc.getNumPages());
+  EXPECT_LE(gc.getUsage(), 2 * PAGE_BYTES);
+  EXPECT_TRUE(gc.get(&font_a, 0, 0) != NULL);
+  EXPECT_TRUE(gc.get(&font_a, 0, 4) == NULL);
+  EXPECT_TRUE(gc.get(&font_a, 0, 8) != NULL);
+}
+
+TEST (GlyphCacheTest, OversizedGlyphKeptAlone) {
+  GlyphCache gc;
+  gc.setBudget(4 * PAGE_BYTES);
+  SDL_Surface *big = makeGlyph(GlyphCache::PAGE_SIZE + 1, 10, 7);
+  EXPECT_EQ(big, gc.add(&font_a, 0, 'W', big));
+  EXPECT_EQ(big, gc.get(&font_a, 0, 'W'));
+  gc.clear();
+  EXPECT_EQ(0, gc.getNumPages());
+  EXPECT_EQ(0u, gc.getUsage());
+}
+
+TEST (GlyphCacheTest, Metrics) {
+  GlyphCache gc;
+  GlyphCache::Metrics m = {1, 9, -2, 11, 10}, out;
+  EXPECT_FALSE(gc.getMetrics(&font_a, 0, 'x', &out));
+  gc.addMetrics(&font_a, 0, 'x', m);
+  ASSERT_TRUE(gc.getMetrics(&font_a, 0, 'x', &out));
+  EXPECT_EQ(10, out.advance);
+  EXPECT_EQ(-2, out.miny);
+  EXPECT_FALSE(gc.getMetrics(&font_b, 0, 'x', &out));
+  EXPECT_FALSE(gc.getMetrics(&font_a, 1, 'x', &out));
+  // metrics outlive the glyph pages
+  gc.clear();
+  EXPECT_TRUE(gc.getMetrics(&font_a, 0, 'x', &out));
+}
+
+} // namespace
@@ -0,0 +1,71 @@
+#include "MaskPlaneCache.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+SDL_Surface *makeMask(int w, int h) {
+  SDL_Surface *s = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 32,
+                                        0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+  for (int y=0; y<h; y++) {
+    Uint32 *row = (Uint32*)((Uint8*)s->pixels + y * s->pitch);
+    for (int x=0; x<w; x++)
+      row[x] = 0xff000000 | (((x * 7 + y * 13) & 0xff) << 16) | ((x * 16 + y) & 0xff);
+  }
+  return s;
+}
+
+TEST (MaskPlaneCacheTest, TilesTheBlueChannel) {
+  MaskPlaneCache cache;
+  SDL_Surface *mask = makeMask(7, 5);
+  const int W = 30, H = 12;
+  const unsigned char *plane = cache.get("mask.bmp", mask, W, H);
+  ASSERT_TRUE(plane != NULL);
+  for (int y=0; y<H; y++)
+    for (int x=0; x<W; x++)
+      ASSERT_EQ(((x % 7) * 16 + (y % 5)) & 0xff, plane[y * W + x]) << x << "," << y;
+  SDL_FreeSurface(mask);
+}
+
+TEST (MaskPlaneCacheTest, CropsMasksLargerThanTheScreen) {
+  MaskPlaneCache cache;
+  SDL_Surface *mask = makeMask(40, 20);
+  const unsigned char *plane = cache.get("big.bmp", mask, 10, 4);
+  for (int y=0; y<4; y++)
+    for (int x=0; x<10; x++)
+      ASSERT_EQ((x * 16 + y) & 0xff, plane[y * 10 + x]);
+  SDL_FreeSurface(mask);
+}
+
+TEST (MaskPlaneCacheTest, ReusesPlanesByNameAndSize) {
+  MaskPlaneCache cache;
+  SDL_Surface *mask = makeMask(8, 8);
+  const unsigned char *a = cache.get("a.bmp", mask, 16, 16);
+  EXPECT_EQ(a, cache.get("a.bmp", mask, 16, 16));
+  EXPECT_EQ(1u, cache.getHits());
+  EXPECT_EQ(1u, cache.getMisses());
+
+  EXPECT_NE(a, cache.get("a.bmp", mask, 32, 16));
+  EXPECT_NE(a, cache.get("b.bmp", mask, 16, 16));
+  EXPECT_EQ(3u, cache.getMisses());
+  EXPECT_TRUE(cache.get(NULL, mask, 16, 16) == NULL);
+  SDL_FreeSurface(mask);
+}
+
+TEST (MaskPlaneCacheTest, EvictsTheLeastRecentlyUsed) {
+  MaskPlaneCache cache;
+  SDL_Surface *mask = makeMask(4, 4);
+  const char *names[] = { "0", "1", "2", "3", "4" };
+  for (int i=0; i<MaskPlaneCache::MAX_PLANES; i++)
+    cache.get(names[i], mask, 8, 8);
+  cache.get(names[0], mask, 8, 8); // 1 is now the oldest
+  cache.get(names[4], mask, 8, 8);
+  unsigned int misses = cache.getMisses();
+  cache.get(names[0], mask, 8, 8);
+  EXPECT_EQ(misses, cache.getMisses());
+  cache.get(names[1], mask, 8, 8);
+  EXPECT_EQ(misses + 1, cache.getMisses());
+  SDL_FreeSurface(mask);
+}
+
+} // namespace
@@ -0,0 +1,145 @@
+#include "NsaReader.h"
+
+#include "gtest/gtest.h"
+
+// test/arc.nsa holds 25 entries: jpgs stored as-is and SPB-compressed bmps
+
+namespace {
+
+TEST (NsaReaderTest, OpenArchive) {
+  DirPaths provider("");
+  NsaReader nr(provider);
+  ASSERT_EQ(0, nr.open(""));
+  EXPECT_STREQ("nsa", nr.getArchiveName());
+  EXPECT_EQ(25, nr.getNumFiles());
+}
+
+TEST (NsaReaderTest, getFileByIndex) {
+  DirPaths provider("");
+  NsaReader nr(provider);
+  ASSERT_EQ(0, nr.open(""));
+  EXPECT_STREQ("BGI.JPG", nr.getFileByIndex(0).name);
+  EXPECT_STREQ("TR_LOGO.JPG", nr.getFileByIndex(24).name);
+  EXPECT_EQ(0u, nr.getFileByIndex(25).length);
+}
+
+TEST (NsaReaderTest, getFileLengthIgnoresCase) {
+  DirPaths provider("");
+  NsaReader nr(provider);
+  ASSERT_EQ(0, nr.open(""));
+  EXPECT_EQ(10077u, nr.getFileLength("bgi.jpg"));
+  EXPECT_EQ(10077u, nr.getFileLength("BGI.JPG"));
+  EXPECT_EQ(5446u, nr.getFileLength("Tr_Logo.jpg"));
+  EXPECT_EQ(0u, nr.getFileLength("missing.jpg"));
+}
+
+TEST (NsaReaderTest, getFileLengthCompressed) {
+  DirPaths provider("");
+  NsaReader nr(provider);
+  ASSERT_EQ(0, nr.open(""));
+  // SPB lengths come from the image header, not the archive directory
+  EXPECT_EQ(49206u, nr.getFileLength("dust.bmp"));
+  EXPECT_EQ(174u, nr.getFileLength("snow3.bmp"));
+}
+
+TEST (NsaReaderTest, getFile) {
+  DirPaths provider("");
+  NsaReader nr(provider);
+  ASSERT_EQ(0, nr.open(""));
+
+  size_t length = nr.getFileLength("kaede3.jpg");
+  ASSERT_EQ(3272u, length);
+  unsigned char *buf = new unsigned char[length];
+  int location = -1;
+  EXPECT_EQ(length, nr.getFile("kaede3.jpg", buf, &location));
+  EXPECT_EQ(BaseReader::ARCHIVE_TYPE_NSA, location);
+  EXPECT_EQ(0xff, buf[0]);
+  EXPECT_EQ(0xd8, buf[1]);
+  delete[] buf;
+
+  length = nr.getFileLength("snow1.bmp");
+  buf = new unsigned char[length];
+  EXPECT_EQ(length, nr.getFile("snow1.bmp", buf, &location));
+  EXPECT_EQ('B', buf[0]);
+  EXPECT_EQ('M', buf[1]);
+  delete[] buf;
+}
+
+TEST (NsaReaderTest, openFile) {
+  DirPaths provider("");
+  NsaReader nr(provider);
+  ASSERT_EQ(0, nr.open(""));
+
+  BaseReader::FileRef ref;
+  ASSERT_TRUE(nr.openFile("kaede3.jpg", ref));
+  ASSERT_EQ(3272u, ref.length);
+  EXPECT_EQ(BaseReader::ARCHIVE_TYPE_NSA, ref.location);
+  unsigned char *buf = new unsigned char[ref.length];
+#if !defined(WIN32)
+  ASSERT_TRUE(ref.view != NULL);
+  ASSERT_EQ(ref.length, nr.getFile("kaede3.jpg", buf, NULL));
+  EXPECT_EQ(0, memcmp(ref.view, buf, ref.length));
+  nr.closeFile(ref);
+#else
+  EXPECT_EQ(3272u, nr.readFile(ref, buf));
+#endif
+  delete[] buf;
+
+  // compressed entries have no view and are decoded by readFile
+  ASSERT_TRUE(nr.openFile("snow1.bmp", ref));
+  EXPECT_TRUE(ref.view == NULL);
+  size_t length = ref.length;
+  buf = new unsigned char[length];
+  // readFile releases the ref
+  EXPECT_EQ(length, nr.readFile(ref, buf));
+  EXPECT_EQ(0u, ref.length);
+  EXPECT_EQ('B', buf[0]);
+  EXPECT_EQ('M', buf[1]);
+  delete[] buf;
+
+  EXPECT_FALSE(nr.openFile("missing.jpg", ref));
+}
+
+TEST (NsaReaderTest, openStream) {
+  DirPaths provider("");
+  NsaReader nr(provider);
+  ASSERT_EQ(0, nr.open(""));
+
+  size_t length = nr.getFileLength("kaede3.jpg");
+  unsigned char *buf = new unsigned char[length];
+  ASSERT_EQ(length, nr.getFile("kaede3.jpg", buf, NULL));
+
+  // stored entries come back on a handle of their own, and release the ref
+  BaseReader::FileRef ref;
+  BaseReader::StreamSource src;
+  ASSERT_TRUE(nr.openFile("kaede3.jpg", ref));
+  ASSERT_TRUE(nr.openStream(ref, src));
+  EXPECT_EQ(0u, ref.length);
+  ASSERT_TRUE(src.fp != NULL);
+  EXPECT_EQ(BaseReader::NO_COMPRESSION, src.compression_type);
+  EXPECT_EQ(length, src.length);
+  EXPECT_EQ(length, src.original_length);
+  unsigned char *buf2 = new unsigned char[length];
+  ASSERT_EQ(0, fseek(src.fp, src.offset, SEEK_SET));
+  ASSERT_EQ(length, fread(buf2, 1, length, src.fp));
+  EXPECT_EQ(0, memcmp(buf, buf2, length));
+  fclose(src.fp);
+  delete[] buf2;
+  delete[] buf;
+
+  // SPB can only be decoded whole, so the ref stays open for readFile
+  ASSERT_TRUE(nr.openFile("snow1.bmp", ref));
+  EXPECT_FALSE(nr.openStream(ref, src));
+  EXPECT_NE(0u, ref.length);
+  nr.closeFile(ref);
+}
+
+TEST (NsaReaderTest, getFileMissing) {
+  DirPaths provider("");
+  NsaReader nr(provider);
+  ASSERT_EQ(0, nr.open(""));
+  unsigned char buf[4];
+  EXPECT_EQ(0u, nr.getFile("missing.jpg", buf, NULL));
+}
+
+} // namespace
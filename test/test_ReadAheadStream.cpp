@@ -0,0 +1,80 @@
+#include "ReadAheadStream.h"
+
+#include "gtest/gtest.h"
+#include <string.h>
+
+namespace {
+
+const int LENGTH = 100000;
+
+struct Source {
+  unsigned char data[LENGTH];
+  Source() {
+    for (int i=0; i<LENGTH; i++) data[i] = (unsigned char)(i*13 + (i>>8));
+  }
+  SDL_RWops *open() { return SDL_RWFromMem(data, LENGTH); }
+};
+
+TEST (ReadAheadStreamTest, ReadsEverythingInOrder) {
+  Source s;
+  ReadAheadStream stream(s.open(), LENGTH, 4096);
+  ASSERT_TRUE(stream.start());
+  unsigned char buf[3001];
+  size_t pos = 0;
+  for (;;) {
+    size_t n = stream.read(buf, sizeof(buf));
+    if (n == 0) break;
+    ASSERT_EQ(0, memcmp(buf, s.data+pos, n)) << "at " << pos;
+    pos += n;
+  }
+  EXPECT_EQ((size_t)LENGTH, pos);
+  EXPECT_EQ((size_t)LENGTH, stream.tell());
+}
+
+TEST (ReadAheadStreamTest, SeeksBackAndForward) {
+  Source s;
+  ReadAheadStream stream(s.open(), LENGTH, 4096);
+  ASSERT_TRUE(stream.start());
+  unsigned char buf[500];
+  EXPECT_EQ(500u, stream.read(buf, 500));
+  ASSERT_TRUE(stream.seek(600)); // inside what was read ahead
+  EXPECT_EQ(500u, stream.read(buf, 500));
+  EXPECT_EQ(0, memcmp(buf, s.data+600, 500));
+  ASSERT_TRUE(stream.seek(10)); // behind it
+  EXPECT_EQ(500u, stream.read(buf, 500));
+  EXPECT_EQ(0, memcmp(buf, s.data+10, 500));
+  ASSERT_TRUE(stream.seek(90000)); // well past it
+  EXPECT_EQ(500u, stream.read(buf, 500));
+  EXPECT_EQ(0, memcmp(buf, s.data+90000, 500));
+  EXPECT_FALSE(stream.seek(LENGTH+1));
+}
+
+TEST (ReadAheadStreamTest, ShortReadAtTheEnd) {
+  Source s;
+  ReadAheadStream stream(s.open(), LENGTH, 4096);
+  ASSERT_TRUE(stream.start());
+  unsigned char buf[500];
+  ASSERT_TRUE(stream.seek(LENGTH-100));
+  EXPECT_EQ(100u, stream.read(buf, 500));
+  EXPECT_EQ(0, memcmp(buf, s.data+LENGTH-100, 100));
+  EXPECT_EQ(0u, stream.read(buf, 500));
+}
+
+TEST (ReadAheadStreamTest, RWopsSeekToTheEndAndBack) {
+  Source s;
+  SDL_RWops *src = s.open();
+  SDL_RWops *rw = ReadAheadStream::createRWops(src, LENGTH, 8192);
+  ASSERT_TRUE(rw != NULL);
+  EXPECT_TRUE(rw != src);
+  unsigned char buf[100];
+  EXPECT_EQ(1, SDL_RWread(rw, buf, 100, 1));
+  EXPECT_EQ(LENGTH, SDL_RWseek(rw, 0, RW_SEEK_END));
+  EXPECT_EQ(100, SDL_RWseek(rw, 100, RW_SEEK_SET));
+  EXPECT_EQ(1, SDL_RWread(rw, buf, 100, 1));
+  EXPECT_EQ(0, memcmp(buf, s.data+100, 100));
+  EXPECT_EQ(-1, SDL_RWseek(rw, -1, RW_SEEK_SET));
+  EXPECT_EQ(-1, SDL_RWwrite(rw, buf, 1, 1));
+  SDL_RWclose(rw);
+}
+
+} // namespace
@@ -0,0 +1,226 @@
+#include "ScriptHandler.h"
+
+#include "gtest/gtest.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+// same FNV-1a as ScriptHandler::hashName, to pick names that share a slot
+unsigned int fnv1a(const std::string &s) {
+  unsigned int hash = 2166136261u;
+  for (size_t i=0; i<s.size(); i++) {
+    hash ^= (unsigned char)s[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// names "<prefix><n>" whose hash lands in slot `slot` of a table of `size`
+std::vector<std::string> collidingNames(const char *prefix, unsigned int size,
+                                        unsigned int slot, int count) {
+  std::vector<std::string> names;
+  char buf[64];
+  for (int n=0; (int)names.size() < count; n++) {
+    snprintf(buf, sizeof(buf), "%s%d", prefix, n);
+    if ((fnv1a(buf) & (size-1)) == slot) names.push_back(buf);
+  }
+  return names;
+}
+
+class ScriptHandlerTest : public ::testing::Test {
+protected:
+  void SetUp() {
+    char tmpl[] = "/tmp/test_ScriptHandlerXXXXXX";
+    ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+    dir = tmpl;
+  }
+
+  void TearDown() {
+    unlink((dir + "/0.txt").c_str());
+    unlink((dir + "/kidoku.dat").c_str());
+    rmdir(dir.c_str());
+  }
+
+  void load(const std::string &script) {
+    load(sh, script);
+  }
+
+  void load(ScriptHandler &h, const std::string &script) {
+    FILE *fp = fopen((dir + "/0.txt").c_str(), "wb");
+    ASSERT_TRUE(fp != NULL);
+    fwrite(script.data(), 1, script.size(), fp);
+    fclose(fp);
+    paths = DirPaths(dir.c_str());
+    h.reset();
+    ASSERT_EQ(0, h.readScript(paths));
+    // ScriptParser::readLog does this before the first jump
+    h.resetLog(h.log_info[ScriptHandler::LABEL_LOG]);
+    if (h.save_path == NULL) {
+      h.save_path = new char[dir.size() + 2];
+      sprintf(h.save_path, "%s/", dir.c_str());
+    }
+  }
+
+  std::string readKidoku() {
+    std::string data;
+    FILE *fp = fopen((dir + "/kidoku.dat").c_str(), "rb");
+    if (fp == NULL) return data;
+    int ch;
+    while ((ch = fgetc(fp)) != EOF) data += (char)ch;
+    fclose(fp);
+    return data;
+  }
+
+  bool isMarked(ScriptHandler &h, const char *label) {
+    h.markAsKidoku(h.lookupLabel(label).start_address);
+    return h.isKidoku();
+  }
+
+  std::string dir;
+  DirPaths paths;
+  ScriptHandler sh;
+};
+
+TEST_F (ScriptHandlerTest, LabelsThatShareASlotAllResolve) {
+  // 8 labels make a 16-slot table; slot 15 makes the probes wrap to 0
+  std::vector<std::string> names = collidingNames("c", 16, 15, 4);
+  std::string script = "*define\ngame\n*start\nend\n";
+  for (size_t i=0; i<names.size(); i++)
+    script += "*" + names[i] + "\nmov %0," + char('0'+i) + "\n";
+  script += "*dup\nmov %0,1\n*dup\nmov %0,2\n";
+  load(script);
+
+  for (size_t i=0; i<names.size(); i++) {
+    ASSERT_TRUE(sh.hasLabel(names[i].c_str())) << names[i];
+    ScriptHandler::LabelInfo label = sh.lookupLabel(names[i].c_str());
+    EXPECT_STREQ(names[i].c_str(), label.name);
+    EXPECT_EQ(4 + 2*(int)i, label.start_line);
+  }
+  EXPECT_STREQ("start", sh.lookupLabel("START").name);
+
+  // the first of two labels with the same name wins
+  EXPECT_EQ(12, sh.lookupLabel("dup").start_line);
+  EXPECT_EQ(14, sh.lookupLabelNext("dup").start_line);
+
+  // a missing name that hashes into the occupied run ends at an empty slot
+  std::vector<std::string> more = collidingNames("c", 16, 15, 6);
+  EXPECT_FALSE(sh.hasLabel(more[5].c_str()));
+  EXPECT_FALSE(sh.hasLabel("nowhere"));
+}
+
+TEST_F (ScriptHandlerTest, LabelByAddressAndLine) {
+  std::string script = "*define\ngame\n";
+  char buf[64];
+  for (int i=0; i<1000; i++) {
+    snprintf(buf, sizeof(buf), "*l%d\nmov %%0,%d\nmov %%1,%d\n", i, i, i);
+    script += buf;
+  }
+  load(script);
+
+  for (int i=0; i<1000; i += 37) {
+    snprintf(buf, sizeof(buf), "l%d", i);
+    ScriptHandler::LabelInfo label = sh.lookupLabel(buf);
+    EXPECT_EQ(2 + 3*i, label.start_line);
+    EXPECT_STREQ(buf, sh.getLabelByLine(label.start_line).name);
+    EXPECT_STREQ(buf, sh.getLabelByLine(label.start_line + 2).name);
+    EXPECT_STREQ(buf, sh.getLabelByAddress(label.start_address).name);
+  }
+  EXPECT_STREQ("define", sh.getLabelByLine(0).name);
+  EXPECT_STREQ("define", sh.getLabelByLine(1).name);
+  EXPECT_STREQ("l999", sh.getLabelByLine(2 + 3*999 + 2).name);
+}
+
+TEST_F (ScriptHandlerTest, AliasesThatShareABucketAllResolve) {
+  load("*define\ngame\n*start\nend\n");
+
+  std::vector<std::string> names = collidingNames("a", 4096, 7, 5);
+  for (size_t i=0; i<4; i++) {
+    sh.addNumAlias(names[i].c_str(), 100 + i);
+    sh.addStrAlias(names[i].c_str(), names[i].c_str());
+  }
+  // spill well past the bucket count so every bucket is chained
+  char buf[64];
+  for (int i=0; i<10000; i++) {
+    snprintf(buf, sizeof(buf), "n%d", i);
+    sh.addNumAlias(buf, i);
+  }
+
+  int value;
+  char str[64];
+  for (size_t i=0; i<4; i++) {
+    ASSERT_TRUE(sh.findNumAlias(names[i].c_str(), &value)) << names[i];
+    EXPECT_EQ(100 + (int)i, value);
+    ASSERT_TRUE(sh.findStrAlias(names[i].c_str(), str));
+    EXPECT_STREQ(names[i].c_str(), str);
+  }
+  EXPECT_FALSE(sh.findNumAlias(names[4].c_str(), &value));
+  EXPECT_FALSE(sh.findStrAlias(names[4].c_str(), str));
+  for (int i=0; i<10000; i += 101) {
+    snprintf(buf, sizeof(buf), "n%d", i);
+    ASSERT_TRUE(sh.findNumAlias(buf, &value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(sh.findNumAlias("n10000", &value));
+}
+
+TEST_F (ScriptHandlerTest, FirstAliasDefinitionWins) {
+  load("*define\ngame\n*start\nend\n");
+  sh.addNumAlias("x", 1);
+  sh.addNumAlias("x", 2);
+  sh.addStrAlias("s", "first");
+  sh.addStrAlias("s", "second");
+
+  int value;
+  char str[64];
+  ASSERT_TRUE(sh.findNumAlias("x", &value));
+  EXPECT_EQ(1, value);
+  ASSERT_TRUE(sh.findStrAlias("s", str));
+  EXPECT_STREQ("first", str);
+}
+
+TEST_F (ScriptHandlerTest, KidokuSpansReadBack) {
+  std::string script = "*define\ngame\n*start\n";
+  for (int i=0; i<200; i++) script += "mov %0,1\n";
+  script += "*middle\n";
+  for (int i=0; i<200; i++) script += "mov %0,2\n";
+  script += "*late\nend\n*unread\n";
+  for (int i=0; i<200; i++) script += "mov %0,3\n";
+  load(script);
+  sh.loadKidokuData();
+
+  EXPECT_FALSE(isMarked(sh, "start"));
+  sh.saveKidokuData();
+  std::string data = readKidoku();
+  ASSERT_GT(data.size(), 400u / 8);
+
+  // nothing new: the file is left alone
+  std::string tampered = data;
+  tampered[tampered.size() - 1] = 0x55;
+  FILE *fp = fopen((dir + "/kidoku.dat").c_str(), "wb");
+  ASSERT_TRUE(fp != NULL);
+  fwrite(tampered.data(), 1, tampered.size(), fp);
+  fclose(fp);
+  sh.saveKidokuData();
+  EXPECT_EQ(tampered, readKidoku());
+
+  // only the bytes around the new marks are written
+  EXPECT_FALSE(isMarked(sh, "middle"));
+  EXPECT_FALSE(isMarked(sh, "late"));
+  sh.saveKidokuData();
+  data = readKidoku();
+  ASSERT_EQ(tampered.size(), data.size());
+  EXPECT_EQ(0x55, data[data.size() - 1]);
+
+  ScriptHandler next;
+  load(next, script);
+  next.loadKidokuData();
+  EXPECT_TRUE(isMarked(next, "start"));
+  EXPECT_TRUE(isMarked(next, "middle"));
+  EXPECT_TRUE(isMarked(next, "late"));
+  EXPECT_FALSE(isMarked(next, "unread"));
+}
+
+}  // namespace
@@ -0,0 +1,176 @@
+#include "ScriptParser.h"
+
+#include "gtest/gtest.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// exposes the save file functions ONScripterLabel reaches through saveAll
+class TestParser : public ScriptParser {
+public:
+  using ScriptParser::script_h;
+  using ScriptParser::file_io_buf_ptr;
+  using ScriptParser::WrittenFile;
+  using ScriptParser::writeInt;
+  using ScriptParser::writeLog;
+  using ScriptParser::readLog;
+  using ScriptParser::updateFileIOBuf;
+};
+
+class ScriptParserTest : public ::testing::Test {
+protected:
+  void SetUp() {
+    char tmpl[] = "/tmp/test_ScriptParserXXXXXX";
+    ASSERT_TRUE(mkdtemp(tmpl) != NULL);
+    dir = std::string(tmpl) + "/";
+  }
+
+  void TearDown() {
+    const char *files[] = { "NScrflog.dat", "NScrllog.dat", "gloval.sav",
+                            "sub/gloval.sav" };
+    for (size_t i=0; i<sizeof(files)/sizeof(files[0]); i++)
+      unlink((dir + files[i]).c_str());
+    rmdir((dir + "sub").c_str());
+    rmdir(dir.c_str());
+  }
+
+  // the destructor reads the logs back from save_path, so it's set first
+  void init(TestParser &p) {
+    p.script_h.save_path = new char[dir.size() + 1];
+    strcpy(p.script_h.save_path, dir.c_str());
+    p.script_h.resetLog(p.script_h.log_info[ScriptHandler::FILE_LOG]);
+    p.script_h.resetLog(p.script_h.log_info[ScriptHandler::LABEL_LOG]);
+  }
+
+  void add(TestParser &p, int from, int to) {
+    char name[32];
+    for (int i=from; i<to; i++) {
+      snprintf(name, sizeof(name), "bg\\f%d.png", i);
+      p.script_h.findAndAddLog(p.script_h.log_info[ScriptHandler::FILE_LOG],
+                               name, true);
+    }
+  }
+
+  // reads the file log back the way a new session would
+  void expectFileLog(int count) {
+    TestParser p;
+    init(p);
+    ScriptHandler::LogInfo &info = p.script_h.log_info[ScriptHandler::FILE_LOG];
+    p.readLog(info);
+    ASSERT_EQ(count, info.num_logs);
+    ScriptHandler::LogLink *cur = info.root_log.next;
+    char name[32];
+    for (int i=0; i<count; i++, cur = cur->next) {
+      snprintf(name, sizeof(name), "BG\\F%d.PNG", i);
+      EXPECT_STREQ(name, cur->name);
+    }
+  }
+
+  std::string read(const char *name) {
+    std::string data;
+    FILE *fp = fopen((dir + name).c_str(), "rb");
+    if (fp == NULL) return data;
+    char buf[256];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0) data.append(buf, len);
+    fclose(fp);
+    return data;
+  }
+
+  void write(const char *name, const std::string &data) {
+    FILE *fp = fopen((dir + name).c_str(), "wb");
+    ASSERT_TRUE(fp != NULL);
+    fwrite(data.data(), 1, data.size(), fp);
+    fclose(fp);
+  }
+
+  std::string dir;
+};
+
+TEST_F (ScriptParserTest, AppendedLogReadsBack) {
+  TestParser p;
+  init(p);
+  ScriptHandler::LogInfo &info = p.script_h.log_info[ScriptHandler::FILE_LOG];
+
+  add(p, 0, 3);
+  p.writeLog(info);
+  size_t first_len = read("NScrflog.dat").size();
+  EXPECT_EQ(first_len, info.written_length);
+  expectFileLog(3);
+
+  // same count width, so the names go on the end
+  add(p, 3, 9);
+  p.writeLog(info);
+  std::string data = read("NScrflog.dat");
+  EXPECT_EQ(data.size(), info.written_length);
+  EXPECT_EQ('9', data[0]);
+  EXPECT_GT(data.size(), first_len);
+  expectFileLog(9);
+
+  // the count grows a digit, so the file is rewritten
+  add(p, 9, 12);
+  p.writeLog(info);
+  EXPECT_EQ(0, read("NScrflog.dat").compare(0, 3, "12\n"));
+  expectFileLog(12);
+}
+
+TEST_F (ScriptParserTest, AppendFallsBackToRewrite) {
+  TestParser p;
+  init(p);
+  ScriptHandler::LogInfo &info = p.script_h.log_info[ScriptHandler::FILE_LOG];
+
+  add(p, 0, 2);
+  p.writeLog(info);
+
+  // cut short behind our back: appending would leave a gap
+  write("NScrflog.dat", read("NScrflog.dat").substr(0, 4));
+  add(p, 2, 4);
+  p.writeLog(info);
+  expectFileLog(4);
+
+  // gone: there's nothing to append to
+  unlink((dir + "NScrflog.dat").c_str());
+  add(p, 4, 6);
+  p.writeLog(info);
+  expectFileLog(6);
+}
+
+TEST_F (ScriptParserTest, UpdateSkipsUnchangedFiles) {
+  TestParser p;
+  init(p);
+  TestParser::WrittenFile written;
+
+  p.file_io_buf_ptr = 0;
+  p.writeInt(1, true);
+  p.writeInt(2, true);
+  ASSERT_EQ(0, p.updateFileIOBuf("gloval.sav", written));
+  std::string first = read("gloval.sav");
+  ASSERT_EQ(8u, first.size());
+
+  // the same bytes aren't written again
+  write("gloval.sav", "changed");
+  p.file_io_buf_ptr = 0;
+  p.writeInt(1, true);
+  p.writeInt(2, true);
+  ASSERT_EQ(0, p.updateFileIOBuf("gloval.sav", written));
+  EXPECT_EQ("changed", read("gloval.sav"));
+
+  // different bytes are
+  p.file_io_buf_ptr = 0;
+  p.writeInt(1, true);
+  p.writeInt(3, true);
+  ASSERT_EQ(0, p.updateFileIOBuf("gloval.sav", written));
+  std::string second = read("gloval.sav");
+  ASSERT_EQ(8u, second.size());
+  EXPECT_EQ(3, second[4]);
+
+  // and so are the same bytes in a new savedir
+  p.script_h.setSavedir("sub");
+  ASSERT_EQ(0, p.updateFileIOBuf("gloval.sav", written));
+  EXPECT_EQ(second, read("sub/gloval.sav"));
+}
+
+}  // namespace
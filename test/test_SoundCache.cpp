@@ -0,0 +1,100 @@
+#include "SoundCache.h"
+
+#include "gtest/gtest.h"
+#include <vector>
+
+// stands in for SDL_mixer's, so the test can see what the cache frees
+static std::vector<Mix_Chunk*> freed;
+extern "C" void Mix_FreeChunk(Mix_Chunk *chunk) {
+  freed.push_back(chunk);
+}
+
+namespace {
+
+struct FakeChunk {
+  Mix_Chunk chunk;
+  explicit FakeChunk(Uint32 alen) {
+    chunk.allocated = 0;
+    chunk.abuf = NULL;
+    chunk.alen = alen;
+    chunk.volume = 128;
+  }
+};
+
+bool wasFreed(Mix_Chunk *chunk) {
+  for (size_t i=0; i<freed.size(); i++)
+    if (freed[i] == chunk) return true;
+  return false;
+}
+
+TEST (SoundCacheTest, HitAfterAdd) {
+  freed.clear();
+  SoundCache cache;
+  cache.setBudget(1000);
+  FakeChunk a(100);
+  int type = 0;
+  EXPECT_TRUE(cache.get("a.wav", &type) == NULL);
+  cache.add("a.wav", &a.chunk, 2);
+  EXPECT_EQ(&a.chunk, cache.get("a.wav", &type));
+  EXPECT_EQ(2, type);
+  EXPECT_EQ(1u, cache.getHits());
+  EXPECT_EQ(1u, cache.getMisses());
+  EXPECT_EQ(100u, cache.getUsage());
+}
+
+TEST (SoundCacheTest, EvictsLeastRecentlyUsedOnceReleased) {
+  freed.clear();
+  SoundCache cache;
+  cache.setBudget(250);
+  FakeChunk a(100), b(100), c(100);
+  int type;
+  cache.add("a", &a.chunk, 1);
+  cache.add("b", &b.chunk, 1);
+  EXPECT_TRUE(cache.release(&a.chunk));
+  EXPECT_TRUE(cache.release(&b.chunk));
+  cache.get("a", &type); // b is now the oldest
+  cache.add("c", &c.chunk, 1);
+  EXPECT_TRUE(wasFreed(&b.chunk));
+  EXPECT_FALSE(wasFreed(&a.chunk));
+  EXPECT_TRUE(cache.get("b", &type) == NULL);
+  EXPECT_EQ(2, cache.getNumEntries());
+}
+
+TEST (SoundCacheTest, HeldChunkOutlivesEviction) {
+  freed.clear();
+  SoundCache cache;
+  cache.setBudget(150);
+  FakeChunk a(100), b(100);
+  int type;
+  cache.add("a", &a.chunk, 1);
+  EXPECT_EQ(&a.chunk, cache.get("a", &type)); // two channels hold it
+  cache.add("b", &b.chunk, 1);
+  EXPECT_TRUE(cache.get("a", &type) == NULL);
+  EXPECT_FALSE(wasFreed(&a.chunk));
+  EXPECT_TRUE(cache.release(&a.chunk));
+  EXPECT_FALSE(wasFreed(&a.chunk));
+  EXPECT_TRUE(cache.release(&a.chunk));
+  EXPECT_TRUE(wasFreed(&a.chunk));
+}
+
+TEST (SoundCacheTest, UntrackedChunksAreLeftToTheCaller) {
+  freed.clear();
+  SoundCache cache;
+  cache.setBudget(50);
+  FakeChunk big(100);
+  cache.add("big", &big.chunk, 1); // over budget, not taken
+  EXPECT_FALSE(cache.release(&big.chunk));
+  EXPECT_TRUE(freed.empty());
+}
+
+TEST (SoundCacheTest, ZeroBudgetDisables) {
+  freed.clear();
+  SoundCache cache;
+  FakeChunk a(10);
+  int type;
+  cache.add("a", &a.chunk, 1);
+  EXPECT_TRUE(cache.get("a", &type) == NULL);
+  EXPECT_EQ(0, cache.getNumEntries());
+}
+
+} // namespace
@@ -0,0 +1,63 @@
+#include "SpriteIndex.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+TEST (SpriteIndexTest, KeepsAscendingOrder) {
+  SpriteIndex index;
+  index.setSize(1000);
+  index.add(500);
+  index.add(3);
+  index.add(999);
+  index.add(0);
+  index.add(42);
+  ASSERT_EQ(5, index.num);
+  EXPECT_EQ(0, index.list[0]);
+  EXPECT_EQ(3, index.list[1]);
+  EXPECT_EQ(42, index.list[2]);
+  EXPECT_EQ(500, index.list[3]);
+  EXPECT_EQ(999, index.list[4]);
+}
+
+TEST (SpriteIndexTest, AddIgnoresDuplicatesAndRange) {
+  SpriteIndex index;
+  index.setSize(10);
+  index.add(5);
+  index.add(5);
+  index.add(-1);
+  index.add(10);
+  ASSERT_EQ(1, index.num);
+  EXPECT_TRUE(index.has(5));
+  EXPECT_FALSE(index.has(10));
+}
+
+TEST (SpriteIndexTest, Remove) {
+  SpriteIndex index;
+  index.setSize(10);
+  for (int i = 0; i < 10; i += 2) index.add(i);
+  index.remove(4);
+  index.remove(3);
+  ASSERT_EQ(4, index.num);
+  EXPECT_EQ(0, index.list[0]);
+  EXPECT_EQ(2, index.list[1]);
+  EXPECT_EQ(6, index.list[2]);
+  EXPECT_EQ(8, index.list[3]);
+  EXPECT_FALSE(index.has(4));
+  index.add(4);
+  EXPECT_EQ(4, index.list[2]);
+}
+
+TEST (SpriteIndexTest, Clear) {
+  SpriteIndex index;
+  index.setSize(10);
+  index.add(1);
+  index.add(7);
+  index.clear();
+  EXPECT_EQ(0, index.num);
+  EXPECT_FALSE(index.has(1));
+  index.add(7);
+  EXPECT_EQ(1, index.num);
+}
+
+} // namespace
@@ -0,0 +1,109 @@
+#include "StreamRing.h"
+
+#include "gtest/gtest.h"
+#include <stdlib.h>
+
+namespace {
+
+TEST (StreamRingTest, WrapsAroundTheEnd) {
+  StreamRing ring;
+  ASSERT_TRUE(ring.open(16));
+  Sint16 in[6] = {1, 2, 3, 4, 5, 6};
+  Sint16 out[6] = {};
+  EXPECT_EQ(12, ring.write(in, 12));
+  EXPECT_EQ(8, ring.read(out, 8, 100));
+  EXPECT_EQ(12, ring.write(in, 12)); // 8 bytes to the end, 4 from the start
+  EXPECT_EQ(4, ring.read(out, 4, 100));
+  EXPECT_EQ(5, out[0]);
+  EXPECT_EQ(6, out[1]);
+  EXPECT_EQ(12, ring.read(out, 16, 100));
+  for (int i=0; i<6; i++)
+    EXPECT_EQ(in[i], out[i]);
+}
+
+TEST (StreamRingTest, WriteStopsWhenFull) {
+  StreamRing ring;
+  ASSERT_TRUE(ring.open(8));
+  Sint16 in[8] = {};
+  EXPECT_EQ(8, ring.write(in, 16));
+  EXPECT_EQ(0, ring.write(in, 2));
+}
+
+TEST (StreamRingTest, ShortReadCountsAsUnderrunUntilFinished) {
+  StreamRing ring;
+  ASSERT_TRUE(ring.open(16));
+  Sint16 in[2] = {7, 8};
+  Sint16 out[4] = {};
+  ring.write(in, 4);
+  EXPECT_EQ(4, ring.read(out, 8, 100));
+  EXPECT_EQ(1u, ring.getUnderruns());
+  EXPECT_FALSE(ring.isDrained());
+  ring.setFinished();
+  EXPECT_EQ(0, ring.read(out, 8, 100));
+  EXPECT_EQ(1u, ring.getUnderruns());
+  EXPECT_TRUE(ring.isDrained());
+}
+
+TEST (StreamRingTest, CancelWakesTheWriter) {
+  StreamRing ring;
+  ASSERT_TRUE(ring.open(8));
+  Sint16 in[4] = {};
+  ring.write(in, 8);
+  EXPECT_TRUE(ring.waitForSpace(0));
+  ring.cancel();
+  EXPECT_FALSE(ring.waitForSpace(8));
+}
+
+struct Producer {
+  StreamRing *ring;
+  int count;
+};
+
+int produce(void *data) {
+  Producer *p = (Producer*)data;
+  Sint16 buf[100];
+  int n = 0;
+  while (n < p->count && p->ring->waitForSpace(sizeof(buf))) {
+    for (int i=0; i<100; i++)
+      buf[i] = (Sint16)(n + i);
+    p->ring->write(buf, sizeof(buf));
+    n += 100;
+  }
+  p->ring->setFinished();
+  return 0;
+}
+
+TEST (StreamRingTest, ThreadedStreamArrivesInOrder) {
+  StreamRing ring;
+  ASSERT_TRUE(ring.open(256));
+  Producer p = {&ring, 20000};
+  SDL_Thread *thread = SDL_CreateThread(produce, &p);
+  ASSERT_TRUE(thread != NULL);
+  int expected = 0;
+  Sint16 out[37];
+  while (!ring.isDrained()) {
+    int n = ring.read(out, sizeof(out), 100) / 2;
+    for (int i=0; i<n; i++)
+      ASSERT_EQ((Sint16)expected++, out[i]);
+  }
+  SDL_WaitThread(thread, NULL);
+  EXPECT_EQ(20000, expected);
+}
+
+TEST (StreamRingTest, ScaleSamplesIsWithinOneOfTheDivision) {
+  Sint16 src[203], dst[203];
+  for (int i=0; i<203; i++)
+    src[i] = (Sint16)(i*331 - 32768);
+  src[0] = 32767;
+  src[1] = -32768;
+  const int volumes[] = {0, 1, 33, 49, 50, 51, 77, 99, 100};
+  for (unsigned v=0; v<sizeof(volumes)/sizeof(volumes[0]); v++) {
+    StreamRing::scaleSamples(dst, src, 203, volumes[v]);
+    for (int i=0; i<203; i++) {
+      int expected = src[i]*volumes[v]/100;
+      ASSERT_LE(abs(dst[i] - expected), 1) << "volume " << volumes[v] << " sample " << i;
+    }
+  }
+}
+
+} // namespace
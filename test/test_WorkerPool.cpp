@@ -0,0 +1,55 @@
+#include "WorkerPool.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+struct Counts {
+  int done[64];
+};
+
+void countJob(void *data, int job) {
+  ((Counts*)data)->done[job]++;
+}
+
+TEST (WorkerPoolTest, RunsInlineWithoutThreads) {
+  WorkerPool pool;
+  EXPECT_EQ(0, pool.getNumThreads());
+  Counts counts = {};
+  pool.run(countJob, &counts, 10);
+  for (int i=0; i<10; i++)
+    EXPECT_EQ(1, counts.done[i]);
+  EXPECT_EQ(0, counts.done[10]);
+}
+
+TEST (WorkerPoolTest, RunsEveryJobOnce) {
+  WorkerPool pool;
+  ASSERT_EQ(3, pool.start(3));
+  for (int pass=0; pass<100; pass++) {
+    Counts counts = {};
+    pool.run(countJob, &counts, 64);
+    for (int i=0; i<64; i++)
+      ASSERT_EQ(1, counts.done[i]);
+  }
+}
+
+TEST (WorkerPoolTest, StopAndRestart) {
+  WorkerPool pool;
+  ASSERT_EQ(2, pool.start(2));
+  pool.stop();
+  EXPECT_EQ(0, pool.getNumThreads());
+  Counts counts = {};
+  pool.run(countJob, &counts, 5);
+  EXPECT_EQ(1, counts.done[4]);
+  ASSERT_EQ(4, pool.start(4));
+  pool.run(countJob, &counts, 5);
+  EXPECT_EQ(2, counts.done[4]);
+}
+
+TEST (WorkerPoolTest, StartZeroRunsNothingInBackground) {
+  WorkerPool pool;
+  EXPECT_EQ(0, pool.start(0));
+  EXPECT_EQ(0, pool.getNumThreads());
+}
+
+} // namespace
@@ -0,0 +1,257 @@
+#include "graphics_sum.h"
+#include "graphics_blend.h"
+#include "graphics_cpu.h"
+#if defined(USE_X86_GFX)
+#include "graphics_sse2.h"
+#endif
+#if defined(USE_X86_AVX2_GFX)
+#include "graphics_avx2.h"
+#endif
+
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace ons_gfx;
+
+namespace {
+
+// the scalar macros every cpu routine is checked against
+void meanScalar(unsigned char *src1, unsigned char *src2, unsigned char *dst, int length) {
+  int n = length + 1;
+  BASIC_MEAN();
+}
+void addToScalar(unsigned char *dst, unsigned char *src, int length) {
+  int n = length + 1;
+  BASIC_ADDTO();
+}
+void subFromScalar(unsigned char *dst, unsigned char *src, int length) {
+  int n = length + 1;
+  BASIC_SUBFROM();
+}
+void blendScalar(Uint32 *dst_buffer, Uint32 *src_buffer, Uint8 *alphap, int alpha, int length) {
+  int n = length + 1;
+  BASIC_BLEND();
+}
+void effectBlendScalar(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 mask2, int length) {
+  int n = length + 1;
+  while (--n > 0) {
+    BLEND_EFFECT_PIXEL();
+    ++dst_buffer, ++src1_buffer, ++src2_buffer;
+  }
+}
+void effectMaskBlendScalar(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint32 *mask_buffer,
+                           Uint32 overflow_mask, Uint32 mask_value, int length) {
+  int n = length + 1;
+  while (--n > 0) {
+    BLEND_EFFECT_MASK_PIXEL();
+    ++dst_buffer, ++src1_buffer, ++src2_buffer, ++mask_buffer;
+  }
+}
+void effectMaskBlend8Scalar(Uint32 *dst_buffer, Uint32 *src1_buffer, Uint32 *src2_buffer, Uint8 *mask_buffer,
+                            Uint32 overflow_mask, Uint32 mask_value, int length) {
+  int n = length + 1;
+  while (--n > 0) {
+    BLEND_EFFECT_MASK_PIXEL();
+    ++dst_buffer, ++src1_buffer, ++src2_buffer, ++mask_buffer;
+  }
+}
+
+struct Kernels {
+  const char *name;
+  int (*mean)(unsigned char*, unsigned char*, unsigned char*, int);
+  int (*addTo)(unsigned char*, unsigned char*, int);
+  int (*subFrom)(unsigned char*, unsigned char*, int);
+  int (*blend)(Uint32*, Uint32*, Uint8*, int, int);
+  int (*effectBlend)(Uint32*, Uint32*, Uint32*, Uint32, int);
+  int (*effectMaskBlend)(Uint32*, Uint32*, Uint32*, Uint32*, Uint32, Uint32, int);
+  int (*effectMaskBlend8)(Uint32*, Uint32*, Uint32*, Uint8*, Uint32, Uint32, int);
+  bool (*available)();
+};
+
+bool always() { return true; }
+
+const Kernels kernels[] = {
+#if defined(USE_X86_GFX)
+  { "SSE2", imageFilterMean_SSE2, imageFilterAddTo_SSE2, imageFilterSubFrom_SSE2,
+    imageFilterBlend_SSE2, imageFilterEffectBlend_SSE2, imageFilterEffectMaskBlend_SSE2,
+    imageFilterEffectMaskBlend8_SSE2, always },
+#endif
+#if defined(USE_X86_AVX2_GFX)
+  { "AVX2", imageFilterMean_AVX2, imageFilterAddTo_AVX2, imageFilterSubFrom_AVX2,
+    imageFilterBlend_AVX2, imageFilterEffectBlend_AVX2, imageFilterEffectMaskBlend_AVX2,
+    imageFilterEffectMaskBlend8_AVX2, hasX86AVX2 },
+#endif
+  { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL }
+};
+
+// lengths and misalignments that exercise the prologue, the vector loop and the tail
+const int MAX_LEN = 75;
+const int MAX_SHIFT = 16;
+const int BUF_BYTES = (MAX_LEN + MAX_SHIFT) * 4;
+
+// largest per-channel difference, ignoring the alpha byte the blends leave undefined
+int maxRGBDiff(const Uint32 *a, const Uint32 *b, int length) {
+  int diff = 0;
+  for (int i=0; i<length; i++)
+    for (int c=0; c<24; c+=8) {
+      int d = (int)((a[i] >> c) & 0xff) - (int)((b[i] >> c) & 0xff);
+      if (d < 0) d = -d;
+      if (d > diff) diff = d;
+    }
+  return diff;
+}
+
+class GraphicsSIMDTest : public ::testing::Test {
+protected:
+  unsigned int seed;
+  unsigned char src1[(MAX_LEN + MAX_SHIFT) * 4], src2[(MAX_LEN + MAX_SHIFT) * 4];
+  Uint32 p1[MAX_LEN + MAX_SHIFT], p2[MAX_LEN + MAX_SHIFT], mask[MAX_LEN + MAX_SHIFT];
+  Uint8 mask8[MAX_LEN + MAX_SHIFT];
+  // outputs share one alignment so both sides split the row the same way
+  Uint32 out_buf[2][MAX_LEN + MAX_SHIFT + 4];
+  unsigned char *dst, *ref;
+  Uint32 *pdst, *pref;
+
+  unsigned int next() {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+  }
+
+  void SetUp() {
+    pdst = out_buf[0] + (4 - ((uintptr_t)out_buf[0] & 0xF) / 4) % 4;
+    pref = out_buf[1] + (4 - ((uintptr_t)out_buf[1] & 0xF) / 4) % 4;
+    dst = (unsigned char*)pdst;
+    ref = (unsigned char*)pref;
+    seed = 1;
+    for (int i=0; i<(MAX_LEN + MAX_SHIFT) * 4; i++) {
+      src1[i] = next();
+      src2[i] = next();
+    }
+    for (int i=0; i<MAX_LEN + MAX_SHIFT; i++) {
+      p1[i] = next() ^ (next() << 16);
+      p2[i] = next() ^ (next() << 16);
+      mask[i] = next() ^ (next() << 16);
+      mask8[i] = mask[i] & 0xff;
+    }
+    // the blends special-case fully transparent and fully opaque source pixels
+    p2[3] &= 0x00ffffff;
+    p2[7] |= 0xff000000;
+  }
+};
+
+TEST_F (GraphicsSIMDTest, SumRoutinesMatchScalar) {
+  for (const Kernels *k = kernels; k->name; k++) {
+    if (!k->available()) continue;
+    SCOPED_TRACE(k->name);
+    for (int shift=0; shift<MAX_SHIFT; shift++)
+      for (int len=0; len<=MAX_LEN; len++) {
+        memcpy(dst, src1, BUF_BYTES);
+        memcpy(ref, src1, BUF_BYTES);
+        k->addTo(dst + shift, src2, len);
+        addToScalar(ref + shift, src2, len);
+        ASSERT_EQ(0, memcmp(dst, ref, BUF_BYTES)) << "addTo shift " << shift << " len " << len;
+
+        k->subFrom(dst + shift, src2 + 1, len);
+        subFromScalar(ref + shift, src2 + 1, len);
+        ASSERT_EQ(0, memcmp(dst, ref, BUF_BYTES)) << "subFrom shift " << shift << " len " << len;
+
+        // the vector mean halves each input before adding, so it may round down once more
+        memset(dst, 0, BUF_BYTES);
+        memset(ref, 0, BUF_BYTES);
+        k->mean(src1, src2 + 3, dst + shift, len);
+        meanScalar(src1, src2 + 3, ref + shift, len);
+        for (int i=0; i<BUF_BYTES; i++)
+          ASSERT_LE(abs((int)dst[i] - (int)ref[i]), 1) << "mean shift " << shift << " len " << len;
+      }
+  }
+}
+
+TEST_F (GraphicsSIMDTest, BlendRoutinesMatchScalar) {
+  const int alphas[] = { 256, 255, 128, 1, 0 };
+  for (const Kernels *k = kernels; k->name; k++) {
+    if (!k->available()) continue;
+    SCOPED_TRACE(k->name);
+    for (int shift=0; shift<4; shift++)
+      for (int len=0; len<=MAX_LEN; len++) {
+        for (int a=0; a<5; a++) {
+          memcpy(pdst, p1, BUF_BYTES);
+          memcpy(pref, p1, BUF_BYTES);
+          k->blend(pdst + shift, p2, (Uint8*)p2 + 3, alphas[a], len);
+          blendScalar(pref + shift, p2, (Uint8*)p2 + 3, alphas[a], len);
+          ASSERT_LE(maxRGBDiff(pdst, pref, MAX_LEN + MAX_SHIFT), 1)
+            << "blend alpha " << alphas[a] << " shift " << shift << " len " << len;
+        }
+
+        for (Uint32 mask2=0; mask2<256; mask2+=15) {
+          k->effectBlend(pdst + shift, p1, p2, mask2, len);
+          effectBlendScalar(pref + shift, p1, p2, mask2, len);
+          ASSERT_LE(maxRGBDiff(pdst, pref, MAX_LEN + MAX_SHIFT), 1)
+            << "effectBlend mask " << mask2 << " shift " << shift << " len " << len;
+        }
+
+        for (Uint32 value=0; value<512; value+=37) {
+          k->effectMaskBlend(pdst + shift, p1, p2, mask, ~0xffu, value, len);
+          effectMaskBlendScalar(pref + shift, p1, p2, mask, ~0xffu, value, len);
+          ASSERT_LE(maxRGBDiff(pdst, pref, MAX_LEN + MAX_SHIFT), 1)
+            << "effectMaskBlend value " << value << " shift " << shift << " len " << len;
+
+          k->effectMaskBlend(pdst + shift, p2, p1, mask, 0xffffffff, value, len);
+          effectMaskBlendScalar(pref + shift, p2, p1, mask, 0xffffffff, value, len);
+          ASSERT_LE(maxRGBDiff(pdst, pref, MAX_LEN + MAX_SHIFT), 1)
+            << "crossfade value " << value << " shift " << shift << " len " << len;
+
+          // a byte plane holding the blue channel gives the same result
+          Uint32 out32[MAX_LEN + MAX_SHIFT];
+          memcpy(out32, pdst, BUF_BYTES);
+          k->effectMaskBlend8(pdst + shift, p2, p1, mask8, 0xffffffff, value, len);
+          ASSERT_EQ(0, memcmp(out32, pdst, BUF_BYTES))
+            << "8-bit crossfade value " << value << " shift " << shift << " len " << len;
+          k->effectMaskBlend8(pdst + shift, p1, p2, mask8 + 1, ~0xffu, value, len);
+          effectMaskBlend8Scalar(pref + shift, p1, p2, mask8 + 1, ~0xffu, value, len);
+          ASSERT_LE(maxRGBDiff(pdst, pref, MAX_LEN + MAX_SHIFT), 1)
+            << "8-bit effectMaskBlend value " << value << " shift " << shift << " len " << len;
+        }
+      }
+  }
+}
+
+#if defined(USE_X86_AVX2_GFX)
+TEST_F (GraphicsSIMDTest, AVX2MatchesSSE2Exactly) {
+  if (!hasX86AVX2()) return;
+  for (int shift=0; shift<MAX_SHIFT; shift++)
+    for (int len=0; len<=MAX_LEN; len++) {
+      memcpy(dst, src1, BUF_BYTES);
+      memcpy(ref, src1, BUF_BYTES);
+      imageFilterAddTo_AVX2(dst + shift, src2, len);
+      imageFilterAddTo_SSE2(ref + shift, src2, len);
+      imageFilterSubFrom_AVX2(dst + shift, src2 + 1, len);
+      imageFilterSubFrom_SSE2(ref + shift, src2 + 1, len);
+      ASSERT_EQ(0, memcmp(dst, ref, BUF_BYTES)) << "shift " << shift << " len " << len;
+      imageFilterMean_AVX2(src1, src2 + 3, dst + shift, len);
+      imageFilterMean_SSE2(src1, src2 + 3, ref + shift, len);
+      ASSERT_EQ(0, memcmp(dst, ref, BUF_BYTES)) << "shift " << shift << " len " << len;
+    }
+  for (int shift=0; shift<4; shift++)
+    for (int len=0; len<=MAX_LEN; len++) {
+      memcpy(pdst, p1, BUF_BYTES);
+      memcpy(pref, p1, BUF_BYTES);
+      imageFilterBlend_AVX2(pdst + shift, p2, (Uint8*)p2 + 3, 200, len);
+      imageFilterBlend_SSE2(pref + shift, p2, (Uint8*)p2 + 3, 200, len);
+      ASSERT_EQ(0, memcmp(pdst, pref, BUF_BYTES)) << "shift " << shift << " len " << len;
+      imageFilterEffectBlend_AVX2(pdst + shift, p1, p2, 99, len);
+      imageFilterEffectBlend_SSE2(pref + shift, p1, p2, 99, len);
+      ASSERT_EQ(0, memcmp(pdst, pref, BUF_BYTES)) << "shift " << shift << " len " << len;
+      imageFilterEffectMaskBlend_AVX2(pdst + shift, p2, p1, mask, ~0xffu, 300, len);
+      imageFilterEffectMaskBlend_SSE2(pref + shift, p2, p1, mask, ~0xffu, 300, len);
+      ASSERT_EQ(0, memcmp(pdst, pref, BUF_BYTES)) << "shift " << shift << " len " << len;
+      imageFilterEffectMaskBlend8_AVX2(pdst + shift, p2, p1, mask8 + 3, ~0xffu, 300, len);
+      imageFilterEffectMaskBlend8_SSE2(pref + shift, p2, p1, mask8 + 3, ~0xffu, 300, len);
+      ASSERT_EQ(0, memcmp(pdst, pref, BUF_BYTES)) << "shift " << shift << " len " << len;
+    }
+}
+#endif
+
+}